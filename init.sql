@@ -287,7 +287,9 @@ RETURNS TABLE (
 	dbid		OID,
 	relid		REGCLASS,
 	processed	INT8,
-	status		TEXT)
+	status		TEXT,
+	rows_per_sec	FLOAT8,
+	bytes_per_sec	FLOAT8)
 AS 'pg_pathman', 'show_concurrent_part_tasks_internal'
 LANGUAGE C STRICT;
 
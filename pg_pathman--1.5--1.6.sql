@@ -0,0 +1,21 @@
+/*
+ * Show all existing concurrent partitioning tasks.
+ */
+DROP VIEW @extschema@.pathman_concurrent_part_tasks;
+DROP FUNCTION @extschema@.show_concurrent_part_tasks();
+CREATE FUNCTION @extschema@.show_concurrent_part_tasks()
+RETURNS TABLE (
+	userid		REGROLE,
+	pid			INT,
+	dbid		OID,
+	relid		REGCLASS,
+	processed	INT8,
+	status		TEXT,
+	rows_per_sec	FLOAT8,
+	bytes_per_sec	FLOAT8)
+AS 'pg_pathman', 'show_concurrent_part_tasks_internal'
+LANGUAGE C STRICT;
+
+CREATE VIEW @extschema@.pathman_concurrent_part_tasks
+AS SELECT * FROM @extschema@.show_concurrent_part_tasks();
+GRANT SELECT ON @extschema@.pathman_concurrent_part_tasks TO PUBLIC;
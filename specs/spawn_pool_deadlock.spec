@@ -0,0 +1,29 @@
+setup
+{
+	CREATE EXTENSION pg_pathman;
+	CREATE TABLE range_rel(id int not null);
+	SELECT create_range_partitions('range_rel', 'id', 1, 100, 1);
+	SELECT set_spawn_using_bgw('range_rel', true);
+}
+
+teardown
+{
+	DROP TABLE range_rel CASCADE;
+	DROP EXTENSION pg_pathman;
+}
+
+session "s1"
+step "s1b"					{ BEGIN; }
+step "s1_insert_50"			{ INSERT INTO range_rel VALUES (50); }
+step "s1_insert_150"		{ INSERT INTO range_rel VALUES (150); }
+step "s1c"					{ COMMIT; }
+step "s1_show_partitions"	{ SELECT partition, range_min, range_max
+							  FROM pathman_partition_list
+							  WHERE parent = 'range_rel'::regclass
+							  ORDER BY range_min::int; }
+
+session "s2"
+step "s2_alter"				{ ALTER TABLE range_rel ADD COLUMN val int; }
+
+# Pool worker's lock is queued behind ALTER TABLE, which waits for s1
+permutation "s1b" "s1_insert_50" "s2_alter" "s1_insert_150" "s1c" "s1_show_partitions"
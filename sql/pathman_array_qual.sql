@@ -76,6 +76,41 @@ EXPLAIN (COSTS OFF) SELECT * FROM array_qual.test WHERE b IN (-100, -200, -300,
 EXPLAIN (COSTS OFF) SELECT * FROM array_qual.test WHERE b IN (NULL, NULL, NULL, NULL);
 
 
+/* long IN-lists (pruning should work) */
+CREATE OR REPLACE FUNCTION array_qual.scanned_partitions(query TEXT)
+RETURNS INT4 AS $$
+DECLARE
+	line	TEXT;
+	result	INT4 := 0;
+BEGIN
+	FOR line IN EXECUTE 'EXPLAIN (COSTS OFF) ' || query
+	LOOP
+		IF line ~ 'Seq Scan on' THEN
+			result := result + 1;
+		END IF;
+	END LOOP;
+
+	RETURN result;
+END
+$$ LANGUAGE plpgsql;
+
+SELECT array_qual.scanned_partitions(format('SELECT * FROM array_qual.test WHERE a = ANY (%L::INT4[])', array_agg(g)))
+FROM generate_series(-5000, 250) g;
+SELECT array_qual.scanned_partitions(format('SELECT * FROM array_qual.test WHERE a = ANY (%L::INT4[])', array_agg(g * 200)))
+FROM generate_series(1, 5000) g;
+SELECT array_qual.scanned_partitions(format('SELECT * FROM array_qual.test WHERE a = ANY (%L::INT4[])', array_agg(CASE WHEN g % 2 = 0 THEN g END)))
+FROM generate_series(1, 99) g;
+SELECT array_qual.scanned_partitions(format('SELECT * FROM array_qual.test WHERE a = ANY (%L::INT4[])', array_agg(g)))
+FROM generate_series(2000, 7000) g;
+
+CREATE TABLE array_qual.hash_test(a INT4 NOT NULL);
+SELECT create_hash_partitions('array_qual.hash_test', 'a', 4);
+SELECT array_qual.scanned_partitions(format('SELECT * FROM array_qual.hash_test WHERE a = ANY (%L::INT4[])', array_agg(1)))
+FROM generate_series(1, 5000) g;
+SELECT array_qual.scanned_partitions(format('SELECT * FROM array_qual.hash_test WHERE a = ANY (%L::INT4[])', array_agg(g)))
+FROM generate_series(1, 5000) g;
+
+
 /*
  * Test expr = ANY (...)
  */
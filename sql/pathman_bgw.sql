@@ -143,6 +143,194 @@ SELECT count(*) FROM test_bgw.conc_part;
 
 DROP TABLE test_bgw.conc_part CASCADE;
 
+/*
+ * Tests for several ConcurrentPartWorkers
+ */
+
+CREATE TABLE test_bgw.conc_part_range(id INT4 NOT NULL);
+INSERT INTO test_bgw.conc_part_range SELECT generate_series(1, 1000);
+SELECT create_range_partitions('test_bgw.conc_part_range', 'id', 1, 100, 10, false);
+
+/* Run 4 partitioning bgworkers */
+SET pg_pathman.concurrent_part_workers = 4;
+SELECT partition_table_concurrently('test_bgw.conc_part_range', 10, 1);
+RESET pg_pathman.concurrent_part_workers;
+
+/* Wait until they finish */
+DO $$
+DECLARE
+	ops			int8;
+	rows		int8;
+	rows_old	int8 := 0;
+	i			int4 := 0; -- protect from endless loop
+BEGIN
+	LOOP
+		-- get total number of processed rows
+		SELECT processed
+		FROM pathman_concurrent_part_tasks
+		WHERE relid = 'test_bgw.conc_part_range'::regclass
+		INTO rows;
+
+		-- get number of partitioning tasks
+		GET DIAGNOSTICS ops = ROW_COUNT;
+
+		IF ops > 0 THEN
+			PERFORM pg_sleep(0.2);
+
+			ASSERT rows IS NOT NULL;
+
+			IF rows_old = rows THEN
+				i = i + 1;
+			ELSIF rows < rows_old THEN
+				RAISE EXCEPTION 'rows is decreasing: new %, old %', rows, rows_old;
+			ELSIF rows > 1000 THEN
+				RAISE EXCEPTION 'processed % rows', rows;
+			END IF;
+		ELSE
+			EXIT; -- exit loop
+		END IF;
+
+		IF i > 500 THEN
+			RAISE WARNING 'looks like partitioning bgw is stuck!';
+			EXIT; -- exit loop
+		END IF;
+
+		rows_old = rows;
+	END LOOP;
+END
+$$ LANGUAGE plpgsql;
+
+/* Check amount of tasks and rows in parent and partitions */
+SELECT count(*) FROM pathman_concurrent_part_tasks;
+SELECT count(*) FROM ONLY test_bgw.conc_part_range;
+SELECT count(*) FROM test_bgw.conc_part_range;
+
+DROP TABLE test_bgw.conc_part_range CASCADE;
+
+
+/* Move rows using SPI */
+CREATE TABLE test_bgw.conc_part_spi(id INT4 NOT NULL);
+INSERT INTO test_bgw.conc_part_spi SELECT generate_series(1, 1000);
+SELECT create_range_partitions('test_bgw.conc_part_spi', 'id', 1, 100, 10, false);
+
+SET pg_pathman.enable_native_data_mover = off;
+SELECT partition_table_concurrently('test_bgw.conc_part_spi', 10, 1);
+RESET pg_pathman.enable_native_data_mover;
+
+/* Wait until they finish */
+DO $$
+DECLARE
+	ops			int8;
+	rows		int8;
+	rows_old	int8 := 0;
+	i			int4 := 0; -- protect from endless loop
+BEGIN
+	LOOP
+		-- get total number of processed rows
+		SELECT processed
+		FROM pathman_concurrent_part_tasks
+		WHERE relid = 'test_bgw.conc_part_spi'::regclass
+		INTO rows;
+
+		-- get number of partitioning tasks
+		GET DIAGNOSTICS ops = ROW_COUNT;
+
+		IF ops > 0 THEN
+			PERFORM pg_sleep(0.2);
+
+			ASSERT rows IS NOT NULL;
+
+			IF rows_old = rows THEN
+				i = i + 1;
+			ELSIF rows < rows_old THEN
+				RAISE EXCEPTION 'rows is decreasing: new %, old %', rows, rows_old;
+			ELSIF rows > 1000 THEN
+				RAISE EXCEPTION 'processed % rows', rows;
+			END IF;
+		ELSE
+			EXIT; -- exit loop
+		END IF;
+
+		IF i > 500 THEN
+			RAISE WARNING 'looks like partitioning bgw is stuck!';
+			EXIT; -- exit loop
+		END IF;
+
+		rows_old = rows;
+	END LOOP;
+END
+$$ LANGUAGE plpgsql;
+
+/* Check amount of tasks and rows in parent and partitions */
+SELECT count(*) FROM pathman_concurrent_part_tasks;
+SELECT count(*) FROM ONLY test_bgw.conc_part_spi;
+SELECT count(*) FROM test_bgw.conc_part_spi;
+
+DROP TABLE test_bgw.conc_part_spi CASCADE;
+
+
+/* Adapt batch size and sleep between batches */
+CREATE TABLE test_bgw.conc_part_adapt(id INT4 NOT NULL);
+INSERT INTO test_bgw.conc_part_adapt SELECT generate_series(1, 1000);
+SELECT create_range_partitions('test_bgw.conc_part_adapt', 'id', 1, 100, 10, false);
+
+SET pg_pathman.concurrent_part_batch_time = '10ms';
+SET pg_pathman.concurrent_part_duty_cycle = 0.5;
+SELECT partition_table_concurrently('test_bgw.conc_part_adapt', 10, 1);
+RESET pg_pathman.concurrent_part_batch_time;
+RESET pg_pathman.concurrent_part_duty_cycle;
+
+/* Wait until they finish */
+DO $$
+DECLARE
+	ops			int8;
+	rows		int8;
+	rows_old	int8 := 0;
+	i			int4 := 0; -- protect from endless loop
+BEGIN
+	LOOP
+		-- get total number of processed rows
+		SELECT processed
+		FROM pathman_concurrent_part_tasks
+		WHERE relid = 'test_bgw.conc_part_adapt'::regclass
+		INTO rows;
+
+		-- get number of partitioning tasks
+		GET DIAGNOSTICS ops = ROW_COUNT;
+
+		IF ops > 0 THEN
+			PERFORM pg_sleep(0.2);
+
+			ASSERT rows IS NOT NULL;
+
+			IF rows_old = rows THEN
+				i = i + 1;
+			ELSIF rows < rows_old THEN
+				RAISE EXCEPTION 'rows is decreasing: new %, old %', rows, rows_old;
+			ELSIF rows > 1000 THEN
+				RAISE EXCEPTION 'processed % rows', rows;
+			END IF;
+		ELSE
+			EXIT; -- exit loop
+		END IF;
+
+		IF i > 500 THEN
+			RAISE WARNING 'looks like partitioning bgw is stuck!';
+			EXIT; -- exit loop
+		END IF;
+
+		rows_old = rows;
+	END LOOP;
+END
+$$ LANGUAGE plpgsql;
+
+/* Check amount of tasks and rows in parent and partitions */
+SELECT count(*) FROM pathman_concurrent_part_tasks;
+SELECT count(*) FROM ONLY test_bgw.conc_part_adapt;
+SELECT count(*) FROM test_bgw.conc_part_adapt;
+
+DROP TABLE test_bgw.conc_part_adapt CASCADE;
+
 
 
 DROP SCHEMA test_bgw CASCADE;
@@ -0,0 +1,65 @@
+\set VERBOSITY terse
+
+SET search_path = 'public';
+CREATE EXTENSION pg_pathman;
+CREATE SCHEMA test_cache_rebuild;
+
+
+CREATE TABLE test_cache_rebuild.range_rel(id INT4 NOT NULL);
+INSERT INTO test_cache_rebuild.range_rel SELECT generate_series(1, 40);
+SELECT create_range_partitions('test_cache_rebuild.range_rel', 'id', 1, 10, 4);
+
+/* bounds in the order of dispatch cache */
+CREATE VIEW test_cache_rebuild.cache_state AS
+SELECT string_agg(format('[%s, %s)', range_min, range_max), ' ') AS bounds
+FROM pathman_partition_list
+WHERE parent = 'test_cache_rebuild.range_rel'::REGCLASS;
+
+
+/* append */
+SELECT append_range_partition('test_cache_rebuild.range_rel');
+INSERT INTO test_cache_rebuild.range_rel SELECT generate_series(41, 50);
+SELECT tableoid::regclass, min(id), max(id), count(*) FROM test_cache_rebuild.range_rel WHERE id BETWEEN 10 AND 45 GROUP BY 1 ORDER BY 2;
+SELECT bounds AS incremental FROM test_cache_rebuild.cache_state \gset
+SET pg_pathman.enable = f;
+SET pg_pathman.enable = t;
+SELECT bounds, bounds = :'incremental' AS same_as_rebuild FROM test_cache_rebuild.cache_state;
+
+/* split */
+SELECT split_range_partition('test_cache_rebuild.range_rel_2', 15);
+SELECT tableoid::regclass, min(id), max(id), count(*) FROM test_cache_rebuild.range_rel WHERE id BETWEEN 10 AND 45 GROUP BY 1 ORDER BY 2;
+SELECT bounds AS incremental FROM test_cache_rebuild.cache_state \gset
+SET pg_pathman.enable = f;
+SET pg_pathman.enable = t;
+SELECT bounds, bounds = :'incremental' AS same_as_rebuild FROM test_cache_rebuild.cache_state;
+
+/* merge */
+SELECT merge_range_partitions('test_cache_rebuild.range_rel_2', 'test_cache_rebuild.range_rel_6');
+SELECT tableoid::regclass, min(id), max(id), count(*) FROM test_cache_rebuild.range_rel WHERE id BETWEEN 10 AND 45 GROUP BY 1 ORDER BY 2;
+SELECT bounds AS incremental FROM test_cache_rebuild.cache_state \gset
+SET pg_pathman.enable = f;
+SET pg_pathman.enable = t;
+SELECT bounds, bounds = :'incremental' AS same_as_rebuild FROM test_cache_rebuild.cache_state;
+
+/* drop */
+SELECT drop_range_partition('test_cache_rebuild.range_rel_3');
+SELECT tableoid::regclass, min(id), max(id), count(*) FROM test_cache_rebuild.range_rel WHERE id BETWEEN 10 AND 45 GROUP BY 1 ORDER BY 2;
+SELECT bounds AS incremental FROM test_cache_rebuild.cache_state \gset
+SET pg_pathman.enable = f;
+SET pg_pathman.enable = t;
+SELECT bounds, bounds = :'incremental' AS same_as_rebuild FROM test_cache_rebuild.cache_state;
+
+/* add */
+SELECT add_range_partition('test_cache_rebuild.range_rel', 21, 31);
+INSERT INTO test_cache_rebuild.range_rel SELECT generate_series(21, 30);
+SELECT tableoid::regclass, min(id), max(id), count(*) FROM test_cache_rebuild.range_rel WHERE id BETWEEN 10 AND 45 GROUP BY 1 ORDER BY 2;
+SELECT bounds AS incremental FROM test_cache_rebuild.cache_state \gset
+SET pg_pathman.enable = f;
+SET pg_pathman.enable = t;
+SELECT bounds, bounds = :'incremental' AS same_as_rebuild FROM test_cache_rebuild.cache_state;
+
+
+DROP VIEW test_cache_rebuild.cache_state;
+DROP TABLE test_cache_rebuild.range_rel CASCADE;
+DROP SCHEMA test_cache_rebuild;
+DROP EXTENSION pg_pathman;
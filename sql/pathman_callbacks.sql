@@ -98,6 +98,21 @@ INSERT INTO callbacks.abc VALUES (301, 0); /* +1 new partition */
 DROP TABLE callbacks.abc CASCADE;
 
 
+/* spawn several partitions at once */
+CREATE TABLE callbacks.abc(a INT4 NOT NULL);
+SELECT create_range_partitions('callbacks.abc', 'a', 1, 100, 1);
+SELECT set_init_callback('callbacks.abc',
+						 'callbacks.abc_on_part_created_callback(jsonb)');
+
+INSERT INTO callbacks.abc VALUES (350);		/* +3 new partitions */
+INSERT INTO callbacks.abc VALUES (-150);	/* +2 new partitions */
+
+SELECT * FROM pathman_partition_list
+WHERE parent = 'callbacks.abc'::REGCLASS
+ORDER BY range_min::INT4;
+
+DROP TABLE callbacks.abc CASCADE;
+
 /* more complex test using rotation of tables */
 CREATE TABLE callbacks.abc(a INT4 NOT NULL);
 INSERT INTO callbacks.abc
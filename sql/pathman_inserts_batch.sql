@@ -0,0 +1,117 @@
+\set VERBOSITY terse
+
+SET search_path = 'public';
+CREATE EXTENSION pg_pathman;
+CREATE SCHEMA test_batch;
+
+
+/* source rows switch partitions all the time */
+CREATE TABLE test_batch.source(id INT4 NOT NULL, val TEXT);
+INSERT INTO test_batch.source SELECT (i * 7) % 30 + 1, i::text FROM generate_series(1, 30) i;
+
+CREATE TABLE test_batch.range_rel(id INT4 NOT NULL, val TEXT);
+SELECT create_range_partitions('test_batch.range_rel', 'id', 1, 10, 3);
+
+SET pg_pathman.partition_filter_batch_size = 8;
+
+
+/* rows of a batch are grouped by partition */
+INSERT INTO test_batch.range_rel SELECT * FROM test_batch.source;
+SELECT tableoid::regclass, count(*), min(id), max(id) FROM test_batch.range_rel GROUP BY 1 ORDER BY 1;
+
+/* original order is kept within a partition */
+SELECT string_agg(val, ',') FROM ONLY test_batch.range_rel_2;
+
+/* VALUES are batched as well */
+INSERT INTO test_batch.range_rel VALUES (1, 'a'), (25, 'b'), (2, 'c');
+SELECT * FROM test_batch.range_rel WHERE val IN ('a', 'b', 'c') ORDER BY id;
+TRUNCATE test_batch.range_rel;
+
+
+/* RETURNING should see rows in original order (no batching) */
+INSERT INTO test_batch.range_rel
+SELECT * FROM test_batch.source WHERE val::int <= 6
+RETURNING *;
+TRUNCATE test_batch.range_rel;
+
+
+/* row triggers of partitions should fire in original order */
+CREATE OR REPLACE FUNCTION test_batch.print_row() RETURNS TRIGGER AS $$
+BEGIN
+	RAISE NOTICE '% %', tg_table_name, new.id;
+	RETURN new;
+END;
+$$ LANGUAGE plpgsql;
+
+CREATE TRIGGER print_row BEFORE INSERT ON test_batch.range_rel_1
+	FOR EACH ROW EXECUTE PROCEDURE test_batch.print_row();
+CREATE TRIGGER print_row BEFORE INSERT ON test_batch.range_rel_2
+	FOR EACH ROW EXECUTE PROCEDURE test_batch.print_row();
+CREATE TRIGGER print_row BEFORE INSERT ON test_batch.range_rel_3
+	FOR EACH ROW EXECUTE PROCEDURE test_batch.print_row();
+
+INSERT INTO test_batch.range_rel SELECT * FROM test_batch.source WHERE val::int <= 6;
+SELECT count(*) FROM test_batch.range_rel;
+
+DROP TRIGGER print_row ON test_batch.range_rel_1;
+DROP TRIGGER print_row ON test_batch.range_rel_2;
+DROP TRIGGER print_row ON test_batch.range_rel_3;
+TRUNCATE test_batch.range_rel;
+
+
+/* complex subplans are not batched */
+INSERT INTO test_batch.range_rel SELECT * FROM test_batch.source ORDER BY id DESC;
+SELECT tableoid::regclass, count(*) FROM test_batch.range_rel GROUP BY 1 ORDER BY 1;
+SELECT string_agg(val, ',') FROM ONLY test_batch.range_rel_1;
+
+
+/* HASH partitions are looked up for the whole batch */
+CREATE TABLE test_batch.hash_rel(id INT4 NOT NULL, val TEXT);
+SELECT create_hash_partitions('test_batch.hash_rel', 'id', 3);
+INSERT INTO test_batch.hash_rel SELECT * FROM test_batch.source;
+SELECT count(*) FROM test_batch.hash_rel;
+SELECT count(*) FROM test_batch.hash_rel WHERE tableoid != ('test_batch.hash_rel_' || get_hash_part_idx(hashint4(id), 3))::REGCLASS;
+DROP TABLE test_batch.hash_rel CASCADE;
+
+
+/* RANGE partitions of NUMERIC key are compared using cmp_proc */
+CREATE TABLE test_batch.num_rel(id NUMERIC NOT NULL, val TEXT);
+SELECT create_range_partitions('test_batch.num_rel', 'id', 1::NUMERIC, 10::NUMERIC, 3);
+INSERT INTO test_batch.num_rel SELECT id + 0.5, val FROM test_batch.source;
+SELECT tableoid::regclass, count(*), min(id), max(id) FROM test_batch.num_rel GROUP BY 1 ORDER BY 1;
+
+
+/* rows which need a new partition are routed one by one */
+TRUNCATE test_batch.range_rel;
+INSERT INTO test_batch.range_rel SELECT id * 2, val FROM test_batch.source;
+SELECT tableoid::regclass, count(*), min(id), max(id) FROM test_batch.range_rel GROUP BY 1 ORDER BY 1;
+
+
+/* COPY routes rows in batches as well */
+TRUNCATE test_batch.range_rel;
+COPY test_batch.range_rel FROM stdin;
+1	a
+25	b
+2	c
+15	d
+\.
+SELECT tableoid::regclass, * FROM test_batch.range_rel ORDER BY id;
+
+
+/* partition selected last time is checked first */
+SET pg_pathman.partition_filter_batch_size = 1;
+TRUNCATE test_batch.range_rel;
+INSERT INTO test_batch.range_rel VALUES (1, 'a'), (10, 'b'), (11, 'c'), (20, 'd'), (3, 'e'), (65, 'f'), (61, 'g'), (60, 'h');
+SELECT tableoid::regclass, * FROM test_batch.range_rel ORDER BY val;
+TRUNCATE test_batch.num_rel;
+INSERT INTO test_batch.num_rel VALUES (1.5, 'a'), (10.99, 'b'), (11, 'c'), (10, 'd'), (30.5, 'e');
+SELECT tableoid::regclass, * FROM test_batch.num_rel ORDER BY val;
+
+
+RESET pg_pathman.partition_filter_batch_size;
+DROP TABLE test_batch.range_rel CASCADE;
+DROP TABLE test_batch.num_rel CASCADE;
+DROP TABLE test_batch.source;
+DROP FUNCTION test_batch.print_row();
+DROP SCHEMA test_batch;
+DROP EXTENSION pg_pathman;
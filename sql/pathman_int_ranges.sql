@@ -0,0 +1,66 @@
+\set VERBOSITY terse
+
+SET search_path = 'public';
+CREATE EXTENSION pg_pathman;
+CREATE SCHEMA test_int_ranges;
+
+
+/* look up partitions using constants of the same type as partitioning key */
+CREATE FUNCTION test_int_ranges.lookup(rel REGCLASS, typ TEXT, val TEXT)
+RETURNS TABLE (eq TEXT, lt INT8, le INT8, gt INT8, ge INT8) AS $$
+BEGIN
+	RETURN QUERY EXECUTE format(
+		'SELECT (SELECT tableoid::regclass::text FROM %1$s WHERE val = %2$L::%3$s),
+				(SELECT count(*) FROM %1$s WHERE val < %2$L::%3$s),
+				(SELECT count(*) FROM %1$s WHERE val <= %2$L::%3$s),
+				(SELECT count(*) FROM %1$s WHERE val > %2$L::%3$s),
+				(SELECT count(*) FROM %1$s WHERE val >= %2$L::%3$s)',
+		rel, val, typ);
+END
+$$ LANGUAGE plpgsql;
+
+
+/* INT2, gap between partitions */
+CREATE TABLE test_int_ranges.int2_rel(val INT2 NOT NULL);
+SELECT create_range_partitions('test_int_ranges.int2_rel', 'val', ARRAY[1, 11, 21, 31, 41]::INT2[]);
+SELECT drop_range_partition('test_int_ranges.int2_rel_3');
+INSERT INTO test_int_ranges.int2_rel SELECT generate_series(1, 20);
+INSERT INTO test_int_ranges.int2_rel SELECT generate_series(31, 40);
+SELECT v, l.* FROM unnest(ARRAY['0', '1', '10', '11', '20', '21', '30', '31', '40', '41']) v, test_int_ranges.lookup('test_int_ranges.int2_rel', 'INT2', v) l;
+
+/* INT4, infinite bounds */
+CREATE TABLE test_int_ranges.int4_rel(val INT4 NOT NULL);
+SELECT create_range_partitions('test_int_ranges.int4_rel', 'val', 1, 10, 2);
+SELECT add_range_partition('test_int_ranges.int4_rel', NULL, 1);
+SELECT add_range_partition('test_int_ranges.int4_rel', 21, NULL);
+INSERT INTO test_int_ranges.int4_rel SELECT generate_series(-5, 25);
+INSERT INTO test_int_ranges.int4_rel VALUES (-2147483648), (2147483647);
+SELECT v, l.* FROM unnest(ARRAY['-2147483648', '0', '1', '10', '11', '20', '21', '2147483647']) v, test_int_ranges.lookup('test_int_ranges.int4_rel', 'INT4', v) l;
+
+/* INT8, bounds beyond INT4 */
+CREATE TABLE test_int_ranges.int8_rel(val INT8 NOT NULL);
+SELECT create_range_partitions('test_int_ranges.int8_rel', 'val', 0::INT8, 4294967296::INT8, 3);
+INSERT INTO test_int_ranges.int8_rel VALUES (0), (4294967295), (4294967296), (8589934591), (8589934592), (12884901887);
+SELECT v, l.* FROM unnest(ARRAY['-1', '0', '4294967295', '4294967296', '8589934591', '8589934592', '12884901887', '12884901888']) v, test_int_ranges.lookup('test_int_ranges.int8_rel', 'INT8', v) l;
+
+/* DATE */
+CREATE TABLE test_int_ranges.date_rel(val DATE NOT NULL);
+SELECT create_range_partitions('test_int_ranges.date_rel', 'val', '2020-01-01'::DATE, '1 month'::INTERVAL, 3);
+INSERT INTO test_int_ranges.date_rel VALUES ('2020-01-01'), ('2020-01-31'), ('2020-02-01'), ('2020-02-29'), ('2020-03-01'), ('2020-03-31');
+SELECT v, l.* FROM unnest(ARRAY['2019-12-31', '2020-01-01', '2020-01-31', '2020-02-01', '2020-02-29', '2020-03-01', '2020-03-31', '2020-04-01']) v, test_int_ranges.lookup('test_int_ranges.date_rel', 'DATE', v) l;
+
+/* TIMESTAMP */
+CREATE TABLE test_int_ranges.timestamp_rel(val TIMESTAMP NOT NULL);
+SELECT create_range_partitions('test_int_ranges.timestamp_rel', 'val', '2020-01-01'::TIMESTAMP, '1 day'::INTERVAL, 2);
+INSERT INTO test_int_ranges.timestamp_rel VALUES ('2020-01-01 00:00:00'), ('2020-01-01 23:59:59.999999'), ('2020-01-02 00:00:00'), ('2020-01-02 23:59:59.999999');
+SELECT v, l.* FROM unnest(ARRAY['2019-12-31 23:59:59.999999', '2020-01-01 00:00:00', '2020-01-01 23:59:59.999999', '2020-01-02 00:00:00', '2020-01-02 23:59:59.999999', '2020-01-03 00:00:00']) v, test_int_ranges.lookup('test_int_ranges.timestamp_rel', 'TIMESTAMP', v) l;
+
+
+DROP TABLE test_int_ranges.int2_rel CASCADE;
+DROP TABLE test_int_ranges.int4_rel CASCADE;
+DROP TABLE test_int_ranges.int8_rel CASCADE;
+DROP TABLE test_int_ranges.date_rel CASCADE;
+DROP TABLE test_int_ranges.timestamp_rel CASCADE;
+DROP FUNCTION test_int_ranges.lookup(REGCLASS, TEXT, TEXT);
+DROP SCHEMA test_int_ranges;
+DROP EXTENSION pg_pathman;
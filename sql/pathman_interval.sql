@@ -167,6 +167,46 @@ SELECT set_interval('test_interval.abc', NULL::INTEGER);
 DROP TABLE test_interval.abc CASCADE;
 
 
+/* Many partitions are created by a single call */
+CREATE TABLE test_interval.bulk (id INT4 NOT NULL);
+SELECT create_range_partitions('test_interval.bulk', 'id', 1, 10, 50);
+INSERT INTO test_interval.bulk VALUES (1001);	/* +51 new partitions */
+
+/* Bounds are adjacent, partitions are named in order */
+SELECT count(*),
+	   min(range_min::INT4),
+	   max(range_max::INT4),
+	   bool_and(range_max::INT4 - range_min::INT4 = 10) AS same_width,
+	   bool_and(next_min IS NULL OR next_min = range_max::INT4) AS no_gaps,
+	   bool_and(partition::TEXT = 'test_interval.bulk_' || n) AS ordered_names
+FROM (SELECT partition, range_min, range_max,
+			 lead(range_min::INT4) OVER (ORDER BY range_min::INT4) AS next_min,
+			 row_number() OVER (ORDER BY range_min::INT4) AS n
+	  FROM pathman_partition_list
+	  WHERE parent = 'test_interval.bulk'::REGCLASS) p;
+
+INSERT INTO test_interval.bulk VALUES (-495);	/* +50 new partitions */
+
+SELECT count(*),
+	   min(range_min::INT4),
+	   max(range_max::INT4),
+	   bool_and(next_min IS NULL OR next_min = range_max::INT4) AS no_gaps
+FROM (SELECT range_min, range_max,
+			 lead(range_min::INT4) OVER (ORDER BY range_min::INT4) AS next_min
+	  FROM pathman_partition_list
+	  WHERE parent = 'test_interval.bulk'::REGCLASS) p;
+
+/* Rows are routed to partitions with matching bounds */
+INSERT INTO test_interval.bulk SELECT generate_series(1, 1010);
+SELECT count(*) AS total,
+	   count(*) FILTER (WHERE t.id >= p.range_min::INT4 AND
+							  t.id < p.range_max::INT4) AS routed
+FROM test_interval.bulk t
+JOIN pathman_partition_list p ON p.partition = t.tableoid::REGCLASS;
+
+DROP TABLE test_interval.bulk CASCADE;
+
+
 
 DROP SCHEMA test_interval CASCADE;
 DROP EXTENSION pg_pathman;
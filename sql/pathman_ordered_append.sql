@@ -0,0 +1,34 @@
+/*
+ * 9.5 can't sort partitions separately, so it always sorts the whole
+ * Append; pathman_ordered_append_1.out is the version for it.
+ */
+
+\set VERBOSITY terse
+
+SET search_path = 'public';
+CREATE EXTENSION pg_pathman;
+CREATE SCHEMA test_ordered;
+
+
+CREATE TABLE test_ordered.range_rel(id INT4 NOT NULL, val INT4);
+INSERT INTO test_ordered.range_rel SELECT g, g % 7 FROM generate_series(1, 3000) g;
+SELECT create_range_partitions('test_ordered.range_rel', 'id', 1, 1000, 3);
+VACUUM ANALYZE;
+
+
+/* only partitions actually reached are sorted */
+EXPLAIN (COSTS OFF) SELECT * FROM test_ordered.range_rel ORDER BY id LIMIT 5;
+EXPLAIN (COSTS OFF) SELECT * FROM test_ordered.range_rel ORDER BY id DESC, val LIMIT 5;
+EXPLAIN (COSTS OFF) SELECT * FROM test_ordered.range_rel WHERE id > 1500 ORDER BY id LIMIT 5;
+
+/* whole Append is sorted if all rows are needed */
+EXPLAIN (COSTS OFF) SELECT * FROM test_ordered.range_rel ORDER BY id;
+
+/* check results */
+SELECT * FROM test_ordered.range_rel ORDER BY id DESC, val LIMIT 5;
+SELECT * FROM test_ordered.range_rel WHERE id > 1500 ORDER BY id LIMIT 5;
+
+
+DROP TABLE test_ordered.range_rel CASCADE;
+DROP SCHEMA test_ordered;
+DROP EXTENSION pg_pathman;
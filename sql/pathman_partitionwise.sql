@@ -0,0 +1,152 @@
+/*
+ * Partition-wise joins and aggregation are supported since 12.
+ */
+\set VERBOSITY terse
+SET search_path = 'public';
+CREATE SCHEMA pathman;
+CREATE EXTENSION pg_pathman SCHEMA pathman;
+CREATE SCHEMA test;
+
+
+
+/* returns true if partitions are joined pair by pair */
+CREATE OR REPLACE FUNCTION test.is_partitionwise(query TEXT)
+RETURNS BOOL AS $$
+DECLARE
+	line	TEXT;
+BEGIN
+	FOR line IN EXECUTE 'EXPLAIN (COSTS OFF) ' || query
+	LOOP
+		IF line ~ '(Join|Nested Loop)' THEN
+			RETURN false;
+		END IF;
+
+		IF line ~ 'Append' THEN
+			RETURN true;
+		END IF;
+	END LOOP;
+
+	RETURN false;
+END
+$$ LANGUAGE plpgsql;
+
+
+/* RANGE partitioned tables */
+CREATE TABLE test.range_a(id INT4 NOT NULL, val INT4);
+INSERT INTO test.range_a SELECT g, g FROM generate_series(1, 1000) g;
+SELECT pathman.create_range_partitions('test.range_a', 'id', 1, 100);
+
+CREATE TABLE test.range_b(id INT4 NOT NULL, val INT4);
+INSERT INTO test.range_b SELECT g, g FROM generate_series(1, 1000) g;
+SELECT pathman.create_range_partitions('test.range_b', 'id', 1, 100);
+
+/* same key, different bounds */
+CREATE TABLE test.range_c(id INT4 NOT NULL, val INT4);
+INSERT INTO test.range_c SELECT g, g FROM generate_series(1, 1000) g;
+SELECT pathman.create_range_partitions('test.range_c', 'id', 1, 200);
+
+/* HASH partitioned tables */
+CREATE TABLE test.hash_a(id INT4 NOT NULL, val INT4);
+INSERT INTO test.hash_a SELECT g, g FROM generate_series(1, 1000) g;
+SELECT pathman.create_hash_partitions('test.hash_a', 'id', 4);
+
+CREATE TABLE test.hash_b(id INT4 NOT NULL, val INT4);
+INSERT INTO test.hash_b SELECT g, g FROM generate_series(1, 1000) g;
+SELECT pathman.create_hash_partitions('test.hash_b', 'id', 4);
+
+ANALYZE;
+
+
+/* make sure pair-wise joins are much cheaper */
+SET pg_pathman.enable_runtimeappend = off;
+SET enable_hashjoin = off;
+SET enable_mergejoin = off;
+
+
+/* disabled by default */
+SELECT test.is_partitionwise('SELECT * FROM test.range_a JOIN test.range_b USING (id)');
+
+SET enable_partitionwise_join = on;
+
+SELECT test.is_partitionwise('SELECT * FROM test.range_a JOIN test.range_b USING (id)');
+SELECT count(*) FROM test.range_a JOIN test.range_b USING (id);
+
+/* some partitions are pruned */
+SELECT test.is_partitionwise('SELECT * FROM test.range_a a JOIN test.range_b b ON a.id = b.id WHERE a.id < 250');
+SELECT count(*) FROM test.range_a a JOIN test.range_b b ON a.id = b.id WHERE a.id < 250;
+
+/* not joined by partitioning key */
+SELECT test.is_partitionwise('SELECT * FROM test.range_a a JOIN test.range_b b ON a.val = b.val');
+
+/* different bounds */
+SELECT test.is_partitionwise('SELECT * FROM test.range_a JOIN test.range_c USING (id)');
+SELECT count(*) FROM test.range_a JOIN test.range_c USING (id);
+
+/* outer joins are not supported yet */
+SELECT test.is_partitionwise('SELECT * FROM test.range_a LEFT JOIN test.range_b USING (id)');
+
+/* HASH */
+SELECT test.is_partitionwise('SELECT * FROM test.hash_a JOIN test.hash_b USING (id)');
+SELECT count(*) FROM test.hash_a JOIN test.hash_b USING (id);
+
+RESET enable_partitionwise_join;
+RESET enable_mergejoin;
+RESET enable_hashjoin;
+RESET pg_pathman.enable_runtimeappend;
+
+
+/*
+ * Partition-wise aggregation
+ */
+
+/* few groups per partition */
+CREATE TABLE test.range_d(id INT4 NOT NULL, cat INT4);
+INSERT INTO test.range_d SELECT g, g % 10 FROM generate_series(1, 1000) g;
+SELECT pathman.create_range_partitions('test.range_d', 'id', 1, 100);
+ANALYZE test.range_d;
+
+
+/* make sure aggregation of partitions is much cheaper */
+SET pg_pathman.enable_runtimeappend = off;
+SET enable_hashagg = off;
+
+
+/* disabled by default */
+EXPLAIN (COSTS OFF)
+SELECT id, count(*) FROM test.range_a WHERE id <= 250 GROUP BY id;
+
+SET enable_partitionwise_aggregate = on;
+
+/* groups can't span several partitions */
+EXPLAIN (COSTS OFF)
+SELECT id, count(*) FROM test.range_a WHERE id <= 250 GROUP BY id;
+SELECT count(*) FROM (SELECT id, count(*) FROM test.range_a GROUP BY id) s;
+
+SELECT count(*) FROM (SELECT id, count(*) FROM test.hash_a GROUP BY id) s;
+
+/* not grouped by partitioning key */
+EXPLAIN (COSTS OFF)
+SELECT cat, sum(id) FROM test.range_d WHERE id <= 250 GROUP BY cat;
+SELECT cat, sum(id) FROM test.range_d GROUP BY cat HAVING sum(id) > 50000 ORDER BY cat;
+
+/* grouping expressions are computed by partitions */
+EXPLAIN (COSTS OFF)
+SELECT id % 5, count(*) FROM test.range_d WHERE id <= 250 GROUP BY id % 5;
+SELECT id % 5, count(*) FROM test.range_d GROUP BY id % 5 ORDER BY 1;
+
+EXPLAIN (COSTS OFF)
+SELECT id / 10, count(*) FROM test.range_d WHERE id <= 250 GROUP BY id, id / 10;
+SELECT count(*) FROM (SELECT id / 10, count(*) FROM test.range_d GROUP BY id, id / 10) s;
+
+/* some partitions are pruned */
+SELECT cat, count(*) FROM test.range_d WHERE id <= 250 GROUP BY cat ORDER BY cat;
+
+RESET enable_partitionwise_aggregate;
+RESET enable_hashagg;
+RESET pg_pathman.enable_runtimeappend;
+
+
+
+DROP SCHEMA test CASCADE;
+DROP EXTENSION pg_pathman CASCADE;
+DROP SCHEMA pathman CASCADE;
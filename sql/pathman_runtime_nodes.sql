@@ -308,6 +308,15 @@ join (select * from test.run_values limit 4) as t2 on t1.id = t2.val;
 select generate_series(1, 2) from test.runtime_test_1 as t1
 join (select * from test.run_values limit 4) as t2 on t1.id = t2.val;
 
+/* RuntimeAppend (plan states are initialized on demand and reused) */
+select f.n, c.cnt, l.id is not null as found
+from generate_series(1, 4) f(n),
+lateral (select count(*) cnt from test.runtime_test_1
+		 where id = any(array[f.n, f.n + 1, f.n + 2])) c,
+lateral (select id from test.runtime_test_1
+		 where id = any(array[f.n, f.n + 1, f.n + 2]) limit 1) l
+order by f.n;
+
 /* RuntimeAppend (select ... where id = ANY (subquery), missing partitions) */
 select count(*) = 0 from pathman.pathman_partition_list
 where parent = 'test.runtime_test_4'::regclass and coalesce(range_min::int, 1) < 0;
@@ -319,7 +328,27 @@ insert into test.dropped_cols select generate_series(1, 100);
 alter table test.dropped_cols add column new_col text;	/* add column */
 alter table test.dropped_cols drop column new_col;		/* drop column! */
 explain (costs off) select * from generate_series(1, 10) f(id), lateral (select count(1) FILTER (WHERE true) from test.dropped_cols where val = f.id) c;
+/* RuntimeAppend (repeated param values are served by the pruning cache) */
+select array_agg(c.count order by f.n)
+from unnest(array[1, 2, 1, 3, 4, 5, 6, 7, 8, 9, 10, 2, 1, 200, 1]) with ordinality f(id, n),
+lateral (select count(1) from test.dropped_cols where val = f.id) c;
 drop table test.dropped_cols cascade;
+/* RuntimeAppend (pruning cache is kept by plan until partitions change) */
+create table test.prune_cache(val int4 not null);
+select pathman.create_range_partitions('test.prune_cache', 'val', 1, 10, 2);
+insert into test.prune_cache select generate_series(1, 20);
+prepare prune_cache_q(int4[]) as
+select array_agg(c.count order by f.n)
+from unnest($1) with ordinality f(id, n),
+lateral (select count(1) from test.prune_cache where val = f.id) c;
+execute prune_cache_q(array[5, 15, 25, 5, 15, 25]);
+execute prune_cache_q(array[5, 15, 25, 5, 15, 25]);
+select pathman.append_range_partition('test.prune_cache');
+insert into test.prune_cache values (25);
+select pathman.drop_range_partition('test.prune_cache_1');
+execute prune_cache_q(array[5, 15, 25, 5, 15, 25]);
+deallocate prune_cache_q;
+drop table test.prune_cache cascade;
 
 set enable_hashjoin = off;
 set enable_mergejoin = off;
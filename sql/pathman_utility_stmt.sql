@@ -154,6 +154,64 @@ COPY copy_stmt_hooking.test2(t) FROM stdin;
 \.
 SELECT COUNT(*) FROM copy_stmt_hooking.test2;
 
+/* COPY FROM (rows are inserted in bulk) */
+CREATE TABLE copy_stmt_hooking.bulk(id int not null, val text);
+CREATE UNIQUE INDEX ON copy_stmt_hooking.bulk(id);
+SELECT create_range_partitions('copy_stmt_hooking.bulk', 'id', 1, 10, 3);
+COPY copy_stmt_hooking.bulk FROM stdin;
+1	a
+15	b
+2	c
+25	d
+3	e
+\.
+SELECT *, tableoid::REGCLASS FROM copy_stmt_hooking.bulk ORDER BY id;
+
+\set VERBOSITY default
+
+/* COPY FROM (error in a buffered row points to its number, not line) */
+COPY copy_stmt_hooking.bulk FROM stdin;
+4	f
+16	g
+2	h
+5	i
+\.
+COPY copy_stmt_hooking.bulk FROM stdin WITH (FORMAT csv, HEADER);
+id,val
+4,"f
+g"
+15,h
+\.
+
+/* COPY FROM (rows of partitions with triggers are inserted one by one) */
+CREATE OR REPLACE FUNCTION copy_stmt_hooking.check_row() RETURNS TRIGGER AS $$
+BEGIN
+	IF new.id = 17 THEN
+		RAISE EXCEPTION 'bad row %', new.id;
+	END IF;
+	RETURN new;
+END;
+$$ LANGUAGE plpgsql;
+CREATE TRIGGER check_row BEFORE INSERT ON copy_stmt_hooking.bulk_2
+	FOR EACH ROW EXECUTE PROCEDURE copy_stmt_hooking.check_row();
+COPY copy_stmt_hooking.bulk FROM stdin;
+6	j
+17	k
+7	l
+\.
+
+\set VERBOSITY terse
+
+COPY copy_stmt_hooking.bulk FROM stdin;
+6	j
+18	k
+7	l
+26	m
+\.
+SELECT *, tableoid::REGCLASS FROM copy_stmt_hooking.bulk ORDER BY id;
+DROP TABLE copy_stmt_hooking.bulk CASCADE;
+DROP FUNCTION copy_stmt_hooking.check_row();
+
 DROP SCHEMA copy_stmt_hooking CASCADE;
 
 
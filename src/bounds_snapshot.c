@@ -0,0 +1,746 @@
+/* ------------------------------------------------------------------------
+ *
+ * bounds_snapshot.c
+ *		Persistent snapshots of partitions' bounds
+ *
+ *		After a restart, every backend has to parse CHECK constraints
+ *		of all partitions in order to build a PartRelationInfo. Instead,
+ *		we store bounds of a parent's partitions in a file along with
+ *		a stamp of the parent's pg_class entry and the partitions' CHECK
+ *		constraints. The stamp is taken with a single index scan, so the
+ *		whole snapshot is validated at once. Snapshots are also cached
+ *		by each backend, thus PartRelationInfo rebuilds don't read files.
+ *
+ * Copyright (c) 2020, Postgres Professional
+ *
+ * ------------------------------------------------------------------------
+ */
+
+#include "compat/pg_compat.h"
+
+#include "bounds_snapshot.h"
+#include "init.h"
+
+#include "access/genam.h"
+#include "access/htup_details.h"
+#if PG_VERSION_NUM >= 120000
+#include "access/table.h"
+#endif
+#include "catalog/indexing.h"
+#include "catalog/pg_class.h"
+#include "catalog/pg_constraint.h"
+#include "lib/stringinfo.h"
+#include "miscadmin.h"
+#include "storage/fd.h"
+#include "utils/builtins.h"
+#include "utils/fmgroids.h"
+#include "utils/guc.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+#include "utils/syscache.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+/* Index on pg_constraint (conrelid, ...) */
+#if PG_VERSION_NUM >= 110000
+#define ConstraintRelidIndexIdCompat ConstraintRelidTypidNameIndexId
+#else
+#define ConstraintRelidIndexIdCompat ConstraintRelidIndexId
+#endif
+
+/*
+ * Layout of a snapshot file (each part is MAXALIGN'ed):
+ *
+ *		BoundsSnapshotHeader
+ *		BoundsSnapshotRecord, [len, min bytes], [len, max bytes]
+ *		...
+ *		pg_crc32c
+ */
+typedef struct
+{
+	uint32			magic;
+	uint32			version;
+	Oid				parent_relid;
+	BoundsSnapshotStamp stamp;
+	PartType		parttype;
+	Oid				ev_type;
+	int16			ev_len;
+	bool			ev_byval;
+	uint32			nentries;
+} BoundsSnapshotHeader;
+
+typedef struct
+{
+	Oid				child_relid;
+	uint32			part_idx;
+	int8			min_infinite;	/* no bytes are stored if infinite */
+	int8			max_infinite;
+} BoundsSnapshotRecord;
+
+/*
+ * Snapshots read or written by this backend.
+ */
+typedef struct
+{
+	Oid				parent_relid;	/* key */
+	BoundsSnapshot *snapshot;
+} BoundsSnapshotCacheEntry;
+
+
+/*
+ * For pg_pathman.enable_bounds_snapshot GUC.
+ */
+bool			pg_pathman_enable_bounds_snapshot = false;
+
+static HTAB			   *snapshot_cache = NULL;
+static MemoryContext	snapshot_cache_mcxt = NULL;
+
+
+static void bounds_snapshot_path(char *path, Oid parent_relid);
+static void get_snapshot_stamp(Oid parent_relid,
+							   const Oid *partitions,
+							   uint32 parts_count,
+							   BoundsSnapshotStamp *stamp);
+static bool snapshot_stamps_equal(const BoundsSnapshotStamp *stamp1,
+								  const BoundsSnapshotStamp *stamp2);
+
+static BoundsSnapshot *load_bounds_snapshot(const PartRelationInfo *prel);
+static BoundsSnapshot *parse_bounds_snapshot(const char *raw_data, Size size,
+											 const PartRelationInfo *prel);
+static void cache_bounds_snapshot(Oid parent_relid, BoundsSnapshot *snapshot);
+static bool read_bound(char *data, Size size, Size *offset,
+					   int8 infinite, const PartRelationInfo *prel,
+					   Bound *bound);
+static void write_bound(StringInfo buf, const Bound *bound,
+						const PartRelationInfo *prel);
+static void append_aligned(StringInfo buf, const void *data, int len);
+
+static int cmp_snapshot_entries(const void *p1, const void *p2);
+
+
+void
+init_bounds_snapshot_static_data(void)
+{
+	DefineCustomBoolVariable("pg_pathman.enable_bounds_snapshot",
+							 "Store bounds of partitions on disk for faster cold start",
+							 NULL,
+							 &pg_pathman_enable_bounds_snapshot,
+							 false,
+							 PGC_SUSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+}
+
+
+/*
+ * Fetch snapshot of 'prel' matching current catalogs, return NULL if it's
+ * missing, broken or outdated. Current 'stamp' is returned anyway.
+ */
+const BoundsSnapshot *
+read_bounds_snapshot(const PartRelationInfo *prel,
+					 const Oid *partitions,
+					 uint32 parts_count,
+					 BoundsSnapshotStamp *stamp)
+{
+	BoundsSnapshotCacheEntry   *cache_entry = NULL;
+	BoundsSnapshot			   *snapshot;
+
+	get_snapshot_stamp(PrelParentRelid(prel), partitions, parts_count, stamp);
+
+	/* Parent has been dropped concurrently */
+	if (!TransactionIdIsValid(stamp->parent_xmin))
+		return NULL;
+
+	/* Maybe we've already read (or written) this snapshot */
+	if (snapshot_cache)
+		cache_entry = hash_search(snapshot_cache,
+								  (const void *) &PrelParentRelid(prel),
+								  HASH_FIND, NULL);
+
+	if (cache_entry &&
+		snapshot_stamps_equal(&cache_entry->snapshot->stamp, stamp))
+		return cache_entry->snapshot;
+
+	/* Some other backend might have saved a fresh one */
+	snapshot = load_bounds_snapshot(prel);
+
+	if (snapshot && !snapshot_stamps_equal(&snapshot->stamp, stamp))
+	{
+		MemoryContextDelete(snapshot->mcxt);
+		snapshot = NULL;
+	}
+
+	cache_bounds_snapshot(PrelParentRelid(prel), snapshot);
+
+	return snapshot;
+}
+
+/*
+ * Replace snapshot of 'prel'. This is just a cache, so we don't emit ERROR.
+ */
+void
+write_bounds_snapshot(const PartRelationInfo *prel,
+					  const BoundsSnapshotEntry *entries,
+					  uint32 nentries,
+					  const BoundsSnapshotStamp *stamp)
+{
+	char					path[MAXPGPATH],
+							tmppath[MAXPGPATH];
+	FILE				   *file;
+	StringInfoData			buf;
+	BoundsSnapshotHeader	header;
+	pg_crc32c				crc;
+	uint32					i;
+
+	/* Parent has been dropped concurrently */
+	if (!TransactionIdIsValid(stamp->parent_xmin))
+		return;
+
+	memset(&header, 0, sizeof(header));
+
+	initStringInfo(&buf);
+
+	header.magic		= BOUNDS_SNAPSHOT_MAGIC;
+	header.version		= BOUNDS_SNAPSHOT_VERSION;
+	header.parent_relid	= PrelParentRelid(prel);
+	header.stamp		= *stamp;
+	header.parttype		= prel->parttype;
+	header.ev_type		= prel->ev_type;
+	header.ev_len		= prel->ev_len;
+	header.ev_byval		= prel->ev_byval;
+	header.nentries		= nentries;
+
+	append_aligned(&buf, &header, sizeof(header));
+
+	for (i = 0; i < nentries; i++)
+	{
+		BoundsSnapshotRecord record;
+
+		memset(&record, 0, sizeof(record));
+		record.child_relid	= entries[i].child_relid;
+		record.part_idx		= entries[i].part_idx;
+
+		if (prel->parttype == PT_RANGE)
+		{
+			record.min_infinite = entries[i].range_min.is_infinite;
+			record.max_infinite = entries[i].range_max.is_infinite;
+		}
+		else
+		{
+			record.min_infinite = MINUS_INFINITY;
+			record.max_infinite = PLUS_INFINITY;
+		}
+
+		append_aligned(&buf, &record, sizeof(record));
+
+		if (prel->parttype == PT_RANGE)
+		{
+			write_bound(&buf, &entries[i].range_min, prel);
+			write_bound(&buf, &entries[i].range_max, prel);
+		}
+	}
+
+	INIT_CRC32C(crc);
+	COMP_CRC32C(crc, buf.data, buf.len);
+	FIN_CRC32C(crc);
+
+	appendBinaryStringInfo(&buf, (char *) &crc, sizeof(crc));
+
+	/* Next rebuild of 'prel' won't have to read this file */
+	cache_bounds_snapshot(PrelParentRelid(prel),
+						  parse_bounds_snapshot(buf.data, buf.len, prel));
+
+	/* Create directory for snapshots if needed */
+#if PG_VERSION_NUM >= 110000
+	(void) MakePGDirectory(BOUNDS_SNAPSHOT_DIR);
+#else
+	(void) mkdir(BOUNDS_SNAPSHOT_DIR, S_IRWXU);
+#endif
+
+	bounds_snapshot_path(path, PrelParentRelid(prel));
+	snprintf(tmppath, MAXPGPATH, "%s.%d.tmp", path, MyProcPid);
+
+	if ((file = AllocateFile(tmppath, PG_BINARY_W)) == NULL)
+	{
+		ereport(LOG,
+				(errcode_for_file_access(),
+				 errmsg("could not open bounds snapshot \"%s\": %m", tmppath)));
+		pfree(buf.data);
+		return;
+	}
+
+	if (fwrite(buf.data, 1, buf.len, file) != (size_t) buf.len)
+	{
+		ereport(LOG,
+				(errcode_for_file_access(),
+				 errmsg("could not write bounds snapshot \"%s\": %m", tmppath)));
+		FreeFile(file);
+		unlink(tmppath);
+		pfree(buf.data);
+		return;
+	}
+
+	if (FreeFile(file) != 0)
+	{
+		ereport(LOG,
+				(errcode_for_file_access(),
+				 errmsg("could not close bounds snapshot \"%s\": %m", tmppath)));
+		unlink(tmppath);
+		pfree(buf.data);
+		return;
+	}
+
+	/* Readers will see either old or new snapshot */
+	if (rename(tmppath, path) < 0)
+	{
+		ereport(LOG,
+				(errcode_for_file_access(),
+				 errmsg("could not rename bounds snapshot \"%s\" to \"%s\": %m",
+						tmppath, path)));
+		unlink(tmppath);
+	}
+
+	pfree(buf.data);
+}
+
+/*
+ * Remove snapshot of a parent which is no longer partitioned.
+ */
+void
+remove_bounds_snapshot(Oid parent_relid)
+{
+	char	path[MAXPGPATH];
+
+	cache_bounds_snapshot(parent_relid, NULL);
+
+	bounds_snapshot_path(path, parent_relid);
+
+	if (unlink(path) < 0 && errno != ENOENT)
+		ereport(LOG,
+				(errcode_for_file_access(),
+				 errmsg("could not remove bounds snapshot \"%s\": %m", path)));
+}
+
+/*
+ * Fill 'pbin' using snapshot returned by read_bounds_snapshot().
+ */
+bool
+fetch_bounds_from_snapshot(const BoundsSnapshot *snapshot,
+						   const PartRelationInfo *prel,
+						   Oid partition,
+						   PartBoundInfo *pbin)
+{
+	BoundsSnapshotEntry	   *found;
+	BoundsSnapshotEntry		key;
+
+	key.child_relid = partition;
+
+	found = bsearch((const void *) &key,
+					snapshot->entries,
+					snapshot->nentries,
+					sizeof(BoundsSnapshotEntry),
+					cmp_snapshot_entries);
+
+	/* Partition has been created after the snapshot */
+	if (!found)
+		return false;
+
+	pbin->child_relid	= partition;
+	pbin->parttype		= prel->parttype;
+	pbin->byval			= prel->ev_byval;
+	pbin->range_min		= found->range_min;
+	pbin->range_max		= found->range_max;
+	pbin->part_idx		= found->part_idx;
+
+	return true;
+}
+
+
+static void
+bounds_snapshot_path(char *path, Oid parent_relid)
+{
+	snprintf(path, MAXPGPATH, "%s/%u_%u",
+			 BOUNDS_SNAPSHOT_DIR, MyDatabaseId, parent_relid);
+}
+
+/*
+ * Take a stamp of parent's pg_class tuple and CHECK constraints of
+ * partitions. The latter are fetched by a single range scan of index.
+ * 'stamp->parent_xmin' is invalid if parent doesn't exist.
+ */
+static void
+get_snapshot_stamp(Oid parent_relid,
+				   const Oid *partitions,
+				   uint32 parts_count,
+				   BoundsSnapshotStamp *stamp)
+{
+	HeapTuple		tuple;
+	Relation		pg_constraint_rel;
+	SysScanDesc		scan;
+	ScanKeyData		key[2];
+	Oid			   *children;
+
+	memset(stamp, 0, sizeof(BoundsSnapshotStamp));
+
+	/* Relid might be reused by another parent, so we save its identity */
+	tuple = SearchSysCache1(RELOID, ObjectIdGetDatum(parent_relid));
+	if (!HeapTupleIsValid(tuple))
+		return;
+
+	stamp->parent_xmin	= HeapTupleGetXminCompat(tuple);
+	stamp->parent_tid	= tuple->t_self;
+
+	ReleaseSysCache(tuple);
+
+	INIT_CRC32C(stamp->cons_crc);
+
+	if (parts_count > 0)
+	{
+		children = palloc(parts_count * sizeof(Oid));
+		memcpy(children, partitions, parts_count * sizeof(Oid));
+		qsort(children, parts_count, sizeof(Oid), oid_cmp);
+
+		pg_constraint_rel = heap_open(ConstraintRelationId, AccessShareLock);
+
+		ScanKeyInit(&key[0],
+					Anum_pg_constraint_conrelid,
+					BTGreaterEqualStrategyNumber, F_OIDGE,
+					ObjectIdGetDatum(children[0]));
+		ScanKeyInit(&key[1],
+					Anum_pg_constraint_conrelid,
+					BTLessEqualStrategyNumber, F_OIDLE,
+					ObjectIdGetDatum(children[parts_count - 1]));
+
+		scan = systable_beginscan(pg_constraint_rel,
+								  ConstraintRelidIndexIdCompat, true,
+								  NULL, 2, key);
+
+		while ((tuple = systable_getnext(scan)) != NULL)
+		{
+			Form_pg_constraint	con = (Form_pg_constraint) GETSTRUCT(tuple);
+			TransactionId		xmin;
+
+			/* Skip constraints of unrelated tables */
+			if (con->contype != CONSTRAINT_CHECK ||
+				!bsearch((const void *) &con->conrelid, children,
+						 parts_count, sizeof(Oid), oid_cmp))
+				continue;
+
+			xmin = HeapTupleGetXminCompat(tuple);
+
+			COMP_CRC32C(stamp->cons_crc, &con->conrelid, sizeof(Oid));
+			COMP_CRC32C(stamp->cons_crc, &xmin, sizeof(TransactionId));
+			COMP_CRC32C(stamp->cons_crc, &tuple->t_self, sizeof(ItemPointerData));
+			stamp->ncons++;
+		}
+
+		systable_endscan(scan);
+		heap_close(pg_constraint_rel, AccessShareLock);
+
+		pfree(children);
+	}
+
+	FIN_CRC32C(stamp->cons_crc);
+}
+
+static bool
+snapshot_stamps_equal(const BoundsSnapshotStamp *stamp1,
+					  const BoundsSnapshotStamp *stamp2)
+{
+	return TransactionIdEquals(stamp1->parent_xmin, stamp2->parent_xmin) &&
+		   ItemPointerEquals((ItemPointer) &stamp1->parent_tid,
+							 (ItemPointer) &stamp2->parent_tid) &&
+		   stamp1->ncons == stamp2->ncons &&
+		   EQ_CRC32C(stamp1->cons_crc, stamp2->cons_crc);
+}
+
+/* Read snapshot file of 'prel', return NULL if it's missing or broken */
+static BoundsSnapshot *
+load_bounds_snapshot(const PartRelationInfo *prel)
+{
+	char			path[MAXPGPATH];
+	FILE		   *file;
+	char		   *data;
+	long			size;
+	BoundsSnapshot *snapshot;
+
+	bounds_snapshot_path(path, PrelParentRelid(prel));
+
+	/* Snapshot doesn't exist yet */
+	if ((file = AllocateFile(path, PG_BINARY_R)) == NULL)
+		return NULL;
+
+	if (fseek(file, 0, SEEK_END) != 0 ||
+		(size = ftell(file)) < 0 ||
+		(Size) size > MaxAllocSize ||
+		fseek(file, 0, SEEK_SET) != 0)
+	{
+		FreeFile(file);
+		return NULL;
+	}
+
+	data = palloc(size);
+
+	if (fread(data, 1, size, file) != (size_t) size)
+	{
+		FreeFile(file);
+		pfree(data);
+		return NULL;
+	}
+
+	FreeFile(file);
+
+	if ((snapshot = parse_bounds_snapshot(data, size, prel)) == NULL)
+		elog(DEBUG1, "bounds snapshot \"%s\" is corrupted or outdated", path);
+
+	pfree(data);
+
+	return snapshot;
+}
+
+/* Replace cached snapshot of 'parent_relid' (NULL means forget it) */
+static void
+cache_bounds_snapshot(Oid parent_relid, BoundsSnapshot *snapshot)
+{
+	BoundsSnapshotCacheEntry   *cache_entry;
+	bool						found;
+
+	if (!snapshot_cache)
+	{
+		HASHCTL ctl;
+
+		/* Nothing to forget */
+		if (!snapshot)
+			return;
+
+		memset(&ctl, 0, sizeof(ctl));
+		ctl.keysize = sizeof(Oid);
+		ctl.entrysize = sizeof(BoundsSnapshotCacheEntry);
+		ctl.hcxt = snapshot_cache_mcxt;
+
+		snapshot_cache = hash_create("pg_pathman bounds snapshots cache",
+									 32, &ctl,
+									 HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	cache_entry = hash_search(snapshot_cache,
+							  (const void *) &parent_relid,
+							  snapshot ? HASH_ENTER : HASH_FIND,
+							  &found);
+
+	if (found)
+		MemoryContextDelete(cache_entry->snapshot->mcxt);
+
+	if (snapshot)
+		cache_entry->snapshot = snapshot;
+
+	else if (found)
+		hash_search(snapshot_cache,
+					(const void *) &parent_relid,
+					HASH_REMOVE, NULL);
+}
+
+/* Parse snapshot into a new memory context, return NULL if it's broken */
+static BoundsSnapshot *
+parse_bounds_snapshot(const char *raw_data, Size size,
+					  const PartRelationInfo *prel)
+{
+	BoundsSnapshotHeader   *header;
+	BoundsSnapshot		   *snapshot;
+	MemoryContext			snapshot_mcxt,
+							old_mcxt;
+	char				   *data;
+	pg_crc32c				crc,
+							saved_crc;
+	Size					offset;
+	uint32					i;
+
+	if (size < MAXALIGN(sizeof(BoundsSnapshotHeader)) + sizeof(pg_crc32c))
+		return NULL;
+
+	/* Strip checksum */
+	size -= sizeof(pg_crc32c);
+	memcpy(&saved_crc, raw_data + size, sizeof(pg_crc32c));
+
+	INIT_CRC32C(crc);
+	COMP_CRC32C(crc, raw_data, size);
+	FIN_CRC32C(crc);
+
+	if (!EQ_CRC32C(crc, saved_crc))
+		return NULL;
+
+	if (!snapshot_cache_mcxt)
+		snapshot_cache_mcxt = AllocSetContextCreate(TopMemoryContext,
+													CppAsString(snapshot_cache),
+													ALLOCSET_DEFAULT_SIZES);
+
+	snapshot_mcxt = AllocSetContextCreate(snapshot_cache_mcxt,
+										  CppAsString(parse_bounds_snapshot),
+										  ALLOCSET_SMALL_SIZES);
+	old_mcxt = MemoryContextSwitchTo(snapshot_mcxt);
+
+	/* Values of bounds will point to this MAXALIGN'ed buffer */
+	data = palloc(size);
+	memcpy(data, raw_data, size);
+
+	header = (BoundsSnapshotHeader *) data;
+
+	/* Partitioning scheme might have changed */
+	if (header->magic != BOUNDS_SNAPSHOT_MAGIC ||
+		header->version != BOUNDS_SNAPSHOT_VERSION ||
+		header->parent_relid != PrelParentRelid(prel) ||
+		header->parttype != prel->parttype ||
+		header->ev_type != prel->ev_type ||
+		header->ev_len != prel->ev_len ||
+		header->ev_byval != prel->ev_byval ||
+		header->nentries > size / MAXALIGN(sizeof(BoundsSnapshotRecord)))
+		goto parse_failed;
+
+	snapshot = palloc(sizeof(BoundsSnapshot));
+	snapshot->stamp = header->stamp;
+	snapshot->nentries = header->nentries;
+	snapshot->entries = palloc0(Max(header->nentries, 1) *
+								sizeof(BoundsSnapshotEntry));
+	snapshot->data = data;
+	snapshot->mcxt = snapshot_mcxt;
+
+	offset = MAXALIGN(sizeof(BoundsSnapshotHeader));
+	for (i = 0; i < snapshot->nentries; i++)
+	{
+		BoundsSnapshotEntry	   *entry = &snapshot->entries[i];
+		BoundsSnapshotRecord	record;
+
+		if (MAXALIGN(sizeof(BoundsSnapshotRecord)) > size - offset)
+			goto parse_failed;
+
+		memcpy(&record, data + offset, sizeof(BoundsSnapshotRecord));
+		offset += MAXALIGN(sizeof(BoundsSnapshotRecord));
+
+		entry->child_relid	= record.child_relid;
+		entry->part_idx		= record.part_idx;
+
+		if (!read_bound(data, size, &offset, record.min_infinite,
+						prel, &entry->range_min) ||
+			!read_bound(data, size, &offset, record.max_infinite,
+						prel, &entry->range_max))
+			goto parse_failed;
+	}
+
+	/* Prepare entries for bsearch() */
+	qsort(snapshot->entries, snapshot->nentries,
+		  sizeof(BoundsSnapshotEntry), cmp_snapshot_entries);
+
+	MemoryContextSwitchTo(old_mcxt);
+
+	return snapshot;
+
+parse_failed:
+	MemoryContextSwitchTo(old_mcxt);
+	MemoryContextDelete(snapshot_mcxt);
+
+	return NULL;
+}
+
+static bool
+read_bound(char *data, Size size, Size *offset,
+		   int8 infinite, const PartRelationInfo *prel,
+		   Bound *bound)
+{
+	uint32	len;
+	char   *value;
+
+	if (infinite != FINITE)
+	{
+		if (infinite != MINUS_INFINITY && infinite != PLUS_INFINITY)
+			return false;
+
+		*bound = MakeBoundInf(infinite);
+		return true;
+	}
+
+	if (MAXALIGN(sizeof(uint32)) > size - *offset)
+		return false;
+
+	memcpy(&len, data + *offset, sizeof(uint32));
+	*offset += MAXALIGN(sizeof(uint32));
+
+	if (MAXALIGN(len) > size - *offset)
+		return false;
+
+	value = data + *offset;
+	*offset += MAXALIGN(len);
+
+	if (prel->ev_byval)
+	{
+		Datum datum;
+
+		if (len != sizeof(Datum))
+			return false;
+
+		memcpy(&datum, value, sizeof(Datum));
+		*bound = MakeBound(datum);
+	}
+	else
+	{
+		/* Check that size of value is sane */
+		if (len != datumGetSize(PointerGetDatum(value), false, prel->ev_len))
+			return false;
+
+		/* Snapshot's buffer is MAXALIGN'ed */
+		*bound = MakeBound(PointerGetDatum(value));
+	}
+
+	return true;
+}
+
+static void
+write_bound(StringInfo buf, const Bound *bound, const PartRelationInfo *prel)
+{
+	uint32	len;
+
+	if (IsInfinite(bound))
+		return;
+
+	if (prel->ev_byval)
+	{
+		len = sizeof(Datum);
+		append_aligned(buf, &len, sizeof(uint32));
+		append_aligned(buf, &bound->value, sizeof(Datum));
+	}
+	else
+	{
+		len = datumGetSize(BoundGetValue(bound), false, prel->ev_len);
+		append_aligned(buf, &len, sizeof(uint32));
+		append_aligned(buf, DatumGetPointer(BoundGetValue(bound)), len);
+	}
+}
+
+static void
+append_aligned(StringInfo buf, const void *data, int len)
+{
+	appendBinaryStringInfo(buf, (const char *) data, len);
+
+	/* Pad with zeros */
+	while (buf->len % MAXIMUM_ALIGNOF != 0)
+		appendStringInfoChar(buf, '\0');
+}
+
+/* qsort() & bsearch() comparison function for BoundsSnapshotEntries */
+static int
+cmp_snapshot_entries(const void *p1, const void *p2)
+{
+	const BoundsSnapshotEntry  *e1 = (const BoundsSnapshotEntry *) p1;
+	const BoundsSnapshotEntry  *e2 = (const BoundsSnapshotEntry *) p2;
+
+	if (e1->child_relid < e2->child_relid)
+		return -1;
+
+	if (e1->child_relid > e2->child_relid)
+		return 1;
+
+	return 0;
+}
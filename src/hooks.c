@@ -22,10 +22,12 @@
 #include "init.h"
 #include "partition_filter.h"
 #include "partition_router.h"
+#include "partitionwise.h"
 #include "pathman_workers.h"
 #include "planner_tree_modification.h"
 #include "runtime_append.h"
 #include "runtime_merge_append.h"
+#include "shared_cache.h"
 #include "utility_stmt_hooking.h"
 #include "utils.h"
 #include "xact_handling.h"
@@ -74,6 +76,9 @@ planner_hook_type				pathman_planner_hook_next				= NULL;
 post_parse_analyze_hook_type	pathman_post_parse_analyze_hook_next	= NULL;
 shmem_startup_hook_type			pathman_shmem_startup_hook_next			= NULL;
 ProcessUtility_hook_type		pathman_process_utility_hook_next		= NULL;
+#ifdef PATHMAN_PARTITIONWISE_AGGREGATE
+create_upper_paths_hook_type	pathman_create_upper_paths_hook_next	= NULL;
+#endif
 
 
 /* Take care of joins */
@@ -94,6 +99,8 @@ pathman_join_pathlist_hook(PlannerInfo *root,
 	WalkerContext			context;
 	double					paramsel;
 	Node				   *part_expr;
+	MemoryContext			pruning_mcxt,
+							old_mcxt;
 	ListCell			   *lc;
 
 	/* Call hooks set by other extensions */
@@ -101,6 +108,13 @@ pathman_join_pathlist_hook(PlannerInfo *root,
 		pathman_set_join_pathlist_next(root, joinrel, outerrel,
 									   innerrel, jointype, extra);
 
+#ifdef PATHMAN_PARTITIONWISE_JOIN
+	/* Join partitions pair by pair if tables are partitioned alike */
+	if (IsPathmanReady())
+		try_partitionwise_join_paths(root, joinrel, outerrel,
+									 innerrel, jointype, extra);
+#endif
+
 	/* Check that both pg_pathman & RuntimeAppend nodes are enabled */
 	if (!IsPathmanReady() || !pg_pathman_enable_runtimeappend)
 		return;
@@ -188,6 +202,10 @@ pathman_join_pathlist_hook(PlannerInfo *root,
 	/* Make copy of partitioning expression and fix Var's  varno attributes */
 	part_expr = PrelExpressionForRelid(inner_prel, innerrel->relid);
 
+	/* We only need selectivity, so wrappers can be released right away */
+	pruning_mcxt = pruning_mcxt_create();
+	old_mcxt = MemoryContextSwitchTo(pruning_mcxt);
+
 	paramsel = 1.0;
 	foreach (lc, joinclauses)
 	{
@@ -198,6 +216,9 @@ pathman_join_pathlist_hook(PlannerInfo *root,
 		paramsel *= wrap->paramsel;
 	}
 
+	MemoryContextSwitchTo(old_mcxt);
+	pruning_mcxt_delete(pruning_mcxt);
+
 	foreach (lc, innerrel->pathlist)
 	{
 		AppendPath	   *cur_inner_path = (AppendPath *) lfirst(lc);
@@ -326,6 +347,8 @@ pathman_rel_pathlist_hook(PlannerInfo *root,
 	WalkerContext		context;
 	Node			   *part_expr;
 	List			   *part_clauses;
+	MemoryContext		pruning_mcxt,
+						old_mcxt;
 	ListCell		   *lc;
 	int					irange_len,
 						i;
@@ -430,7 +453,8 @@ pathman_rel_pathlist_hook(PlannerInfo *root,
 	/* Get partitioning-related clauses (do this before append_child_relation()) */
 	part_clauses = get_partitioning_clauses(rel->baserestrictinfo, prel, rti);
 
-	if (prel->parttype == PT_RANGE)
+	/* Parent may contain any values, so it can't be a part of ordered Append */
+	if (prel->parttype == PT_RANGE && !prel->enable_parent)
 	{
 		/*
 		 * Get pathkeys for ascending and descending sort by partitioned column.
@@ -453,6 +477,11 @@ pathman_rel_pathlist_hook(PlannerInfo *root,
 	}
 
 	children = PrelGetChildrenArray(prel);
+
+	/* Wrappers & rangesets are only needed until paths are built */
+	pruning_mcxt = pruning_mcxt_create();
+	old_mcxt = MemoryContextSwitchTo(pruning_mcxt);
+
 	ranges = list_make1_irange_full(prel, IR_COMPLETE);
 
 	/* Make wrappers over restrictions and collect final rangeset */
@@ -470,6 +499,8 @@ pathman_rel_pathlist_hook(PlannerInfo *root,
 		ranges = irange_list_intersection(ranges, wrap->rangeset);
 	}
 
+	MemoryContextSwitchTo(old_mcxt);
+
 	/* Get number of selected partitions */
 	irange_len = irange_list_length(ranges);
 	if (prel->enable_parent)
@@ -553,17 +584,17 @@ pathman_rel_pathlist_hook(PlannerInfo *root,
 	set_append_rel_pathlist(root, rel, rti, pathkeyAsc, pathkeyDesc);
 	set_append_rel_size_compat(root, rel, rti);
 
-	/* consider gathering partial paths for the parent appendrel */
-	generate_gather_paths_compat(root, rel);
+	/* Children have copied their quals, release pruning results */
+	pruning_mcxt_delete(pruning_mcxt);
 
 	/* Skip if both custom nodes are disabled */
 	if (!(pg_pathman_enable_runtimeappend ||
 		  pg_pathman_enable_runtime_merge_append))
-		goto cleanup;
+		goto gather;
 
 	/* Skip if there's no PARAMs in partitioning-related clauses */
 	if (!clause_contains_params((Node *) part_clauses))
-		goto cleanup;
+		goto gather;
 
 	/* Generate Runtime[Merge]Append paths if needed */
 	foreach (lc, rel->pathlist)
@@ -603,11 +634,72 @@ pathman_rel_pathlist_hook(PlannerInfo *root,
 			add_path(rel, inner_path);
 	}
 
+#if PG_VERSION_NUM >= 110000
+	/*
+	 * Generate partial RuntimeAppend paths. They can't be parameterized,
+	 * so unlike the paths above they only use restrictions of this rel
+	 * and don't care about its join clauses.
+	 */
+	if (pg_pathman_enable_runtimeappend)
+	{
+		List *partial_paths = NIL;
+
+		foreach (lc, rel->partial_pathlist)
+		{
+			AppendPath	   *cur_path = (AppendPath *) lfirst(lc);
+			Path		   *inner_path;
+
+			if (!IsA(cur_path, AppendPath))
+				continue;
+
+			inner_path = create_runtime_append_path(root, cur_path,
+													NULL, paramsel);
+			if (inner_path)
+				partial_paths = lappend(partial_paths, inner_path);
+		}
+
+		/* add_partial_path() might free paths of 'partial_pathlist' */
+		foreach (lc, partial_paths)
+			add_partial_path(rel, (Path *) lfirst(lc));
+
+		list_free(partial_paths);
+	}
+#endif
+
+gather:
+	/* consider gathering partial paths for the parent appendrel */
+	generate_gather_paths_compat(root, rel);
+
 cleanup:
 	/* Don't forget to close 'prel'! */
 	close_pathman_relation_info(prel);
 }
 
+#ifdef PATHMAN_PARTITIONWISE_AGGREGATE
+/* Take care of aggregation */
+void
+pathman_create_upper_paths_hook(PlannerInfo *root,
+								UpperRelationKind stage,
+								RelOptInfo *input_rel,
+								RelOptInfo *output_rel,
+								void *extra)
+{
+	/* Invoke original hook if needed */
+	if (pathman_create_upper_paths_hook_next)
+		pathman_create_upper_paths_hook_next(root, stage, input_rel,
+											 output_rel, extra);
+
+	/* Make sure that pg_pathman is ready */
+	if (!IsPathmanReady())
+		return;
+
+	/* Aggregate partitions one by one if possible */
+	if (stage == UPPERREL_GROUP_AGG && extra)
+		try_partitionwise_grouping_paths(root, input_rel, output_rel,
+										 (GroupPathExtraData *) extra);
+}
+#endif
+
 /*
  * Intercept 'pg_pathman.enable' GUC assignments.
  */
@@ -690,6 +782,10 @@ pathman_planner_hook(Query *parse, int cursorOptions, ParamListInfo boundParams)
 			/* Increase planner() calls count */
 			incr_planner_calls_count();
 
+			/* Collect pruning stats for the top-level planner() call */
+			if (get_planner_calls_count() == 1)
+				pruning_stats_reset();
+
 			/* Modify query tree if needed */
 			pathman_transform_query(parse, boundParams);
 		}
@@ -708,6 +804,9 @@ pathman_planner_hook(Query *parse, int cursorOptions, ParamListInfo boundParams)
 			/* Add PartitionRouter node for UPDATE queries */
 			execute_for_plantree(result, add_partition_routers);
 
+			if (get_planner_calls_count() == 1)
+				pruning_stats_report();
+
 			/* Decrement planner() calls count */
 			decr_planner_calls_count();
 
@@ -870,6 +969,8 @@ pathman_shmem_startup_hook(void)
 	/* Allocate shared memory objects */
 	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
 	init_concurrent_part_task_slots();
+	init_spawn_pool();
+	init_shared_cache();
 	LWLockRelease(AddinShmemInitLock);
 }
 
@@ -881,6 +982,9 @@ pathman_relcache_hook(Datum arg, Oid relid)
 {
 	Oid pathman_config_relid;
 
+	/* Cached pruning results of RuntimeAppend might be stale now */
+	forget_prune_cache_of_rel(relid);
+
 	/* See cook_partitioning_expression() */
 	if (!pathman_hooks_enabled)
 		return;
@@ -0,0 +1,92 @@
+/* ------------------------------------------------------------------------
+ *
+ * bounds_snapshot.h
+ *		Persistent snapshots of partitions' bounds
+ *
+ * Copyright (c) 2020, Postgres Professional
+ *
+ * ------------------------------------------------------------------------
+ */
+
+#ifndef BOUNDS_SNAPSHOT_H
+#define BOUNDS_SNAPSHOT_H
+
+
+#include "relation_info.h"
+
+#include "postgres.h"
+#include "port/pg_crc32c.h"
+#include "storage/itemptr.h"
+
+
+/* Snapshots are stored in this subdirectory of PGDATA */
+#define BOUNDS_SNAPSHOT_DIR			"pg_pathman"
+
+#define BOUNDS_SNAPSHOT_MAGIC		0x50504253	/* "PPBS" */
+#define BOUNDS_SNAPSHOT_VERSION		3
+
+
+/*
+ * Identity of partitioning as stored in catalogs. Any change of parent's
+ * pg_class entry or of CHECK constraints of partitions produces new
+ * tuples, thus a new stamp.
+ */
+typedef struct
+{
+	TransactionId	parent_xmin;	/* xmin of parent's pg_class tuple */
+	ItemPointerData	parent_tid;		/* ctid of parent's pg_class tuple */
+	uint32			ncons;			/* number of partitions' CHECK constraints */
+	pg_crc32c		cons_crc;		/* CRC of their conrelids, xmins & ctids */
+} BoundsSnapshotStamp;
+
+/*
+ * Bounds (or hash index) of a single partition.
+ */
+typedef struct
+{
+	Oid				child_relid;
+
+	/* For RANGE partitions */
+	Bound			range_min;
+	Bound			range_max;
+
+	/* For HASH partitions */
+	uint32			part_idx;
+} BoundsSnapshotEntry;
+
+/*
+ * Contents of a snapshot file, cached by backend.
+ */
+typedef struct
+{
+	BoundsSnapshotStamp stamp;
+	uint32			nentries;
+	BoundsSnapshotEntry *entries;	/* sorted by child relid */
+	char		   *data;			/* raw file contents */
+	MemoryContext	mcxt;			/* storage for all of the above */
+} BoundsSnapshot;
+
+
+/* For pg_pathman.enable_bounds_snapshot GUC */
+extern bool		pg_pathman_enable_bounds_snapshot;
+
+
+void init_bounds_snapshot_static_data(void);
+
+const BoundsSnapshot *read_bounds_snapshot(const PartRelationInfo *prel,
+										   const Oid *partitions,
+										   uint32 parts_count,
+										   BoundsSnapshotStamp *stamp);
+void write_bounds_snapshot(const PartRelationInfo *prel,
+						   const BoundsSnapshotEntry *entries,
+						   uint32 nentries,
+						   const BoundsSnapshotStamp *stamp);
+void remove_bounds_snapshot(Oid parent_relid);
+
+bool fetch_bounds_from_snapshot(const BoundsSnapshot *snapshot,
+								const PartRelationInfo *prel,
+								Oid partition,
+								PartBoundInfo *pbin);
+
+
+#endif /* BOUNDS_SNAPSHOT_H */
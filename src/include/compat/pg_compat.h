@@ -805,6 +805,21 @@ extern AttrNumber *convert_tuples_by_name_map(TupleDesc indesc,
 #endif
 
 
+/*
+ * RequestNamedLWLockTranche()
+ */
+#if PG_VERSION_NUM >= 90600
+#define RequestPathmanLWLocks(tranche, n) \
+	RequestNamedLWLockTranche((tranche), (n))
+#define GetPathmanLWLocks(tranche) \
+	( &(GetNamedLWLockTranche(tranche))->lock )
+#else
+#define RequestPathmanLWLocks(tranche, n) \
+	RequestAddinLWLocks(n)
+#define GetPathmanLWLocks(tranche) \
+	LWLockAssign()
+#endif
+
 /*
  * RegisterCustomScanMethods()
  */
@@ -837,6 +852,28 @@ extern AttrNumber *convert_tuples_by_name_map(TupleDesc indesc,
 	BackgroundWorkerInitializeConnectionByOid((dboid), (useroid))
 #endif
 
+/*
+ * BackgroundWorkerInitializeConnection()
+ */
+#if PG_VERSION_NUM >= 110000
+#define BackgroundWorkerInitializeConnectionCompat(dbname, username) \
+	BackgroundWorkerInitializeConnection((dbname), (username), 0)
+#else
+#define BackgroundWorkerInitializeConnectionCompat(dbname, username) \
+	BackgroundWorkerInitializeConnection((dbname), (username))
+#endif
+
+/*
+ * WaitLatch()
+ */
+#if PG_VERSION_NUM >= 100000
+#define WaitLatchCompat(latch, events, timeout) \
+	WaitLatch((latch), (events), (timeout), PG_WAIT_EXTENSION)
+#else
+#define WaitLatchCompat(latch, events, timeout) \
+	WaitLatch((latch), (events), (timeout))
+#endif
+
 /*
  * heap_delete()
  */
@@ -952,6 +989,28 @@ extern AttrNumber *convert_tuples_by_name_map(TupleDesc indesc,
 	NextCopyFrom((cstate), (econtext), (values), (nulls), (tupleOid))
 #endif
 
+/*
+ * ExplainPropertyInteger()
+ */
+#if PG_VERSION_NUM >= 110000
+#define ExplainPropertyIntegerCompat(qlabel, unit, value, es) \
+	ExplainPropertyInteger((qlabel), (unit), (value), (es))
+#else
+#define ExplainPropertyIntegerCompat(qlabel, unit, value, es) \
+	ExplainPropertyLong((qlabel), (long) (value), (es))
+#endif
+
+/*
+ * heap_multi_insert(). Since 12 it's table_multi_insert() which accepts slots.
+ */
+#if PG_VERSION_NUM >= 120000
+#define MultiInsertCompat(rel, slots, tuples, ntuples, cid, options, bistate) \
+	table_multi_insert((rel), (slots), (ntuples), (cid), (options), (bistate))
+#else
+#define MultiInsertCompat(rel, slots, tuples, ntuples, cid, options, bistate) \
+	heap_multi_insert((rel), (tuples), (ntuples), (cid), (options), (bistate))
+#endif
+
 /*
  * ExecInsertIndexTuples. Since 12 slot contains tupleid.
  */
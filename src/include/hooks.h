@@ -20,6 +20,8 @@
 #include "storage/ipc.h"
 #include "tcop/utility.h"
 
+#include "partitionwise.h"
+
 
 extern set_join_pathlist_hook_type		pathman_set_join_pathlist_next;
 extern set_rel_pathlist_hook_type		pathman_set_rel_pathlist_hook_next;
@@ -28,6 +30,9 @@ extern post_parse_analyze_hook_type		pathman_post_parse_analyze_hook_next;
 extern shmem_startup_hook_type			pathman_shmem_startup_hook_next;
 extern ProcessUtility_hook_type			pathman_process_utility_hook_next;
 extern ExecutorRun_hook_type			pathman_executor_run_hook_next;
+#ifdef PATHMAN_PARTITIONWISE_AGGREGATE
+extern create_upper_paths_hook_type		pathman_create_upper_paths_hook_next;
+#endif
 
 
 void pathman_join_pathlist_hook(PlannerInfo *root,
@@ -42,6 +47,14 @@ void pathman_rel_pathlist_hook(PlannerInfo *root,
 							   Index rti,
 							   RangeTblEntry *rte);
 
+#ifdef PATHMAN_PARTITIONWISE_AGGREGATE
+void pathman_create_upper_paths_hook(PlannerInfo *root,
+									 UpperRelationKind stage,
+									 RelOptInfo *input_rel,
+									 RelOptInfo *output_rel,
+									 void *extra);
+#endif
+
 void pathman_enable_assign_hook(bool newval, void *extra);
 
 PlannedStmt * pathman_planner_hook(Query *parse,
@@ -61,6 +61,7 @@ extern MemoryContext		PathmanBoundsCacheContext;
 extern HTAB				   *parents_cache;
 extern HTAB				   *status_cache;
 extern HTAB				   *bounds_cache;
+extern HTAB				   *retired_cache;
 
 /* pg_pathman's initialization state */
 extern PathmanInitState 	pathman_init_state;
@@ -73,6 +74,7 @@ extern bool					pathman_hooks_enabled;
 #define PATHMAN_PARENTS_CACHE	"partition parents cache"
 #define PATHMAN_STATUS_CACHE	"partition status cache"
 #define PATHMAN_BOUNDS_CACHE	"partition bounds cache"
+#define PATHMAN_RETIRED_CACHE	"retired partition dispatch cache"
 
 
 /* Transform pg_pathman's memory context into simple name */
@@ -157,10 +159,10 @@ simplify_mcxt_name(MemoryContext mcxt)
 
 
 /* Lowest version of Pl/PgSQL frontend compatible with internals */
-#define LOWEST_COMPATIBLE_FRONT		"1.5.0"
+#define LOWEST_COMPATIBLE_FRONT		"1.6.0"
 
 /* Current version of native C library */
-#define CURRENT_LIB_VERSION			"1.5.11"
+#define CURRENT_LIB_VERSION			"1.6.0"
 
 
 void *pathman_cache_search_relid(HTAB *cache_table,
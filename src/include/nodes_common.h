@@ -16,6 +16,7 @@
 
 #include "postgres.h"
 #include "commands/explain.h"
+#include "lib/ilist.h"
 #include "optimizer/planner.h"
 
 #if PG_VERSION_NUM >= 90600
@@ -47,10 +48,77 @@ typedef struct
 	}			content;
 
 	int			original_order;		/* for sorting in EXPLAIN */
+	bool		is_foreign;			/* is it a ForeignScan? */
 } ChildScanCommonData;
 
 typedef ChildScanCommonData *ChildScanCommon;
 
+
+/* Max number of pruning results cached per RuntimeAppend plan */
+#define RUNTIME_PRUNE_CACHE_SIZE	8
+
+/* Max number of RuntimeAppend plans having cached pruning results */
+#define RUNTIME_PRUNE_CACHE_PLANS	256
+
+/*
+ * Partitions selected by prune_append_plans() for a particular set of param values.
+ */
+typedef struct
+{
+	uint32				hash;		/* hash of param values */
+	Datum			   *values;		/* copies of param values */
+	bool			   *isnull;
+	Oid				   *parts;		/* selected partitions */
+	int					nparts;
+} RuntimePruneCacheEntry;
+
+/*
+ * Backend-local LRU cache of pruning results of a single RuntimeAppend plan,
+ * which is kept across executions of a prepared statement. Pruning clauses
+ * may only depend on params, so the same param values always select the
+ * same partitions until PartRelationInfo of 'relid' changes, which drops
+ * this cache (see forget_prune_cache_of_rel()).
+ */
+typedef struct
+{
+	uint32				plan_id;		/* key, see pack_runtimeappend_private() */
+	Oid					relid;			/* partitioned table */
+	Oid				   *children;		/* sorted Oids of plan's partitions */
+	int					nchildren;
+
+	dlist_node			lru_node;		/* position in LRU list of plans */
+	MemoryContext		mcxt;			/* storage for entries */
+
+	/* Params of pruning clauses */
+	int					nparams;
+	int16			   *param_typlen;
+	bool			   *param_typbyval;
+
+	/* Cached results, most recently used first */
+	int					nentries;
+	RuntimePruneCacheEntry entries[RUNTIME_PRUNE_CACHE_SIZE];
+} RuntimePruneCachePlan;
+
+/*
+ * Params of pruning clauses evaluated by a single execution of the plan.
+ */
+typedef struct
+{
+	uint32				plan_id;		/* see RuntimePruneCachePlan */
+	uint64				generation;		/* see forget_prune_cache_of_rel() */
+
+	/* Params of pruning clauses */
+	int					nparams;
+	ExprState		  **param_states;
+	int16			   *param_typlen;
+	bool			   *param_typbyval;
+
+	/* Values of params for current rescan */
+	Datum			   *values;
+	bool			   *isnull;
+	uint32				hash;
+} RuntimePruneCache;
+
 /*
  * Destroy exhausted plan states
  */
@@ -95,8 +163,14 @@ TupleTableSlot * exec_append_common(CustomScanState *node,
 
 void end_append_common(CustomScanState *node);
 
+void forget_prune_cache_of_rel(Oid relid);
+
 void rescan_append_common(CustomScanState *node);
 
+void prepare_plan_states(CustomScanState *node, int upto);
+
+ChildScanCommon * prune_append_plans(CustomScanState *node, int *nplans);
+
 void explain_append_common(CustomScanState *node,
 						   List *ancestors,
 						   ExplainState *es,
@@ -35,6 +35,15 @@ Oid create_single_range_partition_internal(Oid parent_relid,
 										   RangeVar *partition_rv,
 										   char *tablespace);
 
+/* Create several adjacent RANGE partitions at once */
+void create_range_partitions_bulk(Oid parent_relid,
+								  const Bound *bounds,
+								  int nparts,
+								  Oid value_type,
+								  RangeVar **partition_rvs,
+								  char **tablespaces,
+								  Oid *partition_relids);
+
 /* Create one HASH partition */
 Oid create_single_hash_partition_internal(Oid parent_relid,
 										  uint32 part_idx,
@@ -94,6 +94,14 @@ struct ResultPartsStorage
 	PartRelationInfo   *prel;
 	ExprState		   *prel_expr_state;
 	ExprContext		   *prel_econtext;
+
+	/* RANGE partition selected last time by select_partition_for_insert() */
+	ResultRelInfoHolder *last_rri_holder;
+	uint32				last_part_idx;			/* index in 'prel' */
+	FmgrInfo			last_part_cmp;			/* compares bounds of 'prel' */
+
+	uint64				last_part_hits,
+						last_part_misses;
 };
 
 typedef struct
@@ -109,11 +117,21 @@ typedef struct
 	CmdType				command_type;
 
 	TupleTableSlot	   *tup_convert_slot;		/* slot for rebuilt tuples */
+
+	/* Tuples routed at once (see pg_pathman.partition_filter_batch_size) */
+	int					batch_size;
+	TupleTableSlot	  **batch_slots;			/* copies of subplan's tuples */
+	ResultRelInfoHolder **batch_holders;		/* selected partitions */
+	int				   *batch_order;			/* tuples grouped by partition */
+	int					batch_count;			/* number of tuples in batch */
+	int					batch_pos;				/* next tuple to be emitted */
+	bool				batch_eof;				/* is subplan exhausted? */
 } PartitionFilterState;
 
 
 extern bool					pg_pathman_enable_partition_filter;
 extern int					pg_pathman_insert_into_fdw;
+extern int					pg_pathman_partition_filter_batch_size;
 
 extern CustomScanMethods	partition_filter_plan_methods;
 extern CustomExecMethods	partition_filter_exec_methods;
@@ -178,6 +196,15 @@ Oid * find_partitions_for_value(Datum value, Oid value_type,
 ResultRelInfoHolder *select_partition_for_insert(ResultPartsStorage *parts_storage,
 												 TupleTableSlot *slot);
 
+/* Batch versions of the functions above */
+void find_partition_indices_for_values(const Datum *values, int nvalues,
+									   const PartRelationInfo *prel,
+									   int *indices);
+
+void select_partitions_for_insert(ResultPartsStorage *parts_storage,
+								  TupleTableSlot **slots, int nslots,
+								  ResultRelInfoHolder **results);
+
 Plan * make_partition_filter(Plan *subplan,
 							 Oid parent_relid,
 							 Index parent_rti,
@@ -0,0 +1,29 @@
+/* ------------------------------------------------------------------------
+ *
+ * partition_mover.h
+ *		Move rows from parent table to its partitions
+ *
+ * Copyright (c) 2020, Postgres Professional
+ *
+ * ------------------------------------------------------------------------
+ */
+
+#ifndef PARTITION_MOVER_H
+#define PARTITION_MOVER_H
+
+
+#include "postgres.h"
+#include "storage/block.h"
+
+
+bool can_move_parent_rows(Oid parent_relid);
+
+int64 move_parent_rows(Oid parent_relid,
+					   const Datum *min_value,
+					   const Datum *max_value,
+					   int limit,
+					   BlockNumber *start_block,
+					   int64 *bytes);
+
+
+#endif /* PARTITION_MOVER_H */
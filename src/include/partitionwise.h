@@ -0,0 +1,37 @@
+/* ------------------------------------------------------------------------
+ *
+ * partitionwise.h
+ *		Partition-wise joins and aggregation of relations partitioned by pg_pathman
+ *
+ * Copyright (c) 2020, Postgres Professional
+ *
+ * ------------------------------------------------------------------------
+ */
+
+#ifndef PARTITIONWISE_H
+#define PARTITIONWISE_H
+
+
+#include "compat/pg_compat.h"
+
+#include "postgres.h"
+#include "optimizer/paths.h"
+
+
+#if PG_VERSION_NUM >= 120000
+#define PATHMAN_PARTITIONWISE_JOIN
+#define PATHMAN_PARTITIONWISE_AGGREGATE
+#endif
+
+
+#ifdef PATHMAN_PARTITIONWISE_JOIN
+void try_partitionwise_join_paths(PlannerInfo *root,
+								  RelOptInfo *joinrel,
+								  RelOptInfo *outerrel,
+								  RelOptInfo *innerrel,
+								  JoinType jointype,
+								  JoinPathExtraData *extra);
+#endif
+
+
+#endif /* PARTITIONWISE_H */
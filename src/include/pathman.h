@@ -167,12 +167,23 @@ typedef struct
 /* Examine expression in order to select partitions */
 WrapperNode *walk_expr_tree(Expr *expr, const WalkerContext *context);
 
+/*
+ * Planning-time pruning runs in a short-lived memory context
+ * which is released in one shot once partitions are selected.
+ */
+MemoryContext pruning_mcxt_create(void);
+void pruning_mcxt_delete(MemoryContext pruning_mcxt);
+
+void pruning_stats_reset(void);
+void pruning_stats_report(void);
+
 
 void select_range_partitions(const Datum value,
 							 const Oid collid,
 							 FmgrInfo *cmp_func,
 							 const RangeEntry *ranges,
 							 const int nranges,
+							 const IntRangeIndex *int_ranges,
 							 const int strategy,
 							 WrapperNode *result);
 
@@ -2,10 +2,12 @@
  *
  * pathman_workers.h
  *
- *		There are two purposes of this subsystem:
+ *		There are three purposes of this subsystem:
  *
  *			* Create new partitions for INSERT in separate transaction
+ *			  (using a pool of persistent workers if possible)
  *			* Process concurrent partitioning operations
+ *			* Create future RANGE partitions in advance
  *
  *		Background worker API is used for both cases.
  *
@@ -19,6 +21,7 @@
 
 
 #include "postgres.h"
+#include "storage/lwlock.h"
 #include "storage/spin.h"
 
 #if PG_VERSION_NUM >= 90600
@@ -53,6 +56,83 @@ typedef struct
 } SpawnPartitionArgs;
 
 
+/*
+ * Status of a request in the queue of SpawnPartitionsWorkers' pool.
+ */
+typedef enum
+{
+	SPR_FREE = 0,	/* entry is empty */
+	SPR_QUEUED,		/* waiting for a worker */
+	SPR_WORKING,	/* taken by a worker */
+	SPR_DONE,		/* result is ready */
+	SPR_ABANDONED	/* there are no workers to process it */
+} SpawnRequestStatus;
+
+/* Larger values are passed to a dedicated SpawnPartitionsWorker */
+#define SPAWN_REQUEST_MAX_VALUE_SIZE	64
+
+/* Max number of backends waiting for a single request */
+#define SPAWN_REQUEST_MAX_WAITERS		16
+
+/* Size of the queue of SpawnPartitionsWorkers' pool */
+#define SPAWN_POOL_QUEUE_SIZE			128
+
+/*
+ * Request to create partitions for 'value', shared by backends
+ * which are waiting for partitions of the same table.
+ */
+typedef struct
+{
+	SpawnRequestStatus status;
+
+	Oid		userid;			/* worker should connect as this user */
+	Oid		dbid;			/* database which stores 'partitioned_table' */
+	Oid		partitioned_table;
+	Oid		result;			/* target partition */
+
+	/* Needed to decode Datum from 'value' */
+	Oid		value_type;
+	Size	value_size;
+	bool	value_byval;
+
+	/* Backends to be woken up (pgprocnos) */
+	int		nwaiters;
+	int		waiters[SPAWN_REQUEST_MAX_WAITERS];
+
+	uint8	value[SPAWN_REQUEST_MAX_VALUE_SIZE];
+} SpawnRequest;
+
+typedef enum
+{
+	SPW_FREE = 0,	/* slot is empty */
+	SPW_STARTING,	/* worker has been registered */
+	SPW_IDLE,		/* waiting for requests */
+	SPW_BUSY		/* processing requests (or woken up) */
+} SpawnWorkerStatus;
+
+/*
+ * Persistent worker serving requests of a single database & user.
+ */
+typedef struct
+{
+	SpawnWorkerStatus status;
+
+	Oid		userid;			/* worker is connected as this user */
+	Oid		dbid;			/* database served by this worker */
+	int		pgprocno;		/* worker's PGPROC or -1 */
+	int		request;		/* request being processed or -1 */
+	uint32	generation;		/* bumped each time slot is taken */
+} SpawnWorkerSlot;
+
+typedef struct
+{
+	LWLock		   *lock;	/* protects everything below */
+
+	SpawnRequest	requests[SPAWN_POOL_QUEUE_SIZE];
+	SpawnWorkerSlot	workers[FLEXIBLE_ARRAY_MEMBER];
+} SpawnPool;
+
+
 typedef enum
 {
 	CPS_FREE = 0,	/* slot is empty */
@@ -61,6 +141,9 @@ typedef enum
 
 } ConcurrentPartSlotStatus;
 
+/* Larger bounds can't be used to split a task between workers */
+#define CONCURRENT_PART_MAX_BOUND_SIZE	64
+
 /*
  * Store args and execution status of a single ConcurrentPartWorker.
  */
@@ -78,6 +161,29 @@ typedef struct
 
 	int32	batch_size;		/* number of rows in a batch */
 	float8	sleep_time;		/* how long should we sleep in case of error? */
+	bool	native_mover;	/* move rows without SPI if possible */
+
+	/* Batch size might be adapted to load (see pg_pathman.concurrent_part_*) */
+	int32	batch_time;		/* target duration of a batch (ms), 0 disables */
+	float8	duty_cycle;		/* max share of time spent moving rows */
+
+	/* Recent throughput of this worker */
+	float8	rows_per_sec;
+	float8	bytes_per_sec;
+
+	/* Task might be split between several workers */
+	int32	part_worker;	/* number of worker within the task (0 is leader) */
+	int32	leader_slot;	/* slot of leader (accumulates total_rows) */
+
+	/* Range of partitioning expression assigned to this worker */
+	bool	has_min;
+	bool	has_max;
+	Oid		bound_type;
+	bool	bound_byval;
+	Size	min_size;
+	Size	max_size;
+	uint8	min_value[CONCURRENT_PART_MAX_BOUND_SIZE];
+	uint8	max_value[CONCURRENT_PART_MAX_BOUND_SIZE];
 } ConcurrentPartSlot;
 
 #define InitConcurrentPartSlot(slot, user, w_status, db, rel, batch_sz, sleep_t) \
@@ -90,6 +196,15 @@ typedef struct
 		(slot)->total_rows = 0; \
 		(slot)->batch_size = (batch_sz); \
 		(slot)->sleep_time = (sleep_t); \
+		(slot)->native_mover = false; \
+		(slot)->batch_time = 0; \
+		(slot)->duty_cycle = 1.0; \
+		(slot)->rows_per_sec = 0.0; \
+		(slot)->bytes_per_sec = 0.0; \
+		(slot)->part_worker = 0; \
+		(slot)->leader_slot = -1; \
+		(slot)->has_min = false; \
+		(slot)->has_max = false; \
 	} while (0)
 
 static inline ConcurrentPartSlotStatus
@@ -139,18 +254,24 @@ cps_print_status(ConcurrentPartSlotStatus status)
 /* Max number of attempts per batch */
 #define PART_WORKER_MAX_ATTEMPTS	60
 
+/* Limits of batch size (see partition_table_concurrently()) */
+#define PART_WORKER_MIN_BATCH_SIZE	1
+#define PART_WORKER_MAX_BATCH_SIZE	10000
+
 
 /*
  * Definitions for the "pathman_concurrent_part_tasks" view.
  */
 #define PATHMAN_CONCURRENT_PART_TASKS		"pathman_concurrent_part_tasks"
-#define Natts_pathman_cp_tasks				6
+#define Natts_pathman_cp_tasks				8
 #define Anum_pathman_cp_tasks_userid		1
 #define Anum_pathman_cp_tasks_pid			2
 #define Anum_pathman_cp_tasks_dbid			3
 #define Anum_pathman_cp_tasks_relid			4
 #define Anum_pathman_cp_tasks_processed		5
 #define Anum_pathman_cp_tasks_status		6
+#define Anum_pathman_cp_tasks_rows_per_sec	7
+#define Anum_pathman_cp_tasks_bytes_per_sec	8
 
 
 /*
@@ -159,6 +280,12 @@ cps_print_status(ConcurrentPartSlotStatus status)
 Size estimate_concurrent_part_task_slots_size(void);
 void init_concurrent_part_task_slots(void);
 
+/*
+ * SpawnPartitionsWorkers' pool is stored in shmem.
+ */
+Size estimate_spawn_pool_size(void);
+void init_spawn_pool(void);
+
 
 /*
  * Useful datum packing\unpacking functions for BGW.
@@ -214,4 +341,35 @@ UnpackDatumFromByteArray(Datum *datum, Size datum_size, bool typbyval,
 Oid create_partitions_for_value_bg_worker(Oid relid, Datum value, Oid value_type);
 
 
+/* For pg_pathman.spawn_workers GUC */
+extern int		pg_pathman_spawn_workers;
+
+#define DEFAULT_PATHMAN_SPAWN_WORKERS			2
+#define SPAWN_WORKER_IDLE_TIMEOUT				60	/* seconds */
+
+#define IsSpawnPoolEnabled()	( pg_pathman_spawn_workers > 0 )
+
+/* For pg_pathman.concurrent_part_workers GUC */
+extern int		pg_pathman_concurrent_part_workers;
+
+/* For pg_pathman.enable_native_data_mover GUC */
+extern bool		pg_pathman_enable_native_data_mover;
+
+/* For pg_pathman.concurrent_part_batch_time & duty_cycle GUCs */
+extern int		pg_pathman_concurrent_part_batch_time;
+extern double	pg_pathman_concurrent_part_duty_cycle;
+
+/* For pg_pathman.premake_* GUCs */
+extern int		pg_pathman_premake_partitions;
+extern int		pg_pathman_premake_naptime;
+extern char	   *pg_pathman_premake_databases;
+
+/* Defaults for PremakePartitionsWorker */
+#define DEFAULT_PATHMAN_PREMAKE_PARTITIONS		0	/* disabled */
+#define DEFAULT_PATHMAN_PREMAKE_NAPTIME			60	/* seconds */
+#define PREMAKE_WORKER_RESTART_TIME				10	/* seconds */
+
+void init_pathman_workers_static_data(void);
+
+
 #endif /* PATHMAN_WORKERS_H */
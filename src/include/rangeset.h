@@ -169,4 +169,41 @@ List *irange_list_set_lossiness(List *ranges, bool lossy);
 int irange_list_length(List *rangeset);
 bool irange_list_find(List *rangeset, int index, bool *lossy);
 
+
+/*
+ * IndexRangeBitmap is a dense alternative to a List of IndexRanges: it keeps
+ * one bit per partition in 'selected' and 'lossy' word arrays. Fragmented
+ * rangesets (e.g. OR-heavy quals over HASH partitions) are combined word by
+ * word instead of walking and reallocating long Lists. Lists remain the
+ * interchange format, so bitmaps are only used as a scratch representation.
+ */
+typedef struct
+{
+	uint32		nbits;		/* number of partitions */
+	uint32		nwords;		/* number of words in each bitset */
+	uint64	   *selected;	/* partitions contained in rangeset */
+	uint64	   *lossy;		/* partitions that still require quals */
+} IndexRangeBitmap;
+
+#define IRANGE_BITMAP_WORD_BITS		64
+
+/* Lists shorter than this are always cheap enough */
+#define IRANGE_BITMAP_MIN_CELLS		8
+
+#define irange_bitmap_nwords(nbits) \
+	( ((nbits) + IRANGE_BITMAP_WORD_BITS - 1) / IRANGE_BITMAP_WORD_BITS )
+
+/* Is this rangeset fragmented enough to be combined as a bitmap? */
+#define irange_list_prefer_bitmap(rangeset, nbits) \
+	( list_length(rangeset) > Max(IRANGE_BITMAP_MIN_CELLS, \
+								  irange_bitmap_nwords(nbits)) )
+
+/* Operations on IndexRangeBitmaps */
+IndexRangeBitmap *irange_bitmap_create(uint32 nbits);
+IndexRangeBitmap *irange_bitmap_from_list(List *rangeset, uint32 nbits);
+void irange_bitmap_fill(IndexRangeBitmap *bitmap, List *rangeset);
+void irange_bitmap_union(IndexRangeBitmap *a, const IndexRangeBitmap *b);
+void irange_bitmap_intersection(IndexRangeBitmap *a, const IndexRangeBitmap *b);
+List *irange_bitmap_to_list(const IndexRangeBitmap *bitmap);
+
 #endif /* PATHMAN_RANGESET_H */
@@ -17,6 +17,7 @@
 
 #include "access/attnum.h"
 #include "access/sysattr.h"
+#include "catalog/pg_type.h"
 #include "fmgr.h"
 #include "nodes/bitmapset.h"
 #include "nodes/nodes.h"
@@ -26,9 +27,11 @@
 #include "port/atomics.h"
 #include "rewrite/rewriteManip.h"
 #include "storage/lock.h"
+#include "utils/date.h"
 #include "utils/datum.h"
 #include "utils/lsyscache.h"
 #include "utils/relcache.h"
+#include "utils/timestamp.h"
 
 
 #ifdef USE_ASSERT_CHECKING
@@ -142,6 +145,129 @@ typedef struct
 					max;
 } RangeEntry;
 
+/*
+ * IntRangeIndex
+ *		Dense copy of RANGE bounds for integer-like expression types.
+ *		Lets us search for partitions without calling 'cmp_proc'.
+ *
+ * Only the first min bound and the last max bound may be infinite,
+ * since RANGE partitions are sorted and never overlap.
+ */
+typedef struct
+{
+	Oid				typid;			/* base type of bounds */
+	uint32			count;			/* number of partitions */
+	int64		   *mins;			/* min bounds (-inf is PG_INT64_MIN) */
+	int64		   *maxs;			/* max bounds (+inf is PG_INT64_MAX) */
+	bool			min_inf,		/* is min bound of the first one -inf? */
+					max_inf;		/* is max bound of the last one +inf? */
+} IntRangeIndex;
+
+static inline bool
+IntRangeIndexSupportsType(Oid typid)
+{
+	switch (typid)
+	{
+		case INT2OID:
+		case INT4OID:
+		case INT8OID:
+		case DATEOID:
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+static inline int64
+DatumGetIntRangeValue(Datum value, Oid typid)
+{
+	switch (typid)
+	{
+		case INT2OID:
+			return (int64) DatumGetInt16(value);
+
+		case INT4OID:
+			return (int64) DatumGetInt32(value);
+
+		case INT8OID:
+			return DatumGetInt64(value);
+
+		case DATEOID:
+			return (int64) DatumGetDateADT(value);
+
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+			return (int64) DatumGetTimestamp(value);
+
+		default:
+			elog(ERROR, "type %u is not supported by IntRangeIndex", typid);
+			return 0; /* keep compiler happy */
+	}
+}
+
+/* Compare 'value' to min (or max) bound of i-th partition */
+static inline int
+cmp_int_range_bound(const IntRangeIndex *index,
+					const int64 value,
+					const uint32 i,
+					const bool max)
+{
+	int64 bound;
+
+	if (max)
+	{
+		if (index->max_inf && i == index->count - 1)
+			return -1;
+
+		bound = index->maxs[i];
+	}
+	else
+	{
+		if (index->min_inf && i == 0)
+			return 1;
+
+		bound = index->mins[i];
+	}
+
+	return (value > bound) - (value < bound);
+}
+
+/* Find the last partition such that 'min' <= 'value' (or the first one) */
+static inline uint32
+int_range_index_lower(const IntRangeIndex *index, const int64 value)
+{
+	const int64	   *base = index->mins;
+	uint32			n = index->count;
+
+	/* This loop should be compiled into conditional moves */
+	while (n > 1)
+	{
+		uint32 half = n / 2;
+
+		base = (base[half] <= value) ? base + half : base;
+		n -= half;
+	}
+
+	return (uint32) (base - index->mins);
+}
+
+/* Find partition containing 'value', return -1 if there's none */
+static inline int
+int_range_index_find(const IntRangeIndex *index, const int64 value)
+{
+	uint32 i = int_range_index_lower(index, value);
+
+	if (cmp_int_range_bound(index, value, i, false) >= 0 &&
+		cmp_int_range_bound(index, value, i, true) < 0)
+		return (int) i;
+
+	return -1;
+}
+
+
 /*
  * PartStatusInfo
  *		Cached partitioning status of the specified relation.
@@ -153,6 +279,24 @@ typedef struct PartStatusInfo
 	struct PartRelationInfo *prel;
 } PartStatusInfo;
 
+/* Max number of altered partitions tracked by PartRetiredInfo */
+#define RETIRED_PREL_MAX_TOUCHED	16
+
+/*
+ * PartRetiredInfo
+ *		Outdated PartRelationInfo of the specified RANGE-partitioned
+ *		relation. Allows us to build a new one incrementally.
+ */
+typedef struct PartRetiredInfo
+{
+	Oid				relid;			/* key */
+	struct PartRelationInfo *prel;	/* holds a reference to 'prel' */
+
+	/* Partitions which might have changed their bounds */
+	uint32			ntouched;
+	Oid				touched[RETIRED_PREL_MAX_TOUCHED];
+} PartRetiredInfo;
+
 /*
  * PartParentInfo
  *		Cached parent of the specified partition.
@@ -213,6 +357,7 @@ typedef struct PartRelationInfo
 	uint32			children_count;
 	Oid			   *children;		/* Oids of child partitions */
 	RangeEntry	   *ranges;			/* per-partition range entry or NULL */
+	IntRangeIndex  *int_ranges;		/* dense copy of 'ranges' or NULL */
 
 	/* Partitioning expression */
 	const char	   *expr_cstr;		/* original expression */
@@ -251,6 +396,8 @@ typedef struct PartRelationInfo
 
 #define PrelGetRangesArray(prel)	( (prel)->ranges )
 
+#define PrelGetIntRangeIndex(prel)	( (prel)->int_ranges )
+
 #define PrelChildrenCount(prel)		( (prel)->children_count )
 
 #define PrelReferenceCount(prel)	( (prel)->refcount )
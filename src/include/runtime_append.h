@@ -19,11 +19,40 @@
 #include "optimizer/paths.h"
 #include "optimizer/pathnode.h"
 #include "commands/explain.h"
+#if PG_VERSION_NUM >= 110000
+#include "access/parallel.h"
+#include "storage/spin.h"
+#endif
 
 
 #define RUNTIME_APPEND_NODE_NAME "RuntimeAppend"
 
 
+#if PG_VERSION_NUM >= 110000
+/*
+ * Plan selected by the leader of a parallel-aware RuntimeAppend.
+ */
+typedef struct
+{
+	int			original_order;		/* index in 'all_plans' */
+	bool		finished;			/* nobody should start this plan */
+} RuntimeAppendParallelPlan;
+
+/*
+ * Shared state of a parallel-aware RuntimeAppend (stored in DSM).
+ * Partitions are pruned only once (by the leader), then all
+ * participants claim plans from this list like Parallel Append does.
+ */
+typedef struct
+{
+	slock_t		mutex;				/* protects everything below */
+	int			next_plan;			/* next plan to be tried */
+	int			nplans;				/* number of selected plans */
+	RuntimeAppendParallelPlan plans[FLEXIBLE_ARRAY_MEMBER];
+} RuntimeAppendParallelState;
+#endif
+
+
 typedef struct
 {
 	CustomPath			cpath;
@@ -48,6 +77,10 @@ typedef struct
 	Node			   *prel_expr;
 	PartRelationInfo   *prel;
 
+	/* Params used to look up results of previous prune_append_plans() */
+	uint32				plan_id;
+	RuntimePruneCache  *prune_cache;
+
 	/* All available plans \ plan states */
 	HTAB			   *children_table;
 	HASHCTL				children_table_config;
@@ -55,18 +88,39 @@ typedef struct
 	/* Currently selected plans \ plan states */
 	ChildScanCommon	   *cur_plans;
 	int					ncur_plans;
+	int					nready_plans;	/* see prepare_plan_states() */
 
 	/* Should we include parent table? Cached for prepared statements */
 	bool				enable_parent;
 
+	/* Should we scan foreign partitions after local ones? */
+	bool				defer_foreign;
+
 	/* Index of the selected plan state */
 	int					running_idx;
 
 	/* Last saved tuple (for SRF projections) */
 	TupleTableSlot	   *slot;
+
+	/* All plan states sorted by 'original_order' (if initialized at once) */
+	ChildScanCommon	   *all_plans;
+	int					nall_plans;
+
+#if PG_VERSION_NUM >= 110000
+	/* Shared state of parallel-aware scan (or NULL) */
+	RuntimeAppendParallelState *pstate;
+	bool				pstate_adopted;	/* have we read selected plans? */
+#endif
 } RuntimeAppendState;
 
 
+#if PG_VERSION_NUM >= 110000
+#define IsParallelRuntimeAppend(scan_state)	( (scan_state)->pstate != NULL )
+#else
+#define IsParallelRuntimeAppend(scan_state)	( false )
+#endif
+
+
 extern bool					pg_pathman_enable_runtimeappend;
 
 extern CustomPathMethods	runtimeappend_path_methods;
@@ -101,5 +155,22 @@ void runtime_append_explain(CustomScanState *node,
 							List *ancestors,
 							ExplainState *es);
 
+#if PG_VERSION_NUM >= 110000
+Size runtime_append_estimate_dsm(CustomScanState *node,
+								 ParallelContext *pcxt);
+
+void runtime_append_initialize_dsm(CustomScanState *node,
+								   ParallelContext *pcxt,
+								   void *coordinate);
+
+void runtime_append_reinitialize_dsm(CustomScanState *node,
+									 ParallelContext *pcxt,
+									 void *coordinate);
+
+void runtime_append_initialize_worker(CustomScanState *node,
+									  shm_toc *toc,
+									  void *coordinate);
+#endif
+
 
 #endif /* RUNTIME_APPEND_H */
@@ -0,0 +1,113 @@
+/* ------------------------------------------------------------------------
+ *
+ * shared_cache.h
+ *		Partition dispatch info shared by all backends
+ *
+ * Copyright (c) 2020, Postgres Professional
+ *
+ * ------------------------------------------------------------------------
+ */
+
+#ifndef SHARED_CACHE_H
+#define SHARED_CACHE_H
+
+
+#include "relation_info.h"
+
+#include "postgres.h"
+#include "port/atomics.h"
+#include "storage/lwlock.h"
+
+
+/* Number of RangeEntries stored in a single chunk */
+#define SHARED_CACHE_CHUNK_ENTRIES	64
+
+/* Number of relids remembered by a writing transaction */
+#define SHARED_CACHE_PENDING_SIZE	64
+
+
+/*
+ * Shared cache entries are identified by database & relation.
+ */
+typedef struct
+{
+	Oid				dbid;
+	Oid				relid;
+} SharedCacheKey;
+
+/*
+ * SharedPrelEntry
+ *		Partitions of the specified parent (sorted like in PartRelationInfo).
+ */
+typedef struct
+{
+	SharedCacheKey	key;			/* parent's database & relid */
+	uint32			generation;		/* unique stamp of this entry */
+	bool			valid;			/* does it contain partitions? */
+
+	PartType		parttype;		/* partitioning type (HASH | RANGE) */
+	Oid				ev_type;		/* expression type */
+
+	uint32			children_count;
+	int				first_chunk;	/* head of chunk list or -1 */
+} SharedPrelEntry;
+
+/*
+ * SharedParentEntry
+ *		Maps published partitions to their parents.
+ */
+typedef struct
+{
+	SharedCacheKey	key;			/* partition's database & relid */
+	Oid				parent_relid;
+} SharedParentEntry;
+
+/*
+ * SharedCacheChunk
+ *		Storage for partitions of a SharedPrelEntry.
+ */
+typedef struct
+{
+	int				next;			/* next chunk of the same entry or -1 */
+	RangeEntry		entries[SHARED_CACHE_CHUNK_ENTRIES];
+} SharedCacheChunk;
+
+typedef struct
+{
+	LWLock		   *lock;				/* protects everything below */
+	pg_atomic_uint32 epoch;				/* bumped by resets of whole cache */
+
+	uint32			next_generation;	/* stamp for a new SharedPrelEntry */
+	int				free_chunk;			/* head of free chunk list or -1 */
+	int				free_chunks_count;
+} SharedCacheHeader;
+
+/*
+ * Saved state of the shared cache we're going to publish into.
+ */
+typedef struct
+{
+	bool			valid;			/* are we allowed to publish? */
+	uint32			generation;		/* SharedPrelEntry's stamp */
+	uint32			epoch;			/* SharedCacheHeader's epoch */
+} SharedCacheTicket;
+
+
+/* For pg_pathman.shared_cache_partitions GUC */
+extern int		pg_pathman_shared_cache_partitions;
+
+#define IsSharedCacheEnabled()	( pg_pathman_shared_cache_partitions > 0 )
+
+
+void init_shared_cache_static_data(void);
+
+Size estimate_shared_cache_size(void);
+void init_shared_cache(void);
+
+bool shared_cache_lookup(PartRelationInfo *prel, SharedCacheTicket *ticket);
+void shared_cache_publish(const PartRelationInfo *prel,
+						  const SharedCacheTicket *ticket);
+void shared_cache_invalidate(Oid relid);
+
+
+#endif /* SHARED_CACHE_H */
@@ -14,12 +14,61 @@
 
 
 #include "relation_info.h"
+#include "partition_filter.h"
 
 #include "postgres.h"
+#include "access/heapam.h"
 #include "commands/copy.h"
+#include "nodes/execnodes.h"
 #include "nodes/nodes.h"
 
 
+/* Limits of multi-insert buffers used by COPY FROM */
+#define PATHMAN_COPY_BUFFER_TUPLES	1000		/* per partition */
+#define PATHMAN_COPY_BUFFER_BYTES	65535		/* per partition */
+#define PATHMAN_COPY_MAX_BUFFERS	32			/* partitions at once */
+#define PATHMAN_COPY_MAX_BYTES		(1024 * 1024)	/* all partitions */
+
+
+/*
+ * Rows waiting to be inserted into a partition at once.
+ */
+typedef struct
+{
+	ResultRelInfoHolder	   *rri_holder;		/* target partition */
+	BulkInsertState			bistate;
+	MemoryContext			mcxt;			/* storage for buffered tuples */
+
+	HeapTuple				tuples[PATHMAN_COPY_BUFFER_TUPLES];
+	uint64					rownos[PATHMAN_COPY_BUFFER_TUPLES];
+	int						ntuples;
+	Size					nbytes;
+
+	uint64					last_used;		/* for LRU flushing */
+} CopyMultiInsertBuffer;
+
+/*
+ * Multi-insert buffers of all partitions.
+ */
+typedef struct
+{
+	CopyMultiInsertBuffer  *buffers[PATHMAN_COPY_MAX_BUFFERS];
+	int						nbuffers;
+	Size					nbytes;			/* size of all buffered tuples */
+	uint64					clock;			/* for LRU flushing */
+
+	/* Slots for heap_multi_insert() and index insertion */
+	TupleTableSlot		   *slots[PATHMAN_COPY_BUFFER_TUPLES];
+
+	EState				   *estate;
+	CommandId				mycid;
+	MemoryContext			mcxt;
+
+	/* Number of current row for error context (optional) */
+	uint64				   *cur_rowno;
+} CopyMultiInsertInfo;
+
+
 /* Various traits */
 bool is_pathman_related_copy(Node *parsetree);
 bool is_pathman_related_table_rename(Node *parsetree,
@@ -37,5 +86,24 @@ void PathmanDoCopy(const CopyStmt *stmt, const char *queryString,
 void PathmanRenameConstraint(Oid partition_relid, const RenameStmt *rename_stmt);
 void PathmanRenameSequence(Oid parent_relid, const RenameStmt *rename_stmt);
 
+/* Insertion of routed rows (COPY FROM & concurrent partitioning) */
+bool copy_insert_routed_tuple(CopyMultiInsertInfo *miinfo,
+							  ResultRelInfoHolder *rri_holder,
+							  TupleTableSlot *slot,
+							  HeapTuple tuple,
+							  EState *estate,
+							  MemoryContext query_mcxt,
+							  CopyState cstate);
+
+void copy_multi_insert_init(CopyMultiInsertInfo *miinfo, EState *estate);
+void copy_multi_insert_fini(CopyMultiInsertInfo *miinfo);
+bool copy_multi_insert_allowed(const ResultRelInfo *rri);
+void copy_multi_insert_add(CopyMultiInsertInfo *miinfo,
+						   ResultRelInfoHolder *rri_holder,
+						   HeapTuple tuple);
+void copy_multi_insert_flush(CopyMultiInsertInfo *miinfo,
+							 CopyMultiInsertBuffer *buffer);
+void copy_multi_insert_flush_all(CopyMultiInsertInfo *miinfo);
+
 
 #endif /* COPY_STMT_HOOKING_H */
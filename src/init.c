@@ -18,6 +18,7 @@
 #include "pathman.h"
 #include "pathman_workers.h"
 #include "relation_info.h"
+#include "shared_cache.h"
 #include "utils.h"
 
 #include "access/htup_details.h"
@@ -68,6 +69,9 @@ HTAB			   *status_cache	= NULL;
 /* Storage for PartBoundInfos */
 HTAB			   *bounds_cache	= NULL;
 
+/* Storage for PartRetiredInfos */
+HTAB			   *retired_cache	= NULL;
+
 /* pg_pathman's init status */
 PathmanInitState 	pathman_init_state;
 
@@ -262,7 +266,12 @@ unload_config(void)
 Size
 estimate_pathman_shmem_size(void)
 {
-	return estimate_concurrent_part_task_slots_size();
+	Size size;
+
+	size = add_size(estimate_concurrent_part_task_slots_size(),
+					estimate_spawn_pool_size());
+
+	return add_size(size, estimate_shared_cache_size());
 }
 
 /*
@@ -316,6 +325,7 @@ init_local_cache(void)
 	hash_destroy(parents_cache);
 	hash_destroy(status_cache);
 	hash_destroy(bounds_cache);
+	hash_destroy(retired_cache);
 
 	/* Reset pg_pathman's memory contexts */
 	if (TopPathmanContext)
@@ -387,6 +397,15 @@ init_local_cache(void)
 	bounds_cache = hash_create(PATHMAN_BOUNDS_CACHE,
 							   PART_RELS_SIZE * CHILD_FACTOR, &ctl,
 							   HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+	memset(&ctl, 0, sizeof(ctl));
+	ctl.keysize = sizeof(Oid);
+	ctl.entrysize = sizeof(PartRetiredInfo);
+	ctl.hcxt = PathmanStatusCacheContext;
+
+	retired_cache = hash_create(PATHMAN_RETIRED_CACHE,
+								PART_RELS_SIZE, &ctl,
+								HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
 }
 
 /*
@@ -399,10 +418,12 @@ fini_local_cache(void)
 	hash_destroy(parents_cache);
 	hash_destroy(status_cache);
 	hash_destroy(bounds_cache);
+	hash_destroy(retired_cache);
 
 	parents_cache	= NULL;
 	status_cache	= NULL;
 	bounds_cache	= NULL;
+	retired_cache	= NULL;
 
 	if (prel_resowner != NULL)
 	{
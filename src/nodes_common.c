@@ -14,6 +14,11 @@
 #include "runtime_append.h"
 #include "utils.h"
 
+#if PG_VERSION_NUM >= 130000
+#include "common/hashfn.h"
+#else
+#include "access/hash.h"
+#endif
 #include "nodes/nodeFuncs.h"
 #if PG_VERSION_NUM >= 120000
 #include "optimizer/optimizer.h"
@@ -23,6 +28,9 @@
 #endif
 #include "optimizer/tlist.h"
 #include "rewrite/rewriteManip.h"
+#include "utils/builtins.h"
+#include "utils/datum.h"
+#include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/ruleutils.h"
 
@@ -31,6 +39,18 @@
 #define INITIAL_ALLOC_NUM	10
 
 
+/* Source of RuntimeAppend plan ids (see pack_runtimeappend_private()) */
+static uint32 next_plan_id = 0;
+
+/* Pruning results of RuntimeAppend plans (see prune_cache_get_plan()) */
+static HTAB				   *prune_cache_plans = NULL;
+static MemoryContext		prune_cache_mcxt = NULL;
+static dlist_head			prune_cache_lru = DLIST_STATIC_INIT(prune_cache_lru);
+
+/* Bumped by forget_prune_cache_of_rel() */
+static uint64				prune_cache_generation = 0;
+
+
 /* Compare plans by 'original_order' */
 static int
 cmp_child_scan_common_by_orig_order(const void *ap,
@@ -47,50 +67,74 @@ cmp_child_scan_common_by_orig_order(const void *ap,
 		return 0;
 }
 
-static void
-transform_plans_into_states(RuntimeAppendState *scan_state,
-							ChildScanCommon *selected_plans, int n,
-							EState *estate)
+#if PG_VERSION_NUM >= 110000
+/*
+ * Do we have to initialize all plan states at once? This is the case
+ * for parallel-aware plans, since ExecParallelInitializeDSM() expects
+ * to find all of them in 'custom_ps' before execution begins.
+ */
+static bool
+plan_states_required_early(RuntimeAppendState *scan_state)
 {
-	int i;
+	HASH_SEQ_STATUS		seqstat;
+	ChildScanCommon		child;
 
-	for (i = 0; i < n; i++)
-	{
-		ChildScanCommon		child;
-		PlanState		   *ps;
+	if (scan_state->css.ss.ps.plan->parallel_aware)
+		return true;
 
-		AssertArg(selected_plans);
-		child = selected_plans[i];
+	hash_seq_init(&seqstat, scan_state->children_table);
 
-		/* Create new node since this plan hasn't been used yet */
-		if (child->content_type != CHILD_PLAN_STATE)
+	while ((child = (ChildScanCommon) hash_seq_search(&seqstat)))
+	{
+		if (child->content.plan->parallel_aware)
 		{
-			Assert(child->content_type == CHILD_PLAN); /* no paths allowed */
+			hash_seq_term(&seqstat);
+			return true;
+		}
+	}
 
-			ps = ExecInitNode(child->content.plan, estate, 0);
-			child->content.plan_state = ps;
-			child->content_type = CHILD_PLAN_STATE; /* update content type */
+	return false;
+}
 
-			/* Explain and clear_plan_states rely on this list */
-			scan_state->css.custom_ps = lappend(scan_state->css.custom_ps, ps);
-		}
-		else
-			ps = child->content.plan_state;
+/* Initialize plan states of all children (in original order) */
+static void
+init_all_plan_states(RuntimeAppendState *scan_state,
+					 EState *estate, int eflags)
+{
+	HASH_SEQ_STATUS		seqstat;
+	ChildScanCommon		child;
+	int					nplans,
+						i;
 
-		/* Node with params will be ReScanned */
-		if (scan_state->css.ss.ps.chgParam)
-			UpdateChangedParamSet(ps, scan_state->css.ss.ps.chgParam);
+	nplans = hash_get_num_entries(scan_state->children_table);
+	scan_state->all_plans = palloc(nplans * sizeof(ChildScanCommon));
 
-		/*
-		 * We should ReScan this node manually since
-		 * ExecProcNode won't do this for us in this case.
-		 */
-		if (bms_is_empty(ps->chgParam))
-			ExecReScan(ps);
+	i = 0;
+	hash_seq_init(&seqstat, scan_state->children_table);
+	while ((child = (ChildScanCommon) hash_seq_search(&seqstat)))
+		scan_state->all_plans[i++] = child;
+
+	/* Thus 'all_plans[i]->original_order' is equal to 'i' */
+	qsort(scan_state->all_plans, nplans, sizeof(ChildScanCommon),
+		  cmp_child_scan_common_by_orig_order);
+
+	for (i = 0; i < nplans; i++)
+	{
+		child = scan_state->all_plans[i];
+
+		Assert(child->content_type == CHILD_PLAN);
+		child->content.plan_state = ExecInitNode(child->content.plan,
+												 estate, eflags);
+		child->content_type = CHILD_PLAN_STATE;
 
-		child->content.plan_state = ps;
+		/* Explain and clear_plan_states rely on this list */
+		scan_state->css.custom_ps = lappend(scan_state->css.custom_ps,
+											child->content.plan_state);
 	}
+
+	scan_state->nall_plans = nplans;
 }
+#endif
 
 static ChildScanCommon *
 select_required_plans(HTAB *children_table, Oid *parts, int nparts, int *nres)
@@ -278,11 +322,15 @@ pack_runtimeappend_private(CustomScan *cscan, RuntimeAppendPath *path,
 		pfree(children[i]);
 	}
 
-	/* Save parent & partition Oids and a flag as first element of 'custom_private' */
+	/*
+	 * Save parent & partition Oids, a flag and plan's id (used to find
+	 * cached pruning results) as first element of 'custom_private'.
+	 */
 	custom_private = lappend(custom_private,
-							 list_make3(list_make1_oid(path->relid),
+							 list_make4(list_make1_oid(path->relid),
 										custom_oids, /* list of Oids */
-										list_make1_int(enable_parent)));
+										list_make1_int(enable_parent),
+										list_make1_int((int) ++next_plan_id)));
 
 	/* Store freshly built 'custom_private' */
 	cscan->custom_private = custom_private;
@@ -329,12 +377,14 @@ unpack_runtimeappend_private(RuntimeAppendState *scan_state, CustomScan *cscan)
 		child->content_type = CHILD_PLAN;
 		child->content.plan = (Plan *) lfirst(plan_cell);
 		child->original_order = i++; /* will be used in EXPLAIN */
+		child->is_foreign = IsA(child->content.plan, ForeignScan);
 	}
 
 	/* Finally fill 'scan_state' with unpacked elements */
 	scan_state->children_table = children_table;
 	scan_state->relid = linitial_oid(linitial(runtimeappend_private));
 	scan_state->enable_parent = (bool) linitial_int(lthird(runtimeappend_private));
+	scan_state->plan_id = (uint32) linitial_int(lfourth(runtimeappend_private));
 }
 
 
@@ -383,6 +433,336 @@ canonicalize_custom_exprs(List *custom_exps)
 }
 
 
+/*
+ * ----------------------------------
+ *  Plan cache of pruning results
+ * ----------------------------------
+ */
+
+/* Collect distinct Params of pruning clauses */
+static bool
+collect_params_walker(Node *node, List **params)
+{
+	if (node == NULL)
+		return false;
+
+	if (IsA(node, Param))
+	{
+		*params = list_append_unique(*params, node);
+		return false;
+	}
+
+	return expression_tree_walker(node, collect_params_walker, (void *) params);
+}
+
+static RuntimePruneCache *
+create_prune_cache(List *canon_custom_exprs, uint32 plan_id, uint64 generation)
+{
+	RuntimePruneCache  *cache;
+	List			   *params = NIL;
+	ListCell		   *lc;
+	int					i = 0;
+
+	collect_params_walker((Node *) canon_custom_exprs, &params);
+
+	cache = (RuntimePruneCache *) palloc0(sizeof(RuntimePruneCache));
+	cache->plan_id			= plan_id;
+	cache->generation		= generation;
+	cache->nparams			= list_length(params);
+	cache->param_states		= palloc(sizeof(ExprState *) * cache->nparams);
+	cache->param_typlen		= palloc(sizeof(int16) * cache->nparams);
+	cache->param_typbyval	= palloc(sizeof(bool) * cache->nparams);
+	cache->values			= palloc(sizeof(Datum) * cache->nparams);
+	cache->isnull			= palloc(sizeof(bool) * cache->nparams);
+
+	foreach (lc, params)
+	{
+		Param *param = (Param *) lfirst(lc);
+
+		/* Params are evaluated just like in ExtractConst() */
+		cache->param_states[i] = ExecInitExpr((Expr *) param, NULL);
+		get_typlenbyval(param->paramtype,
+						&cache->param_typlen[i],
+						&cache->param_typbyval[i]);
+		i++;
+	}
+
+	return cache;
+}
+
+/* Evaluate params and hash them, return false if they can't be cached */
+static bool
+prune_cache_read_params(RuntimePruneCache *cache, ExprContext *econtext)
+{
+	uint32	hash = 0;
+	int		i;
+
+	/* Partitions might have changed since this execution has started */
+	if (cache->generation != prune_cache_generation)
+		return false;
+
+	for (i = 0; i < cache->nparams; i++)
+	{
+		Datum	value;
+		bool	isnull;
+		uint32	value_hash = 0;
+
+		value = ExecEvalExprCompat(cache->param_states[i], econtext, &isnull);
+
+		if (!isnull && cache->param_typbyval[i])
+			value_hash = DatumGetUInt32(hash_any((unsigned char *) &value,
+												 sizeof(Datum)));
+		else if (!isnull)
+		{
+			/* Expanded objects have no stable binary representation */
+			if (cache->param_typlen[i] == -1 &&
+				VARATT_IS_EXTERNAL_EXPANDED(DatumGetPointer(value)))
+				return false;
+
+			value_hash = DatumGetUInt32(hash_any((unsigned char *) DatumGetPointer(value),
+												 datumGetSize(value, false,
+															  cache->param_typlen[i])));
+		}
+
+		cache->values[i] = value;
+		cache->isnull[i] = isnull;
+
+		/* Rotate hash left 1 bit before mixing in the next value */
+		hash = ((hash << 1) | (hash >> 31)) ^ value_hash;
+	}
+
+	cache->hash = hash;
+
+	return true;
+}
+
+/* Free memory & forget pruning results of a plan */
+static void
+drop_prune_cache_plan(RuntimePruneCachePlan *plan)
+{
+	uint32 plan_id = plan->plan_id;
+
+	MemoryContextDelete(plan->mcxt);
+	dlist_delete(&plan->lru_node);
+	hash_search(prune_cache_plans, (const void *) &plan_id, HASH_REMOVE, NULL);
+}
+
+/* Find partitions cached for current param values */
+static bool
+prune_cache_lookup(RuntimePruneCache *cache, Oid **parts, int *nparts)
+{
+	RuntimePruneCachePlan  *plan;
+	int						i, j;
+
+	if (!prune_cache_plans)
+		return false;
+
+	plan = hash_search(prune_cache_plans,
+					   (const void *) &cache->plan_id,
+					   HASH_FIND, NULL);
+	if (!plan)
+		return false;
+
+	for (i = 0; i < plan->nentries; i++)
+	{
+		RuntimePruneCacheEntry entry = plan->entries[i];
+
+		if (entry.hash != cache->hash)
+			continue;
+
+		for (j = 0; j < cache->nparams; j++)
+		{
+			if (entry.isnull[j] != cache->isnull[j])
+				break;
+
+			if (!entry.isnull[j] &&
+				!datumIsEqual(entry.values[j], cache->values[j],
+							  cache->param_typbyval[j],
+							  cache->param_typlen[j]))
+				break;
+		}
+
+		/* Some values differ */
+		if (j < cache->nparams)
+			continue;
+
+		/* Move this entry and its plan to the head */
+		memmove(&plan->entries[1], &plan->entries[0],
+				sizeof(RuntimePruneCacheEntry) * i);
+		plan->entries[0] = entry;
+		dlist_move_head(&prune_cache_lru, &plan->lru_node);
+
+		/* Caller is free to pfree() the result */
+		*nparts = entry.nparts;
+		*parts = palloc(sizeof(Oid) * Max(entry.nparts, 1));
+		memcpy(*parts, entry.parts, sizeof(Oid) * entry.nparts);
+
+		return true;
+	}
+
+	return false;
+}
+
+/* Find or create cache of pruning results for this plan */
+static RuntimePruneCachePlan *
+prune_cache_get_plan(RuntimePruneCache *cache, RuntimeAppendState *scan_state)
+{
+	RuntimePruneCachePlan  *plan;
+	MemoryContext			old_mcxt;
+	HASH_SEQ_STATUS			seqstat;
+	ChildScanCommon			child;
+	bool					found;
+	int						i = 0;
+
+	if (!prune_cache_plans)
+	{
+		HASHCTL ctl;
+
+		prune_cache_mcxt = AllocSetContextCreate(TopMemoryContext,
+												 CppAsString(prune_cache_plans),
+												 ALLOCSET_DEFAULT_SIZES);
+
+		memset(&ctl, 0, sizeof(ctl));
+		ctl.keysize = sizeof(uint32);
+		ctl.entrysize = sizeof(RuntimePruneCachePlan);
+		ctl.hcxt = prune_cache_mcxt;
+
+		prune_cache_plans = hash_create("RuntimeAppend pruning cache",
+										RUNTIME_PRUNE_CACHE_PLANS, &ctl,
+										HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	plan = hash_search(prune_cache_plans,
+					   (const void *) &cache->plan_id,
+					   HASH_FIND, NULL);
+	if (plan)
+		return plan;
+
+	/* Evict the least recently used plan */
+	if (hash_get_num_entries(prune_cache_plans) >= RUNTIME_PRUNE_CACHE_PLANS)
+		drop_prune_cache_plan(dlist_tail_element(RuntimePruneCachePlan,
+												 lru_node, &prune_cache_lru));
+
+	plan = hash_search(prune_cache_plans,
+					   (const void *) &cache->plan_id,
+					   HASH_ENTER, &found);
+	Assert(!found);
+
+	plan->relid = scan_state->relid;
+	plan->mcxt = AllocSetContextCreate(prune_cache_mcxt,
+									   CppAsString(prune_cache_get_plan),
+									   ALLOCSET_SMALL_SIZES);
+	dlist_push_head(&prune_cache_lru, &plan->lru_node);
+
+	old_mcxt = MemoryContextSwitchTo(plan->mcxt);
+
+	/* Remember partitions of this plan, see forget_prune_cache_of_rel() */
+	plan->nchildren = hash_get_num_entries(scan_state->children_table);
+	plan->children = palloc(sizeof(Oid) * Max(plan->nchildren, 1));
+
+	hash_seq_init(&seqstat, scan_state->children_table);
+	while ((child = (ChildScanCommon) hash_seq_search(&seqstat)) != NULL)
+		plan->children[i++] = child->relid;
+
+	qsort(plan->children, plan->nchildren, sizeof(Oid), oid_cmp);
+
+	plan->nparams = cache->nparams;
+	plan->param_typlen = palloc(sizeof(int16) * cache->nparams);
+	plan->param_typbyval = palloc(sizeof(bool) * cache->nparams);
+	memcpy(plan->param_typlen, cache->param_typlen,
+		   sizeof(int16) * cache->nparams);
+	memcpy(plan->param_typbyval, cache->param_typbyval,
+		   sizeof(bool) * cache->nparams);
+
+	plan->nentries = 0;
+
+	MemoryContextSwitchTo(old_mcxt);
+
+	return plan;
+}
+
+/* Remember partitions selected for current param values */
+static void
+prune_cache_insert(RuntimePruneCache *cache, RuntimeAppendState *scan_state,
+				   Oid *parts, int nparts)
+{
+	RuntimePruneCachePlan  *plan;
+	RuntimePruneCacheEntry *entry;
+	MemoryContext			old_mcxt;
+	int						i;
+
+	plan = prune_cache_get_plan(cache, scan_state);
+
+	/* Evict the least recently used entry */
+	if (plan->nentries == RUNTIME_PRUNE_CACHE_SIZE)
+	{
+		entry = &plan->entries[--plan->nentries];
+
+		for (i = 0; i < plan->nparams; i++)
+			if (!entry->isnull[i] && !plan->param_typbyval[i])
+				pfree(DatumGetPointer(entry->values[i]));
+
+		pfree(entry->values);
+		pfree(entry->isnull);
+		pfree(entry->parts);
+	}
+
+	memmove(&plan->entries[1], &plan->entries[0],
+			sizeof(RuntimePruneCacheEntry) * plan->nentries);
+	plan->nentries++;
+
+	old_mcxt = MemoryContextSwitchTo(plan->mcxt);
+
+	entry = &plan->entries[0];
+	entry->hash		= cache->hash;
+	entry->values	= palloc(sizeof(Datum) * plan->nparams);
+	entry->isnull	= palloc(sizeof(bool) * plan->nparams);
+	entry->nparts	= nparts;
+	entry->parts	= palloc(sizeof(Oid) * Max(nparts, 1));
+
+	for (i = 0; i < plan->nparams; i++)
+	{
+		entry->isnull[i] = cache->isnull[i];
+		entry->values[i] = cache->isnull[i] ?
+								(Datum) 0 :
+								datumCopy(cache->values[i],
+										  plan->param_typbyval[i],
+										  plan->param_typlen[i]);
+	}
+
+	memcpy(entry->parts, parts, sizeof(Oid) * nparts);
+
+	MemoryContextSwitchTo(old_mcxt);
+}
+
+/*
+ * Forget pruning results which might depend on 'relid' (InvalidOid means all).
+ * NOTE: called by pathman_relcache_hook(), thus no catalog access is allowed.
+ */
+void
+forget_prune_cache_of_rel(Oid relid)
+{
+	HASH_SEQ_STATUS			seqstat;
+	RuntimePruneCachePlan  *plan;
+
+	/* Executions in progress shouldn't store results anymore */
+	prune_cache_generation++;
+
+	if (!prune_cache_plans)
+		return;
+
+	hash_seq_init(&seqstat, prune_cache_plans);
+	while ((plan = (RuntimePruneCachePlan *) hash_seq_search(&seqstat)) != NULL)
+	{
+		if (relid == InvalidOid ||
+			relid == plan->relid ||
+			bsearch(&relid, plan->children, plan->nchildren,
+					sizeof(Oid), oid_cmp) != NULL)
+			drop_prune_cache_plan(plan);
+	}
+}
+
+
 /*
  * Filter all available clauses and extract relevant ones.
  */
@@ -471,6 +851,14 @@ create_append_path_common(PlannerInfo *root,
 	result->cpath.path.pathkeys = inner_append->path.pathkeys;
 #if PG_VERSION_NUM >= 90600
 	result->cpath.path.pathtarget = inner_append->path.pathtarget;
+
+	/* Children may reset 'parallel_safe' (see below) */
+	result->cpath.path.parallel_safe = inner_append->path.parallel_safe;
+	result->cpath.path.parallel_workers = inner_append->path.parallel_workers;
+#endif
+#if PG_VERSION_NUM >= 110000
+	/* Workers will claim children of Parallel Append as well */
+	result->cpath.path.parallel_aware = inner_append->path.parallel_aware;
 #endif
 	result->cpath.path.rows = inner_append->path.rows * sel;
 	result->cpath.flags = 0;
@@ -527,6 +915,9 @@ create_append_path_common(PlannerInfo *root,
 
 		result->cpath.path.startup_cost += path->startup_cost;
 		result->cpath.path.total_cost += path->total_cost;
+#if PG_VERSION_NUM >= 90600
+		result->cpath.path.parallel_safe &= path->parallel_safe;
+#endif
 
 		child->content_type = CHILD_PATH;
 		child->content.path = path;
@@ -650,6 +1041,7 @@ create_append_scan_state_common(CustomScan *node,
 
 	scan_state->cur_plans = NULL;
 	scan_state->ncur_plans = 0;
+	scan_state->nready_plans = 0;
 	scan_state->running_idx = 0;
 
 	return (Node *) scan_state;
@@ -659,11 +1051,15 @@ void
 begin_append_common(CustomScanState *node, EState *estate, int eflags)
 {
 	RuntimeAppendState *scan_state = (RuntimeAppendState *) node;
+	uint64				generation;
 
 #if PG_VERSION_NUM < 100000
 	node->ss.ps.ps_TupFromTlist = false;
 #endif
 
+	/* Cached pruning results must not be older than 'prel' */
+	generation = prune_cache_generation;
+
 	scan_state->prel = get_pathman_relation_info(scan_state->relid);
 	Assert(scan_state->prel);
 
@@ -673,6 +1069,16 @@ begin_append_common(CustomScanState *node, EState *estate, int eflags)
 	/* Prepare custom expression according to set_set_customscan_references() */
 	scan_state->canon_custom_exprs =
 			canonicalize_custom_exprs(scan_state->custom_exprs);
+
+	/* Results of pruning only depend on params of these expressions */
+	scan_state->prune_cache = create_prune_cache(scan_state->canon_custom_exprs,
+												 scan_state->plan_id,
+												 generation);
+
+#if PG_VERSION_NUM >= 110000
+	if (plan_states_required_early(scan_state))
+		init_all_plan_states(scan_state, estate, eflags);
+#endif
 }
 
 TupleTableSlot *
@@ -682,8 +1088,8 @@ exec_append_common(CustomScanState *node,
 	RuntimeAppendState *scan_state = (RuntimeAppendState *) node;
 	TupleTableSlot	   *result;
 
-	/* ReScan if no plans are selected */
-	if (scan_state->ncur_plans == 0)
+	/* ReScan if no plans are selected (leader prunes parallel scans) */
+	if (scan_state->ncur_plans == 0 && !IsParallelRuntimeAppend(scan_state))
 		ExecReScan(&node->ss.ps);
 
 #if PG_VERSION_NUM >= 100000
@@ -765,17 +1171,34 @@ end_append_common(CustomScanState *node)
 	close_pathman_relation_info(scan_state->prel);
 }
 
-void
-rescan_append_common(CustomScanState *node)
+/*
+ * Select plans of partitions which satisfy 'canon_custom_exprs'.
+ */
+ChildScanCommon *
+prune_append_plans(CustomScanState *node, int *nplans)
 {
 	RuntimeAppendState *scan_state = (RuntimeAppendState *) node;
 	ExprContext		   *econtext = node->ss.ps.ps_ExprContext;
 	PartRelationInfo   *prel = scan_state->prel;
+	RuntimePruneCache  *cache = scan_state->prune_cache;
+	ChildScanCommon	   *result;
 	List			   *ranges;
 	ListCell		   *lc;
 	WalkerContext		wcxt;
 	Oid				   *parts;
 	int					nparts;
+	bool				cacheable;
+
+	/* Maybe we've already seen these param values? */
+	cacheable = prune_cache_read_params(cache, econtext);
+	if (cacheable && prune_cache_lookup(cache, &parts, &nparts))
+	{
+		result = select_required_plans(scan_state->children_table,
+									   parts, nparts, nplans);
+		pfree(parts);
+
+		return result;
+	}
 
 	/* First we select all available partitions... */
 	ranges = list_make1_irange_full(prel, IR_COMPLETE);
@@ -793,21 +1216,88 @@ rescan_append_common(CustomScanState *node)
 	/* Get Oids of the required partitions */
 	parts = get_partition_oids(ranges, &nparts, prel, scan_state->enable_parent);
 
-	/* Select new plans for this run using 'parts' */
+	if (cacheable)
+		prune_cache_insert(cache, scan_state, parts, nparts);
+
+	result = select_required_plans(scan_state->children_table,
+								   parts, nparts, nplans);
+	pfree(parts);
+
+	return result;
+}
+
+/*
+ * Make selected plans [nready_plans; upto) executable. Plan states are
+ * created only when they are actually needed (e.g. LIMIT might stop us
+ * early) and kept in 'children_table' for subsequent rescans.
+ */
+void
+prepare_plan_states(CustomScanState *node, int upto)
+{
+	RuntimeAppendState *scan_state = (RuntimeAppendState *) node;
+
+	Assert(upto <= scan_state->ncur_plans);
+
+	for (; scan_state->nready_plans < upto; scan_state->nready_plans++)
+	{
+		ChildScanCommon		child;
+		PlanState		   *ps;
+
+		child = scan_state->cur_plans[scan_state->nready_plans];
+
+		/* Create new node since this plan hasn't been used yet */
+		if (child->content_type != CHILD_PLAN_STATE)
+		{
+			Assert(child->content_type == CHILD_PLAN); /* no paths allowed */
+
+			ps = ExecInitNode(child->content.plan, node->ss.ps.state, 0);
+			child->content.plan_state = ps;
+			child->content_type = CHILD_PLAN_STATE; /* update content type */
+
+			/* Explain and clear_plan_states rely on this list */
+			node->custom_ps = lappend(node->custom_ps, ps);
+		}
+		else
+		{
+			ps = child->content.plan_state;
+
+			/*
+			 * We should ReScan this node manually since
+			 * ExecProcNode won't do this for us in this case.
+			 */
+			if (bms_is_empty(ps->chgParam))
+				ExecReScan(ps);
+		}
+	}
+}
+
+void
+rescan_append_common(CustomScanState *node)
+{
+	RuntimeAppendState *scan_state = (RuntimeAppendState *) node;
+	int					i;
+
+	/* Select new plans for this run */
 	if (scan_state->cur_plans)
 		pfree(scan_state->cur_plans); /* shallow free since cur_plans
 									   * belong to children_table  */
-	scan_state->cur_plans = select_required_plans(scan_state->children_table,
-												  parts, nparts,
-												  &scan_state->ncur_plans);
-	pfree(parts);
+	scan_state->cur_plans = prune_append_plans(node, &scan_state->ncur_plans);
 
-	/* Transform selected plans into executable plan states */
-	transform_plans_into_states(scan_state,
-								scan_state->cur_plans,
-								scan_state->ncur_plans,
-								scan_state->css.ss.ps.state);
+	/*
+	 * Existing nodes with params will be ReScanned; we have to
+	 * mark them now, since our own chgParam is about to be reset.
+	 */
+	for (i = 0; i < scan_state->ncur_plans && node->ss.ps.chgParam; i++)
+	{
+		ChildScanCommon child = scan_state->cur_plans[i];
 
+		if (child->content_type == CHILD_PLAN_STATE)
+			UpdateChangedParamSet(child->content.plan_state,
+								  node->ss.ps.chgParam);
+	}
+
+	/* Plan states will be prepared on demand (see prepare_plan_states()) */
+	scan_state->nready_plans = 0;
 	scan_state->running_idx = 0;
 }
 
@@ -833,8 +1323,8 @@ explain_append_common(CustomScanState *node,
 	/* And add to es->str */
 	ExplainPropertyText("Prune by", exprstr, es);
 
-	/* Construct excess PlanStates */
-	if (!es->analyze)
+	/* Construct excess PlanStates (unless they have been built already) */
+	if (!es->analyze && !node->custom_ps)
 	{
 		uint32				allocated,
 							used;
@@ -845,9 +1335,6 @@ explain_append_common(CustomScanState *node,
 
 		ArrayAlloc(custom_ps, allocated, used, INITIAL_ALLOC_NUM);
 
-		/* There can't be any nodes since we're not scanning anything */
-		Assert(!node->custom_ps);
-
 		/* Iterate through node's ChildScanCommon table */
 		hash_seq_init(&seqstat, children_table);
 
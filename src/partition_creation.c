@@ -56,6 +56,17 @@
 #include "utils/regproc.h"
 #endif
 
+/* Parent's properties shared by all partitions being created */
+typedef struct
+{
+	Oid			parent_relid;
+	RangeVar   *parent_rv;
+	Oid			parent_owner;
+	char	   *parent_tablespace;
+	bool		need_priv_escalation;
+} partition_parent_info;
+
+
 static Oid spawn_partitions_val(Oid parent_relid,
 								const Bound *range_bound_min,
 								const Bound *range_bound_max,
@@ -76,6 +87,14 @@ static Oid create_single_partition_internal(Oid parent_relid,
 											RangeVar *partition_rv,
 											char *tablespace);
 
+static void prepare_partition_parent(Oid parent_relid,
+									 partition_parent_info *parent);
+
+static Oid create_partition_using_parent(partition_parent_info *parent,
+										 RangeVar *partition_rv,
+										 char *tablespace,
+										 List *constraints);
+
 static char *choose_range_partition_name(Oid parent_relid, Oid parent_nsp);
 static char *choose_hash_partition_name(Oid parent_relid, uint32 part_idx);
 
@@ -178,6 +197,99 @@ create_single_range_partition_internal(Oid parent_relid,
 	return partition_relid;
 }
 
+/*
+ * Create several adjacent RANGE partitions [bounds[i], bounds[i + 1]).
+ *
+ * Unlike create_single_range_partition_internal(), parent is locked and
+ * checked only once, partitioning expression is parsed only once and
+ * CHECK constraints are created along with tables.
+ *
+ * NOTE: core invalidates parent on each new inheritance child, but we
+ * don't look up its PartRelationInfo here, thus it's rebuilt only once,
+ * when someone needs it after all partitions are in place.
+ *
+ * Oids of new partitions are stored to 'partition_relids' (if provided).
+ */
+void
+create_range_partitions_bulk(Oid parent_relid,
+							 const Bound *bounds,
+							 int nparts,
+							 Oid value_type,
+							 RangeVar **partition_rvs,
+							 char **tablespaces,
+							 Oid *partition_relids)
+{
+	partition_parent_info	parent;
+	Node				   *expr;
+	Oid						parent_nsp;
+	char				   *parent_nsp_name;
+	int						i;
+
+	/* Lock parent, check privileges and fetch its properties */
+	prepare_partition_parent(parent_relid, &parent);
+
+	/* Partitioning expression is the same for all partitions */
+	expr = build_partitioning_expression(parent_relid, NULL, NULL);
+
+	parent_nsp = get_rel_namespace(parent_relid);
+	parent_nsp_name = get_namespace_name(parent_nsp);
+
+	for (i = 0; i < nparts; i++)
+	{
+		Oid						partition_relid;
+		RangeVar			   *partition_rv;
+		char				   *tablespace;
+		Constraint			   *check_constr;
+		init_callback_params	callback_params;
+
+		/* Some absurd init_callback might have dropped the parent */
+		if (i > 0 &&
+			!pathman_config_contains_relation(parent_relid, NULL, NULL, NULL, NULL))
+		{
+			elog(ERROR, "Can't create range partition: relid %u doesn't exist or not partitioned", parent_relid);
+		}
+
+		partition_rv = partition_rvs ? partition_rvs[i] : NULL;
+		tablespace = tablespaces ? tablespaces[i] : NULL;
+
+		/* Generate a name if asked to */
+		if (!partition_rv)
+			partition_rv = makeRangeVar(parent_nsp_name,
+										choose_range_partition_name(parent_relid,
+																	parent_nsp),
+										-1);
+
+		/* Check constraint is added by CREATE TABLE itself */
+		check_constr = make_constraint_common(
+							build_check_constraint_name_relname_internal(partition_rv->relname),
+							build_raw_range_check_tree(copyObject(expr),
+													   &bounds[i],
+													   &bounds[i + 1],
+													   value_type));
+
+		/* Create a partition with its constraint */
+		partition_relid = create_partition_using_parent(&parent,
+														partition_rv,
+														tablespace,
+														list_make1(check_constr));
+
+		/* Cook args for init_callback */
+		MakeInitCallbackRangeParams(&callback_params,
+									DEFAULT_PATHMAN_INIT_CALLBACK,
+									parent_relid, partition_relid,
+									bounds[i], bounds[i + 1], value_type);
+
+		/* Finally invoke 'init_callback' */
+		invoke_part_callback(&callback_params);
+
+		/* Make possible changes visible */
+		CommandCounterIncrement();
+
+		if (partition_relids)
+			partition_relids[i] = partition_relid;
+	}
+}
+
 /* Create one HASH partition */
 Oid
 create_single_hash_partition_internal(Oid parent_relid,
@@ -494,6 +606,23 @@ spawn_partitions_val(Oid parent_relid,				/* parent's Oid */
 
 	Bound		value_bound = MakeBound(value);
 
+	Datum		start_bound;				/* parent's MIN\MAX boundary */
+	char	   *start_bound_cstr;
+
+	Oid			parent_nsp;
+	char	   *parent_nsp_name,
+			   *partition_name = NULL;
+	HeapTuple	typeTuple;
+	char	   *typname;
+
+	List	   *bounds = NIL,				/* bounds of new partitions */
+			   *names = NIL;				/* names of new partitions */
+	ListCell   *lc;
+	StringInfoData	bounds_sql,
+					names_sql;
+	char	   *create_sql;
+	int			rc;
+
 	Oid			last_partition = InvalidOid;
 
 
@@ -563,20 +692,32 @@ spawn_partitions_val(Oid parent_relid,				/* parent's Oid */
 	/* Get operator's underlying function */
 	fmgr_info(move_bound_op_func, &move_bound_finfo);
 
+	/* New partitions start at parent's MIN\MAX boundary */
+	start_bound = cur_leading_bound;
+
+	parent_nsp = get_rel_namespace(parent_relid);
+	parent_nsp_name = get_namespace_name(parent_nsp);
+
+	/* Get typname of range_bound_type to perform cast */
+	typeTuple = SearchSysCache1(TYPEOID, ObjectIdGetDatum(range_bound_type));
+	Assert(HeapTupleIsValid(typeTuple));
+	typname = pstrdup(NameStr(((Form_pg_type) GETSTRUCT(typeTuple))->typname));
+	ReleaseSysCache(typeTuple);
+
 	/* Execute comparison function cmp(value, cur_leading_bound) */
 	while (should_append ?
 				check_ge(&cmp_value_bound_finfo, collid, value, cur_leading_bound) :
 				check_lt(&cmp_value_bound_finfo, collid, value, cur_leading_bound))
 	{
-		Bound bounds[2];
-		int			rc;
-		bool		isnull;
-		char	   *create_sql;
-		HeapTuple	typeTuple;
-		char	   *typname;
-		Oid			parent_nsp = get_rel_namespace(parent_relid);
-		char	   *parent_nsp_name = get_namespace_name(parent_nsp);
-		char	   *partition_name = choose_range_partition_name(parent_relid, parent_nsp);
+		char	   *bound_cstr,
+				   *qualified_name;
+
+		/* Names are chosen in the same order partitions are spawned */
+		partition_name = choose_range_partition_name(parent_relid, parent_nsp);
+
+		qualified_name = quote_literal_cstr(psprintf("%s.%s",
+													 quote_identifier(parent_nsp_name),
+													 quote_identifier(partition_name)));
 
 		/* Assign the 'following' boundary to current 'leading' value */
 		cur_following_bound = cur_leading_bound;
@@ -586,48 +727,22 @@ spawn_partitions_val(Oid parent_relid,				/* parent's Oid */
 										  cur_leading_bound,
 										  interval_binary);
 
-		bounds[0] = MakeBound(should_append ? cur_following_bound : cur_leading_bound);
-		bounds[1] = MakeBound(should_append ? cur_leading_bound : cur_following_bound);
+		bound_cstr = psprintf("%s::%s",
+							  quote_literal_cstr(datum_to_cstring(cur_leading_bound,
+																  range_bound_type)),
+							  typname);
 
-		/*
-		 * Instead of directly calling create_single_range_partition_internal()
-		 * we are going to call it through SPI, to make it possible for various
-		 * DDL-replicating extensions to catch that call and do something about
-		 * it. --sk
-		 */
-
-		/* Get typname of range_bound_type to perform cast */
-		typeTuple = SearchSysCache1(TYPEOID, ObjectIdGetDatum(range_bound_type));
-		Assert(HeapTupleIsValid(typeTuple));
-		typname = pstrdup(NameStr(((Form_pg_type) GETSTRUCT(typeTuple))->typname));
-		ReleaseSysCache(typeTuple);
-
-		/* Construct call to create_single_range_partition() */
-		create_sql = psprintf(
-			"select %s.create_single_range_partition('%s.%s', '%s'::%s, '%s'::%s, '%s.%s')",
-			quote_identifier(get_namespace_name(get_pathman_schema())),
-			quote_identifier(parent_nsp_name),
-			quote_identifier(get_rel_name(parent_relid)),
-			IsInfinite(&bounds[0]) ? "NULL" : datum_to_cstring(bounds[0].value, range_bound_type),
-			typname,
-			IsInfinite(&bounds[1]) ? "NULL" : datum_to_cstring(bounds[1].value, range_bound_type),
-			typname,
-			quote_identifier(parent_nsp_name),
-			quote_identifier(partition_name)
-		);
-
-		/* ...and call it. */
-		SPI_connect();
-		PushActiveSnapshot(GetTransactionSnapshot());
-		rc = SPI_execute(create_sql, false, 0);
-		if (rc <= 0 || SPI_processed != 1)
-			elog(ERROR, "Failed to create range partition");
-		last_partition = DatumGetObjectId(SPI_getbinval(SPI_tuptable->vals[0],
-														SPI_tuptable->tupdesc,
-														1, &isnull));
-		Assert(!isnull);
-		SPI_finish();
-		PopActiveSnapshot();
+		/* Bounds & names of create_range_partitions_internal() are ascending */
+		if (should_append)
+		{
+			bounds = lappend(bounds, bound_cstr);
+			names = lappend(names, qualified_name);
+		}
+		else
+		{
+			bounds = lcons(bound_cstr, bounds);
+			names = lcons(qualified_name, names);
+		}
 
 #ifdef USE_ASSERT_CHECKING
 		elog(DEBUG2, "%s partition with following='%s' & leading='%s' [%u]",
@@ -638,6 +753,61 @@ spawn_partitions_val(Oid parent_relid,				/* parent's Oid */
 #endif
 	}
 
+	/* Value is always beyond the bound we've started from */
+	Assert(names != NIL);
+
+	/* Add parent's MIN\MAX boundary */
+	start_bound_cstr = psprintf("%s::%s",
+								quote_literal_cstr(datum_to_cstring(start_bound,
+																	range_bound_type)),
+								typname);
+	if (should_append)
+		bounds = lcons(start_bound_cstr, bounds);
+	else
+		bounds = lappend(bounds, start_bound_cstr);
+
+	/* Build array literals */
+	initStringInfo(&bounds_sql);
+	foreach (lc, bounds)
+		appendStringInfo(&bounds_sql, "%s%s",
+						 bounds_sql.len > 0 ? ", " : "",
+						 (char *) lfirst(lc));
+
+	initStringInfo(&names_sql);
+	foreach (lc, names)
+		appendStringInfo(&names_sql, "%s%s",
+						 names_sql.len > 0 ? ", " : "",
+						 (char *) lfirst(lc));
+
+	/*
+	 * Instead of directly calling create_range_partitions_bulk()
+	 * we are going to call it through SPI, to make it possible for various
+	 * DDL-replicating extensions to catch that call and do something about
+	 * it. All partitions are created by a single call, so that parent's
+	 * checks and invalidation are not repeated for each one of them. --sk
+	 */
+	create_sql = psprintf(
+		"select %s.create_range_partitions_internal('%s.%s', ARRAY[%s], ARRAY[%s], NULL)",
+		quote_identifier(get_namespace_name(get_pathman_schema())),
+		quote_identifier(parent_nsp_name),
+		quote_identifier(get_rel_name(parent_relid)),
+		bounds_sql.data,
+		names_sql.data
+	);
+
+	/* ...and call it. */
+	SPI_connect();
+	PushActiveSnapshot(GetTransactionSnapshot());
+	rc = SPI_execute(create_sql, false, 0);
+	if (rc <= 0 || SPI_processed != 1)
+		elog(ERROR, "Failed to create range partitions");
+	SPI_finish();
+	PopActiveSnapshot();
+
+	/* The last spawned partition is the one to store 'value' */
+	last_partition = get_relname_relid(partition_name, parent_nsp);
+	Assert(OidIsValid(last_partition));
+
 	return last_partition;
 }
 
@@ -724,26 +894,22 @@ create_single_partition_internal(Oid parent_relid,
 								 RangeVar *partition_rv,
 								 char *tablespace)
 {
-	/* Value to be returned */
-	Oid					partition_relid = InvalidOid; /* safety */
+	partition_parent_info	parent;
 
-	/* Parent's namespace and name */
-	Oid					parent_nsp;
-	char			   *parent_name,
-					   *parent_nsp_name;
+	/* Lock parent, check privileges and fetch its properties */
+	prepare_partition_parent(parent_relid, &parent);
 
-	/* Elements of the "CREATE TABLE" query tree */
-	RangeVar		   *parent_rv;
-	TableLikeClause		like_clause;
-	CreateStmt			create_stmt;
-	List			   *create_stmts;
-	ListCell		   *lc;
-
-	/* Current user and security context */
-	Oid					save_userid;
-	int					save_sec_context;
-	bool				need_priv_escalation = !superuser(); /* we might be a SU */
+	return create_partition_using_parent(&parent, partition_rv,
+										 tablespace, NIL);
+}
 
+/*
+ * Lock parent, make sure we're allowed to create its partitions
+ * and cache properties shared by all of them.
+ */
+static void
+prepare_partition_parent(Oid parent_relid, partition_parent_info *parent)
+{
 	/* Lock parent and check if it exists */
 	LockRelationOid(parent_relid, ShareUpdateExclusiveLock);
 	if (!SearchSysCacheExists1(RELOID, ObjectIdGetDatum(parent_relid)))
@@ -755,41 +921,70 @@ create_single_partition_internal(Oid parent_relid,
 			 get_rel_name_or_relid(parent_relid));
 
 	/* Do we have to escalate privileges? */
-	if (need_priv_escalation)
+	parent->need_priv_escalation = !superuser(); /* we might be a SU */
+
+	/* Check that user's allowed to spawn partitions */
+	if (parent->need_priv_escalation &&
+		ACLCHECK_OK != pg_class_aclcheck(parent_relid, GetUserId(),
+										 ACL_SPAWN_PARTITIONS))
+		ereport(ERROR,
+				(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+				 errmsg("permission denied for parent relation \"%s\"",
+						get_rel_name_or_relid(parent_relid)),
+				 errdetail("user is not allowed to create new partitions"),
+				 errhint("consider granting INSERT privilege")));
+
+	parent->parent_relid = parent_relid;
+
+	/* Make up parent's RangeVar */
+	parent->parent_rv = makeRangeVar(get_namespace_name(get_rel_namespace(parent_relid)),
+									 get_rel_name(parent_relid), -1);
+
+	/* Partition should have the same owner as the parent */
+	parent->parent_owner = get_rel_owner(parent_relid);
+
+	/* Partition is created in parent's tablespace by default */
+	parent->parent_tablespace = get_tablespace_name(get_rel_tablespace(parent_relid));
+}
+
+/* Create a partition-like table with optional table constraints */
+static Oid
+create_partition_using_parent(partition_parent_info *parent,
+							  RangeVar *partition_rv,
+							  char *tablespace,
+							  List *constraints)
+{
+	/* Value to be returned */
+	Oid					partition_relid = InvalidOid; /* safety */
+	Oid					parent_relid = parent->parent_relid;
+
+	/* Elements of the "CREATE TABLE" query tree */
+	TableLikeClause		like_clause;
+	CreateStmt			create_stmt;
+	List			   *create_stmts;
+	ListCell		   *lc;
+
+	/* Current user and security context */
+	Oid					save_userid;
+	int					save_sec_context;
+
+	/* Become superuser in order to bypass various ACL checks */
+	if (parent->need_priv_escalation)
 	{
 		/* Get current user's Oid and security context */
 		GetUserIdAndSecContext(&save_userid, &save_sec_context);
 
-		/* Check that user's allowed to spawn partitions */
-		if (ACLCHECK_OK != pg_class_aclcheck(parent_relid, save_userid,
-											 ACL_SPAWN_PARTITIONS))
-			ereport(ERROR,
-					(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
-					 errmsg("permission denied for parent relation \"%s\"",
-							get_rel_name_or_relid(parent_relid)),
-					 errdetail("user is not allowed to create new partitions"),
-					 errhint("consider granting INSERT privilege")));
-
-		/* Become superuser in order to bypass various ACL checks */
 		SetUserIdAndSecContext(BOOTSTRAP_SUPERUSERID,
 							   save_sec_context | SECURITY_LOCAL_USERID_CHANGE);
 	}
 
-	/* Cache parent's namespace and name */
-	parent_name = get_rel_name(parent_relid);
-	parent_nsp = get_rel_namespace(parent_relid);
-	parent_nsp_name = get_namespace_name(parent_nsp);
-
-	/* Make up parent's RangeVar */
-	parent_rv = makeRangeVar(parent_nsp_name, parent_name, -1);
-
-	/* If no 'tablespace' is provided, get parent's tablespace */
+	/* If no 'tablespace' is provided, use parent's tablespace */
 	if (!tablespace)
-		tablespace = get_tablespace_name(get_rel_tablespace(parent_relid));
+		tablespace = parent->parent_tablespace;
 
 	/* Initialize TableLikeClause structure */
 	NodeSetTag(&like_clause, T_TableLikeClause);
-	like_clause.relation		= copyObject(parent_rv);
+	like_clause.relation		= copyObject(parent->parent_rv);
 	like_clause.options			= CREATE_TABLE_LIKE_DEFAULTS |
 								  CREATE_TABLE_LIKE_INDEXES |
 								  CREATE_TABLE_LIKE_STORAGE;
@@ -798,9 +993,9 @@ create_single_partition_internal(Oid parent_relid,
 	NodeSetTag(&create_stmt, T_CreateStmt);
 	create_stmt.relation		= copyObject(partition_rv);
 	create_stmt.tableElts		= list_make1(copyObject(&like_clause));
-	create_stmt.inhRelations	= list_make1(copyObject(parent_rv));
+	create_stmt.inhRelations	= list_make1(copyObject(parent->parent_rv));
 	create_stmt.ofTypename		= NULL;
-	create_stmt.constraints		= NIL;
+	create_stmt.constraints		= constraints;
 	create_stmt.options			= NIL;
 	create_stmt.oncommit		= ONCOMMIT_NOOP;
 	create_stmt.tablespacename	= tablespace;
@@ -829,14 +1024,9 @@ create_single_partition_internal(Oid parent_relid,
 
 		if (IsA(cur_stmt, CreateStmt))
 		{
-			Oid child_relowner;
-
-			/* Partition should have the same owner as the parent */
-			child_relowner = get_rel_owner(parent_relid);
-
 			/* Create a partition and save its Oid */
 			partition_relid = create_table_using_stmt((CreateStmt *) cur_stmt,
-													  child_relowner).objectId;
+													  parent->parent_owner).objectId;
 
 			/* Copy attributes to partition */
 			copy_rel_options(parent_relid, partition_relid);
@@ -905,7 +1095,7 @@ create_single_partition_internal(Oid parent_relid,
 	}
 
 	/* Restore user's privileges */
-	if (need_priv_escalation)
+	if (parent->need_priv_escalation)
 		SetUserIdAndSecContext(save_userid, save_sec_context);
 
 	return partition_relid;
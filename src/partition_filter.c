@@ -22,10 +22,15 @@
 #endif
 #include "access/xact.h"
 #include "catalog/pg_class.h"
+#include "catalog/pg_collation.h"
 #include "catalog/pg_type.h"
 #include "foreign/fdwapi.h"
 #include "foreign/foreign.h"
 #include "nodes/nodeFuncs.h"
+#if PG_VERSION_NUM >= 120000
+#include "optimizer/optimizer.h"
+#endif
+#include "optimizer/clauses.h"
 #include "rewrite/rewriteManip.h"
 #include "utils/guc.h"
 #include "utils/memutils.h"
@@ -69,6 +74,7 @@ static const struct config_enum_entry pg_pathman_insert_into_fdw_options[] = {
 
 bool				pg_pathman_enable_partition_filter = true;
 int					pg_pathman_insert_into_fdw = PF_FDW_INSERT_POSTGRES;
+int					pg_pathman_partition_filter_batch_size = 1;
 
 CustomScanMethods	partition_filter_plan_methods;
 CustomExecMethods	partition_filter_exec_methods;
@@ -92,9 +98,19 @@ static Node *fix_returning_list_mutator(Node *node, void *state);
 static Index append_rte_to_estate(EState *estate, RangeTblEntry *rte, Relation child_rel);
 static int append_rri_to_estate(EState *estate, ResultRelInfo *rri);
 
+static void reset_last_partition(ResultPartsStorage *parts_storage);
+
 static void pf_memcxt_callback(void *arg);
 static estate_mod_data * fetch_estate_mod_data(EState *estate);
 
+static TupleTableSlot *pfilter_next_batch_tuple(PartitionFilterState *state,
+												ResultRelInfoHolder **rri_holder);
+static void pfilter_fill_batch(PartitionFilterState *state);
+static bool pfilter_batching_allowed(PartitionFilterState *state,
+									 ResultRelInfo *parent_rri);
+static bool rri_has_row_insert_triggers(ResultRelInfo *rri);
+static int pfilter_cmp_batch_tuples(const void *a, const void *b, void *arg);
+
 
 void
 init_partition_filter_static_data(void)
@@ -134,6 +150,19 @@ init_partition_filter_static_data(void)
 							 NULL,
 							 NULL);
 
+	DefineCustomIntVariable("pg_pathman.partition_filter_batch_size",
+							"Number of tuples routed by " INSERT_NODE_NAME " at once "
+							"(tuples of a batch are grouped by partition).",
+							NULL,
+							&pg_pathman_partition_filter_batch_size,
+							1,
+							1, 10000,
+							PGC_USERSET,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
 	RegisterCustomScanMethods(&partition_filter_plan_methods);
 }
 
@@ -203,6 +232,11 @@ init_result_parts_storage(ResultPartsStorage *parts_storage,
 
 	/* Build expression context */
 	parts_storage->prel_econtext = CreateExprContext(parts_storage->estate);
+
+	/* Nothing has been selected yet */
+	parts_storage->last_part_hits = 0;
+	parts_storage->last_part_misses = 0;
+	reset_last_partition(parts_storage);
 }
 
 /* Free ResultPartsStorage (close relations etc) */
@@ -258,6 +292,22 @@ fini_result_parts_storage(ResultPartsStorage *parts_storage)
 	close_pathman_relation_info(parts_storage->prel);
 }
 
+/* Forget partition selected last time, prepare for 'prel' */
+static void
+reset_last_partition(ResultPartsStorage *parts_storage)
+{
+	PartRelationInfo *prel = parts_storage->prel;
+
+	parts_storage->last_rri_holder = NULL;
+	parts_storage->last_part_idx = 0;
+
+	/* Comparison function is required unless we use IntRangeIndex */
+	if (prel->parttype == PT_RANGE && !PrelGetIntRangeIndex(prel))
+		fmgr_info_cxt(prel->cmp_proc,
+					  &parts_storage->last_part_cmp,
+					  parts_storage->estate->es_query_cxt);
+}
+
 /* Find a ResultRelInfo for the partition using ResultPartsStorage */
 ResultRelInfoHolder *
 scan_result_parts_storage(ResultPartsStorage *parts_storage, Oid partid)
@@ -413,6 +463,9 @@ refresh_result_parts_storage(ResultPartsStorage *parts_storage, Oid partid)
 		parts_storage->prel = get_pathman_relation_info(partid);
 		shout_if_prel_is_invalid(partid, parts_storage->prel, PT_ANY);
 
+		/* Bounds of partitions might have changed */
+		reset_last_partition(parts_storage);
+
 		return parts_storage->prel;
 	}
 	else
@@ -508,6 +561,35 @@ find_partitions_for_value(Datum value, Oid value_type,
 	return get_partition_oids(ranges, nparts, prel, false);
 }
 
+/*
+ * Check if 'value' belongs to the partition selected last time.
+ */
+static inline bool
+fits_last_partition(const ResultPartsStorage *parts_storage, Datum value)
+{
+	const PartRelationInfo *prel = parts_storage->prel;
+	const IntRangeIndex	   *int_ranges = PrelGetIntRangeIndex(prel);
+	uint32					i = parts_storage->last_part_idx;
+
+	/* Compare native integers if possible */
+	if (int_ranges)
+	{
+		int64 int_value = DatumGetIntRangeValue(value, int_ranges->typid);
+
+		return cmp_int_range_bound(int_ranges, int_value, i, false) >= 0 &&
+			   cmp_int_range_bound(int_ranges, int_value, i, true) < 0;
+	}
+	else
+	{
+		const RangeEntry   *range = &PrelGetRangesArray(prel)[i];
+		Bound				value_bound = MakeBound(value);
+		FmgrInfo		   *cmp_func = (FmgrInfo *) &parts_storage->last_part_cmp;
+
+		return cmp_bounds(cmp_func, prel->ev_collid, &value_bound, &range->min) >= 0 &&
+			   cmp_bounds(cmp_func, prel->ev_collid, &value_bound, &range->max) < 0;
+	}
+}
+
 /*
  * Smart wrapper for scan_result_parts_storage().
  */
@@ -524,10 +606,10 @@ select_partition_for_insert(ResultPartsStorage *parts_storage,
 
 	Datum					value;
 	bool					isnull;
-	bool					compute_value = true;
+	bool					compute_value = true,
+							top_level = true;
 
-	Oid					   *parts;
-	int						nparts;
+	int						part_idx;
 	ResultRelInfoHolder	   *result;
 
 	do
@@ -548,25 +630,33 @@ select_partition_for_insert(ResultPartsStorage *parts_storage,
 			compute_value = false;
 		}
 
-		/* Search for matching partitions */
-		parts = find_partitions_for_value(value, prel->ev_type, prel, &nparts);
-
-		if (nparts > 1)
+		/* Most likely it's the same partition as the last time */
+		if (top_level && parts_storage->last_rri_holder)
 		{
-			elog(ERROR, ERR_PART_ATTR_MULTIPLE);
+			if (fits_last_partition(parts_storage, value))
+			{
+				parts_storage->last_part_hits++;
+				return parts_storage->last_rri_holder;
+			}
+
+			parts_storage->last_part_misses++;
 		}
-		else if (nparts == 0)
+
+		/* Search for matching partition */
+		find_partition_indices_for_values(&value, 1, prel, &part_idx);
+
+		if (part_idx < 0)
 		{
 			partition_relid = create_partitions_for_value(parent_relid,
 														  value, prel->ev_type);
 		}
-		else partition_relid = parts[0];
+		else partition_relid = PrelGetChildrenArray(prel)[part_idx];
 
 		/* Get ResultRelationInfo holder for the selected partition */
 		result = scan_result_parts_storage(parts_storage, partition_relid);
 
 		/* Somebody has dropped or created partitions */
-		if ((nparts == 0 || result == NULL) && !PrelIsFresh(prel))
+		if ((part_idx < 0 || result == NULL) && !PrelIsFresh(prel))
 		{
 			/* Try building a new 'prel' for this relation */
 			prel = refresh_result_parts_storage(parts_storage, parent_relid);
@@ -579,10 +669,18 @@ select_partition_for_insert(ResultPartsStorage *parts_storage,
 			expr_state = result->prel_expr_state;
 			parent_relid = result->partid;
 			compute_value = true;
+			top_level = false;
 
 			/* Repeat with a new dispatch */
 			result = NULL;
 		}
+		/* Remember RANGE partition for the next time */
+		else if (result && top_level && part_idx >= 0 &&
+				 prel->parttype == PT_RANGE)
+		{
+			parts_storage->last_rri_holder = result;
+			parts_storage->last_part_idx = part_idx;
+		}
 
 		Assert(prel);
 	}
@@ -592,6 +690,170 @@ select_partition_for_insert(ResultPartsStorage *parts_storage,
 	return result;
 }
 
+/*
+ * Find indices of matching partitions for a batch of 'values'
+ * (of type prel->ev_type). Index is set to -1 if there's none.
+ */
+void
+find_partition_indices_for_values(const Datum *values, int nvalues,
+								  const PartRelationInfo *prel,
+								  int *indices)
+{
+	int i;
+
+	switch (prel->parttype)
+	{
+		case PT_HASH:
+			{
+				FmgrInfo	hash_finfo;
+				uint32		nparts = PrelChildrenCount(prel);
+
+				/* Look up hash function only once */
+				fmgr_info(prel->hash_proc, &hash_finfo);
+
+				for (i = 0; i < nvalues; i++)
+				{
+					/* See handle_const() for the choice of collation */
+					Datum hash = FunctionCall1Coll(&hash_finfo,
+												   DEFAULT_COLLATION_OID,
+												   values[i]);
+
+					indices[i] = hash_to_part_index(DatumGetInt32(hash), nparts);
+				}
+			}
+			break;
+
+		case PT_RANGE:
+			{
+				const IntRangeIndex	   *int_ranges = PrelGetIntRangeIndex(prel);
+				FmgrInfo				cmp_finfo;
+				Oid						value_type = getBaseType(prel->ev_type);
+
+				/* Compare native integers if possible */
+				if (int_ranges)
+				{
+					for (i = 0; i < nvalues; i++)
+					{
+						int64 value = DatumGetIntRangeValue(values[i],
+															int_ranges->typid);
+
+						indices[i] = int_range_index_find(int_ranges, value);
+					}
+
+					break;
+				}
+
+				/* Else look up comparison function only once */
+				fill_type_cmp_fmgr_info(&cmp_finfo, value_type, value_type);
+
+				for (i = 0; i < nvalues; i++)
+				{
+					WrapperNode wrap;
+
+					select_range_partitions(values[i],
+											prel->ev_collid,
+											&cmp_finfo,
+											PrelGetRangesArray(prel),
+											PrelChildrenCount(prel),
+											NULL,
+											BTEqualStrategyNumber,
+											&wrap);
+
+					indices[i] = (wrap.rangeset != NIL) ?
+									irange_lower(linitial_irange(wrap.rangeset)) :
+									-1;
+
+					list_free(wrap.rangeset);
+				}
+			}
+			break;
+
+		default:
+			WrongPartType(prel->parttype);
+	}
+}
+
+/*
+ * Batch version of select_partition_for_insert().
+ *
+ * Values of partitioning expression are computed and routed at once.
+ * Rows that need anything but a lookup (new partitions, multilevel
+ * partitioning, concurrent DDL) are handled one by one.
+ */
+void
+select_partitions_for_insert(ResultPartsStorage *parts_storage,
+							 TupleTableSlot **slots, int nslots,
+							 ResultRelInfoHolder **results)
+{
+	PartRelationInfo	   *prel = parts_storage->prel;
+	ExprState			   *expr_state = parts_storage->prel_expr_state;
+	ExprContext			   *expr_context = parts_storage->prel_econtext;
+
+	Datum				   *values;
+	int					   *indices;
+	Oid					   *partids;
+	int						i;
+
+	/* Nothing to batch */
+	if (nslots == 1)
+	{
+		results[0] = select_partition_for_insert(parts_storage, slots[0]);
+		return;
+	}
+
+	values = palloc(nslots * sizeof(Datum));
+	indices = palloc(nslots * sizeof(int));
+	partids = palloc(nslots * sizeof(Oid));
+
+	/* Values should stay valid until the whole batch is routed */
+	ResetExprContext(expr_context);
+
+	for (i = 0; i < nslots; i++)
+	{
+		bool isnull;
+
+		/* Execute expression */
+		expr_context->ecxt_scantuple = slots[i];
+		values[i] = ExecEvalExprCompat(expr_state, expr_context, &isnull);
+
+		if (isnull)
+			elog(ERROR, ERR_PART_ATTR_NULL);
+	}
+
+	/* Search for matching partitions */
+	find_partition_indices_for_values(values, nslots, prel, indices);
+
+	/* 'prel' might be refreshed below, so fetch Oids right now */
+	for (i = 0; i < nslots; i++)
+		partids[i] = (indices[i] >= 0) ?
+						PrelGetChildrenArray(prel)[indices[i]] :
+						InvalidOid;
+
+	for (i = 0; i < nslots; i++)
+	{
+		ResultRelInfoHolder *result = NULL;
+
+		if (OidIsValid(partids[i]))
+		{
+			result = scan_result_parts_storage(parts_storage, partids[i]);
+
+			/* This partition is a parent itself, take the slow path */
+			if (result && result->prel)
+				result = NULL;
+		}
+
+		/* Let select_partition_for_insert() handle everything else */
+		if (result == NULL)
+			result = select_partition_for_insert(parts_storage, slots[i]);
+
+		results[i] = result;
+	}
+
+	pfree(values);
+	pfree(indices);
+	pfree(partids);
+}
+
 static ExprState *
 prepare_expr_state(const PartRelationInfo *prel,
 				   Relation source_rel,
@@ -741,6 +1003,19 @@ partition_filter_begin(CustomScanState *node, EState *estate, int eflags)
 							  state->on_conflict_action != ONCONFLICT_NONE,
 							  RPS_RRI_CB(prepare_rri_for_insert, state),
 							  RPS_RRI_CB(NULL, NULL));
+
+	/* Check if we may read ahead and reorder subplan's tuples */
+	state->batch_size = pfilter_batching_allowed(state, current_rri) ?
+							pg_pathman_partition_filter_batch_size :
+							1;
+
+	/* Prepare storage for batched routing */
+	if (state->batch_size > 1)
+	{
+		state->batch_slots = palloc0(state->batch_size * sizeof(TupleTableSlot *));
+		state->batch_holders = palloc(state->batch_size * sizeof(ResultRelInfoHolder *));
+		state->batch_order = palloc(state->batch_size * sizeof(int));
+	}
 }
 
 TupleTableSlot *
@@ -752,24 +1027,31 @@ partition_filter_exec(CustomScanState *node)
 	EState				   *estate = node->ss.ps.state;
 	PlanState			   *child_ps = (PlanState *) linitial(node->custom_ps);
 	TupleTableSlot		   *slot;
+	ResultRelInfoHolder	   *rri_holder = NULL;
 
-	slot = ExecProcNode(child_ps);
+	/* Fetch a tuple (maybe routed already) */
+	if (state->batch_size > 1)
+		slot = pfilter_next_batch_tuple(state, &rri_holder);
+	else
+		slot = ExecProcNode(child_ps);
 
 	if (!TupIsNull(slot))
 	{
 		MemoryContext			old_mcxt;
-		ResultRelInfoHolder	   *rri_holder;
 		ResultRelInfo		   *rri;
 
-		/* Switch to per-tuple context */
-		old_mcxt = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
+		if (!rri_holder)
+		{
+			/* Switch to per-tuple context */
+			old_mcxt = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
 
-		/* Search for a matching partition */
-		rri_holder = select_partition_for_insert(&state->result_parts, slot);
+			/* Search for a matching partition */
+			rri_holder = select_partition_for_insert(&state->result_parts, slot);
 
-		/* Switch back and clean up per-tuple context */
-		MemoryContextSwitchTo(old_mcxt);
-		ResetExprContext(econtext);
+			/* Switch back and clean up per-tuple context */
+			MemoryContextSwitchTo(old_mcxt);
+			ResetExprContext(econtext);
+		}
 
 		rri = rri_holder->result_rel_info;
 
@@ -830,18 +1112,224 @@ partition_filter_end(CustomScanState *node)
 	/* Free slot for tuple conversion */
 	if (state->tup_convert_slot)
 		ExecDropSingleTupleTableSlot(state->tup_convert_slot);
+
+	/* Free slots of batch */
+	if (state->batch_slots)
+	{
+		int i;
+
+		for (i = 0; i < state->batch_size; i++)
+			if (state->batch_slots[i])
+				ExecDropSingleTupleTableSlot(state->batch_slots[i]);
+	}
+}
+
+/*
+ * Emit next tuple of current batch (grouped by partition).
+ */
+static TupleTableSlot *
+pfilter_next_batch_tuple(PartitionFilterState *state,
+						 ResultRelInfoHolder **rri_holder)
+{
+	int idx;
+
+	/* Fetch and route a new batch if needed */
+	if (state->batch_pos >= state->batch_count)
+	{
+		if (state->batch_eof)
+			return NULL;
+
+		pfilter_fill_batch(state);
+
+		if (state->batch_count == 0)
+			return NULL;
+	}
+
+	idx = state->batch_order[state->batch_pos++];
+
+	*rri_holder = state->batch_holders[idx];
+	return state->batch_slots[idx];
+}
+
+/*
+ * Read up to 'batch_size' tuples from subplan and route them at once.
+ */
+static void
+pfilter_fill_batch(PartitionFilterState *state)
+{
+	ExprContext	   *econtext = state->css.ss.ps.ps_ExprContext;
+	EState		   *estate = state->css.ss.ps.state;
+	PlanState	   *child_ps = (PlanState *) linitial(state->css.custom_ps);
+	MemoryContext	old_mcxt;
+	int				i;
+
+	state->batch_count = 0;
+	state->batch_pos = 0;
+
+	while (state->batch_count < state->batch_size)
+	{
+		TupleTableSlot *slot = ExecProcNode(child_ps),
+					   *copy;
+
+		if (TupIsNull(slot))
+		{
+			state->batch_eof = true;
+			break;
+		}
+
+		/* Subplan's slot will be overwritten, so we have to copy tuple */
+		if (!(copy = state->batch_slots[state->batch_count]))
+		{
+			old_mcxt = MemoryContextSwitchTo(estate->es_query_cxt);
+			copy = MakeTupleTableSlotCompat(&TTSOpsBufferHeapTuple);
+			state->batch_slots[state->batch_count] = copy;
+			MemoryContextSwitchTo(old_mcxt);
+		}
+
+		if (copy->tts_tupleDescriptor != slot->tts_tupleDescriptor)
+			ExecSetSlotDescriptor(copy, slot->tts_tupleDescriptor);
+
+		ExecCopySlot(copy, slot);
+
+		state->batch_order[state->batch_count] = state->batch_count;
+		state->batch_count++;
+	}
+
+	if (state->batch_count == 0)
+		return;
+
+	/* Switch to per-tuple context */
+	old_mcxt = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
+
+	/* Search for matching partitions */
+	select_partitions_for_insert(&state->result_parts,
+								 state->batch_slots,
+								 state->batch_count,
+								 state->batch_holders);
+
+	/* Switch back and clean up per-tuple context */
+	MemoryContextSwitchTo(old_mcxt);
+	ResetExprContext(econtext);
+
+	/* Row triggers of partitions should see tuples in original order */
+	for (i = 0; i < state->batch_count; i++)
+		if (rri_has_row_insert_triggers(state->batch_holders[i]->result_rel_info))
+			return;
+
+	/* Group tuples by partition (keep original order within groups) */
+	qsort_arg(state->batch_order, state->batch_count, sizeof(int),
+			  pfilter_cmp_batch_tuples, (void *) state->batch_holders);
+}
+
+/* qsort_arg() comparator for batch_order */
+static int
+pfilter_cmp_batch_tuples(const void *a, const void *b, void *arg)
+{
+	ResultRelInfoHolder	  **holders = (ResultRelInfoHolder **) arg;
+	int						idx_a = *(const int *) a,
+							idx_b = *(const int *) b;
+	Oid						partid_a = holders[idx_a]->partid,
+							partid_b = holders[idx_b]->partid;
+
+	if (partid_a != partid_b)
+		return (partid_a < partid_b) ? -1 : 1;
+
+	return (idx_a > idx_b) - (idx_a < idx_b);
+}
+
+/*
+ * Check if tuples of subplan may be routed in batches.
+ *
+ * Reordering is visible to RETURNING and row triggers, and complex
+ * subplans (or volatile functions) might observe rows inserted so far.
+ */
+static bool
+pfilter_batching_allowed(PartitionFilterState *state, ResultRelInfo *parent_rri)
+{
+	Plan *subplan = state->subplan;
+
+	if (pg_pathman_partition_filter_batch_size <= 1)
+		return false;
+
+	/* Only INSERTs may be reordered (UPDATE needs current tuple) */
+	if (state->command_type != CMD_INSERT)
+		return false;
+
+	/* RETURNING would emit rows in a different order */
+	if (state->returning_list != NIL)
+		return false;
+
+	if (rri_has_row_insert_triggers(parent_rri))
+		return false;
+
+	switch (nodeTag(subplan))
+	{
+		case T_SeqScan:
+		case T_IndexScan:
+		case T_IndexOnlyScan:
+		case T_BitmapHeapScan:
+			break;
+
+		case T_ValuesScan:
+			if (contain_volatile_functions_not_nextval(
+					(Node *) ((ValuesScan *) subplan)->values_lists))
+				return false;
+			break;
+
+		default:
+			return false;
+	}
+
+	return !contain_volatile_functions_not_nextval((Node *) subplan->targetlist) &&
+		   !contain_volatile_functions_not_nextval((Node *) subplan->qual);
+}
+
+/* Does relation have any ROW triggers on INSERT? */
+static bool
+rri_has_row_insert_triggers(ResultRelInfo *rri)
+{
+	TriggerDesc *trigdesc = rri->ri_TrigDesc;
+
+	return trigdesc && (trigdesc->trig_insert_before_row ||
+						trigdesc->trig_insert_after_row ||
+						trigdesc->trig_insert_instead_row);
 }
 
 void
 partition_filter_rescan(CustomScanState *node)
 {
-	elog(ERROR, "partition_filter_rescan is not implemented");
+	PartitionFilterState   *state = (PartitionFilterState *) node;
+	PlanState			   *child_ps = (PlanState *) linitial(node->custom_ps);
+
+	/* Forget tuples of current batch */
+	state->batch_count = 0;
+	state->batch_pos = 0;
+	state->batch_eof = false;
+
+	/* Let subplan know about changed params (see ExecReScan()) */
+	if (node->ss.ps.chgParam != NULL)
+		UpdateChangedParamSet(child_ps, node->ss.ps.chgParam);
+
+	/* Subplan will be rescanned by ExecProcNode() if params have changed */
+	if (child_ps->chgParam == NULL)
+		ExecReScan(child_ps);
 }
 
 void
 partition_filter_explain(CustomScanState *node, List *ancestors, ExplainState *es)
 {
-	/* Nothing to do here now */
+	PartitionFilterState   *state = (PartitionFilterState *) node;
+	ResultPartsStorage	   *parts_storage = &state->result_parts;
+
+	/* Show efficiency of last partition cache */
+	if (es->analyze &&
+		(parts_storage->last_part_hits > 0 || parts_storage->last_part_misses > 0))
+	{
+		ExplainPropertyIntegerCompat("Last Partition Hits", NULL,
+									 parts_storage->last_part_hits, es);
+		ExplainPropertyIntegerCompat("Last Partition Misses", NULL,
+									 parts_storage->last_part_misses, es);
+	}
 }
 
 
@@ -0,0 +1,498 @@
+/* ------------------------------------------------------------------------
+ *
+ * partition_mover.c
+ *		Move rows from parent table to its partitions
+ *
+ * Copyright (c) 2020, Postgres Professional
+ *
+ * ------------------------------------------------------------------------
+ */
+
+#include "compat/pg_compat.h"
+#include "partition_filter.h"
+#include "partition_mover.h"
+#include "relation_info.h"
+#include "utility_stmt_hooking.h"
+
+#include "access/heapam.h"
+#include "access/htup_details.h"
+#if PG_VERSION_NUM >= 120000
+#include "access/table.h"
+#include "access/tableam.h"
+#endif
+#include "access/xact.h"
+#include "catalog/pg_class.h"
+#include "commands/trigger.h"
+#include "executor/executor.h"
+#include "miscadmin.h"
+#include "nodes/makefuncs.h"
+#include "storage/bufmgr.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+#include "utils/rls.h"
+#include "utils/snapmgr.h"
+#include "utils/syscache.h"
+
+
+/* Limits of a batch of rows routed to partitions at once */
+#define PARTITION_MOVER_BATCH_SIZE		1000
+#define PARTITION_MOVER_BATCH_BYTES		65535
+
+
+static bool row_fits_range(ResultPartsStorage *parts_storage,
+						   TupleTableSlot *slot,
+						   FmgrInfo *cmp_func,
+						   Oid collid,
+						   const Datum *min_value,
+						   const Datum *max_value);
+
+static bool delete_parent_row(Relation parent_rel,
+							  HeapTuple tuple,
+							  CommandId mycid);
+
+static void prepare_rri_for_mover(ResultRelInfoHolder *rri_holder,
+								  const ResultPartsStorage *rps_storage);
+
+
+/*
+ * Check if move_parent_rows() is able to relocate rows of this table.
+ * Otherwise they should be moved by _partition_data_concurrent().
+ */
+bool
+can_move_parent_rows(Oid parent_relid)
+{
+	PartRelationInfo   *prel;
+	HeapTuple			htup;
+	bool				result = true;
+	uint32				i;
+
+	/* Policies are applied by the planner only */
+	if (check_enable_rls(parent_relid, InvalidOid, true) == RLS_ENABLED)
+		return false;
+
+	htup = SearchSysCache1(RELOID, ObjectIdGetDatum(parent_relid));
+	if (!HeapTupleIsValid(htup))
+		return false;
+
+	/* Triggers of parent table expect plain DELETE & INSERT */
+	if (((Form_pg_class) GETSTRUCT(htup))->relhastriggers)
+		result = false;
+
+	ReleaseSysCache(htup);
+
+	if (!result)
+		return false;
+
+	prel = get_pathman_relation_info(parent_relid);
+	if (!prel)
+		return false;
+
+	/* We don't insert into foreign partitions (see PartitionFilter) */
+	for (i = 0; i < PrelChildrenCount(prel); i++)
+	{
+		if (get_rel_relkind(PrelGetChildrenArray(prel)[i]) == RELKIND_FOREIGN_TABLE)
+		{
+			result = false;
+			break;
+		}
+	}
+
+	close_pathman_relation_info(prel);
+
+	return result;
+}
+
+/*
+ * Move up to 'limit' rows (all if 'limit' <= 0) from parent table to
+ * its partitions. This does the same thing as _partition_data_concurrent(),
+ * but without SPI and PL/pgSQL: parent's heap is scanned directly, each
+ * row is deleted in place and then routed by ResultPartsStorage in batches,
+ * so that rows of partitions without triggers are inserted in bulk.
+ *
+ * Only rows whose partitioning expression belongs to [min_value, max_value)
+ * are processed (NULL means no bound). Scan starts at '*start_block' and
+ * wraps around the end of relation; the block of the last row moved is
+ * stored there for the next call.
+ *
+ * Concurrently locked rows are not waited for (like FOR UPDATE NOWAIT).
+ * Returns number of rows moved, their total size is stored to '*bytes'.
+ */
+int64
+move_parent_rows(Oid parent_relid,
+				 const Datum *min_value,
+				 const Datum *max_value,
+				 int limit,
+				 BlockNumber *start_block,
+				 int64 *bytes)
+{
+	Relation			parent_rel;
+	TupleDesc			tupdesc;
+	RangeTblEntry	   *rte;
+	List			   *range_table;
+#if PG_VERSION_NUM >= 120000
+	TableScanDesc		scan;
+#else
+	HeapScanDesc		scan;
+#endif
+	BlockNumber			nblocks;
+	HeapTuple			htup;
+	TupleTableSlot	   *scan_slot;
+	bool				bounded = (min_value || max_value);
+	FmgrInfo			cmp_func;
+	Oid					cmp_collid = InvalidOid;
+
+	/* Rows are routed in batches */
+	TupleTableSlot	  **batch_slots;
+	HeapTuple		   *batch_tuples;
+	ResultRelInfoHolder **batch_holders;
+	MemoryContext		batch_mcxt;
+	int					nbatch = 0,
+						i;
+	Size				batch_bytes = 0;
+	bool				eof = false;
+
+	CopyMultiInsertInfo	miinfo;
+	ResultPartsStorage	parts_storage;
+	ResultRelInfo	   *parent_rri;
+	CommandId			mycid = GetCurrentCommandId(true);
+
+	MemoryContext		query_mcxt = CurrentMemoryContext;
+	EState			   *estate = CreateExecutorState();
+
+	int64				processed = 0;
+
+	*bytes = 0;
+
+	/* Caller should have locked it (RowExclusiveLock at least) */
+	parent_rel = heap_open(parent_relid, NoLock);
+	tupdesc = RelationGetDescr(parent_rel);
+
+	/* We need DELETE and INSERT privileges, just like SQL version */
+	rte = makeNode(RangeTblEntry);
+	rte->rtekind = RTE_RELATION;
+	rte->relid = parent_relid;
+	rte->relkind = parent_rel->rd_rel->relkind;
+	rte->requiredPerms = ACL_SELECT | ACL_INSERT | ACL_DELETE;
+	range_table = list_make1(rte);
+	ExecCheckRTPerms(range_table, true);
+
+	parent_rri = makeNode(ResultRelInfo);
+	InitResultRelInfoCompat(parent_rri,
+							parent_rel,
+							1,		/* dummy rangetable index */
+							0);
+	ExecOpenIndices(parent_rri, false);
+
+	estate->es_result_relations = parent_rri;
+	estate->es_num_result_relations = 1;
+	estate->es_result_relation_info = parent_rri;
+#if PG_VERSION_NUM >= 120000
+	ExecInitRangeTable(estate, range_table);
+#else
+	estate->es_range_table = range_table;
+#endif
+
+	/* Initialize ResultPartsStorage */
+	init_result_parts_storage(&parts_storage,
+							  parent_relid, parent_rri,
+							  estate, CMD_INSERT,
+							  RPS_CLOSE_RELATIONS,
+							  RPS_DEFAULT_SPECULATIVE,
+							  RPS_RRI_CB(prepare_rri_for_mover, NULL),
+							  RPS_RRI_CB(NULL, NULL));
+
+	/* Bounds are compared using comparison function of expression's type */
+	if (bounded)
+	{
+		fmgr_info(parts_storage.prel->cmp_proc, &cmp_func);
+		cmp_collid = parts_storage.prel->ev_collid;
+	}
+
+	/* Triggers might need a slot */
+#if PG_VERSION_NUM < 120000
+	estate->es_trig_tuple_slot = ExecInitExtraTupleSlotCompat(estate, tupdesc, nothing_here);
+#endif
+
+	/* Prepare to catch AFTER triggers of partitions */
+	AfterTriggerBeginQuery();
+
+	/* Prepare storage for a batch of rows */
+	batch_slots = (TupleTableSlot **) palloc(PARTITION_MOVER_BATCH_SIZE * sizeof(TupleTableSlot *));
+	batch_tuples = (HeapTuple *) palloc(PARTITION_MOVER_BATCH_SIZE * sizeof(HeapTuple));
+	batch_holders = (ResultRelInfoHolder **) palloc(PARTITION_MOVER_BATCH_SIZE * sizeof(ResultRelInfoHolder *));
+	batch_mcxt = AllocSetContextCreate(query_mcxt,
+									   "move_parent_rows batch",
+									   ALLOCSET_DEFAULT_SIZES);
+
+	for (i = 0; i < PARTITION_MOVER_BATCH_SIZE; i++)
+		batch_slots[i] = ExecInitExtraTupleSlotCompat(estate, NULL, &TTSOpsHeapTuple);
+
+	scan_slot = ExecInitExtraTupleSlotCompat(estate, tupdesc, &TTSOpsHeapTuple);
+
+	/* Prepare multi-insert buffers */
+	copy_multi_insert_init(&miinfo, estate);
+
+	/* Scan must not be synchronized, we choose the first block ourselves */
+	nblocks = RelationGetNumberOfBlocks(parent_rel);
+	if (*start_block >= nblocks)
+		*start_block = 0;
+
+#if PG_VERSION_NUM >= 120000
+	scan = table_beginscan_strat(parent_rel, GetActiveSnapshot(), 0, NULL,
+								 true, false);
+#else
+	scan = heap_beginscan_strat(parent_rel, GetActiveSnapshot(), 0, NULL,
+								true, false);
+#endif
+	heap_setscanlimits(scan, *start_block, InvalidBlockNumber);
+
+	while (!eof)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		/* Forget previous batch */
+		MemoryContextReset(batch_mcxt);
+		nbatch = 0;
+		batch_bytes = 0;
+
+		/* Delete a batch of rows */
+		while (nbatch < PARTITION_MOVER_BATCH_SIZE &&
+			   batch_bytes < PARTITION_MOVER_BATCH_BYTES)
+		{
+			HeapTuple tuple;
+
+			if (limit > 0 && processed + nbatch >= limit)
+			{
+				eof = true;
+				break;
+			}
+
+			if ((htup = heap_getnext(scan, ForwardScanDirection)) == NULL)
+			{
+				eof = true;
+				break;
+			}
+
+			/* Skip rows of other workers */
+			if (bounded)
+			{
+#if PG_VERSION_NUM >= 120000
+				ExecStoreHeapTuple(htup, scan_slot, false);
+#else
+				ExecStoreTuple(htup, scan_slot, InvalidBuffer, false);
+#endif
+				if (!row_fits_range(&parts_storage, scan_slot,
+									&cmp_func, cmp_collid,
+									min_value, max_value))
+					continue;
+			}
+
+			/* Row should survive the batch (copy it before deletion) */
+			MemoryContextSwitchTo(batch_mcxt);
+			tuple = heap_copytuple(htup);
+			MemoryContextSwitchTo(query_mcxt);
+
+			/* Someone has deleted this row already */
+			if (!delete_parent_row(parent_rel, htup, mycid))
+			{
+				heap_freetuple(tuple);
+				continue;
+			}
+
+			/* Place tuple in tuple slot --- but slot shouldn't free it */
+			ExecSetSlotDescriptor(batch_slots[nbatch], tupdesc);
+#if PG_VERSION_NUM >= 120000
+			ExecStoreHeapTuple(tuple, batch_slots[nbatch], false);
+#else
+			ExecStoreTuple(tuple, batch_slots[nbatch], InvalidBuffer, false);
+#endif
+
+			batch_tuples[nbatch++] = tuple;
+			batch_bytes += tuple->t_len;
+
+			/* Next call will start from this block */
+			*start_block = ItemPointerGetBlockNumber(&htup->t_self);
+		}
+
+		/* Search for matching partitions (all at once) */
+		if (nbatch > 0)
+		{
+			MemoryContextSwitchTo(batch_mcxt);
+			select_partitions_for_insert(&parts_storage,
+										 batch_slots, nbatch,
+										 batch_holders);
+			MemoryContextSwitchTo(query_mcxt);
+		}
+
+		/* Insert rows into partitions */
+		for (i = 0; i < nbatch; i++)
+		{
+			CHECK_FOR_INTERRUPTS();
+
+			/* Rows suppressed by triggers are lost, as with INSERT */
+			(void) copy_insert_routed_tuple(&miinfo,
+											batch_holders[i],
+											batch_slots[i],
+											batch_tuples[i],
+											estate, query_mcxt,
+											NULL);
+		}
+
+		processed += nbatch;
+		*bytes += batch_bytes;
+	}
+
+	heap_endscan(scan);
+
+	/* Insert remaining buffered rows */
+	copy_multi_insert_flush_all(&miinfo);
+	copy_multi_insert_fini(&miinfo);
+
+	/* Switch back to query context */
+	MemoryContextSwitchTo(query_mcxt);
+
+	/* Handle queued AFTER triggers */
+	AfterTriggerEndQuery(estate);
+
+	pfree(batch_slots);
+	pfree(batch_tuples);
+	pfree(batch_holders);
+	MemoryContextDelete(batch_mcxt);
+
+	/* Release resources for tuple table */
+	ExecResetTupleTable(estate->es_tupleTable, false);
+
+	/* Close partitions and destroy hash table */
+	fini_result_parts_storage(&parts_storage);
+
+	/* Close parent's indices */
+	ExecCloseIndices(parent_rri);
+
+	/* Release an EState along with all remaining working storage */
+	FreeExecutorState(estate);
+
+	heap_close(parent_rel, NoLock);
+
+	return processed;
+}
+
+/*
+ * Check that partitioning expression of row belongs to [min_value, max_value).
+ */
+static bool
+row_fits_range(ResultPartsStorage *parts_storage,
+			   TupleTableSlot *slot,
+			   FmgrInfo *cmp_func,
+			   Oid collid,
+			   const Datum *min_value,
+			   const Datum *max_value)
+{
+	ExprContext	   *econtext = GetPerTupleExprContext(parts_storage->estate);
+	Datum			value;
+	bool			isnull;
+	bool			result = true;
+
+	ResetExprContext(econtext);
+
+	/* Execute expression */
+	econtext->ecxt_scantuple = slot;
+	value = ExecEvalExprCompat(parts_storage->prel_expr_state, econtext, &isnull);
+
+	/* PartitionFilter will complain about it */
+	if (isnull)
+		return true;
+
+	if (min_value &&
+		DatumGetInt32(FunctionCall2Coll(cmp_func, collid, value, *min_value)) < 0)
+		result = false;
+
+	if (max_value &&
+		DatumGetInt32(FunctionCall2Coll(cmp_func, collid, value, *max_value)) >= 0)
+		result = false;
+
+	return result;
+}
+
+/*
+ * Delete row from parent table. Return false if it's been deleted already.
+ */
+static bool
+delete_parent_row(Relation parent_rel, HeapTuple tuple, CommandId mycid)
+{
+#if PG_VERSION_NUM >= 120000
+	TM_FailureData			tmfd;
+	TM_Result				result;
+#else
+	HeapUpdateFailureData	tmfd;
+	HTSU_Result				result;
+#endif
+
+	/* Never wait for concurrent transactions */
+	result = heap_delete_compat(parent_rel, &tuple->t_self, mycid,
+								InvalidSnapshot, false, &tmfd, false);
+
+	switch (result)
+	{
+#if PG_VERSION_NUM >= 120000
+		case TM_Ok:
+#else
+		case HeapTupleMayBeUpdated:
+#endif
+			return true;
+
+#if PG_VERSION_NUM >= 120000
+		case TM_SelfModified:
+		case TM_Deleted:
+			return false;
+
+		case TM_Updated:
+#else
+		case HeapTupleSelfUpdated:
+			return false;
+
+		case HeapTupleUpdated:
+			/* Row has been deleted, not updated */
+			if (ItemPointerEquals(&tuple->t_self, &tmfd.ctid))
+				return false;
+#endif
+			ereport(ERROR,
+					(errcode(ERRCODE_T_R_SERIALIZATION_FAILURE),
+					 errmsg("could not move row of relation \"%s\" due to concurrent update",
+							RelationGetRelationName(parent_rel))));
+			break;
+
+#if PG_VERSION_NUM >= 120000
+		case TM_BeingModified:
+		case TM_WouldBlock:
+#else
+		case HeapTupleBeingUpdated:
+		case HeapTupleWouldBlock:
+#endif
+			ereport(ERROR,
+					(errcode(ERRCODE_LOCK_NOT_AVAILABLE),
+					 errmsg("could not obtain lock on row in relation \"%s\"",
+							RelationGetRelationName(parent_rel))));
+			break;
+
+		default:
+			elog(ERROR, "unrecognized heap_delete status: %u", result);
+			break;
+	}
+
+	return false; /* keep compiler quiet */
+}
+
+/*
+ * Make sure that we're not going to insert into foreign partitions.
+ */
+static void
+prepare_rri_for_mover(ResultRelInfoHolder *rri_holder,
+					  const ResultPartsStorage *rps_storage)
+{
+	ResultRelInfo *rri = rri_holder->result_rel_info;
+
+	if (rri->ri_FdwRoutine != NULL)
+		elog(ERROR, "cannot move rows to foreign partition \"%s\"",
+			 get_rel_name(RelationGetRelid(rri->ri_RelationDesc)));
+}
@@ -0,0 +1,941 @@
+/* ------------------------------------------------------------------------
+ *
+ * partitionwise.c
+ *		Partition-wise joins and aggregation of relations
+ *		partitioned by pg_pathman
+ *
+ *		If two tables have identical partitioning and are joined by
+ *		equality of their partitioning expressions, each row of some
+ *		partition can only match rows of the corresponding partition
+ *		of the other table. Thus we can join partitions pair by pair
+ *		and Append the results instead of joining two big Appends.
+ *
+ *		Likewise, if GROUP BY contains the partitioning expression,
+ *		each group is contained in a single partition, so partitions
+ *		may be aggregated one by one. Otherwise each partition can
+ *		still be aggregated partially, which is often cheaper than
+ *		aggregating all rows at once.
+ *
+ * Copyright (c) 2020, Postgres Professional
+ *
+ * ------------------------------------------------------------------------
+ */
+
+#include "compat/pg_compat.h"
+
+#include "partitionwise.h"
+#include "planner_tree_modification.h"
+#include "relation_info.h"
+#include "utils.h"
+
+#if defined(PATHMAN_PARTITIONWISE_JOIN) || defined(PATHMAN_PARTITIONWISE_AGGREGATE)
+
+#include "nodes/makefuncs.h"
+#include "nodes/nodeFuncs.h"
+#include "optimizer/appendinfo.h"
+#include "optimizer/clauses.h"
+#include "optimizer/cost.h"
+#include "optimizer/optimizer.h"
+#include "optimizer/pathnode.h"
+#include "optimizer/planner.h"
+#include "optimizer/tlist.h"
+#include "utils/lsyscache.h"
+#include "utils/selfuncs.h"
+#include "utils/typcache.h"
+
+
+static Oid partitioning_opfamily(const PartRelationInfo *prel);
+
+static bool partitioning_collation_compatible(Oid collid,
+											  const PartRelationInfo *prel);
+
+#endif
+
+
+#ifdef PATHMAN_PARTITIONWISE_JOIN
+
+static bool prels_partitioned_alike(const PartRelationInfo *prel1,
+									const PartRelationInfo *prel2);
+
+static bool has_partitioning_equi_join(List *restrictlist,
+									   const PartRelationInfo *outer_prel,
+									   RelOptInfo *outerrel,
+									   const PartRelationInfo *inner_prel,
+									   RelOptInfo *innerrel);
+
+static RelOptInfo **collect_partition_rels(PlannerInfo *root,
+										   RelOptInfo *rel,
+										   const PartRelationInfo *prel);
+
+static RelOptInfo *make_partition_join_rel(PlannerInfo *root,
+										   RelOptInfo *joinrel,
+										   RelOptInfo *outer_child,
+										   RelOptInfo *inner_child,
+										   JoinType jointype,
+										   JoinPathExtraData *extra);
+
+/*
+ * Add a partition-wise join path (Append of joins of partition pairs)
+ * to 'joinrel' if 'outerrel' and 'innerrel' are partitioned alike.
+ * NOTE: Called by pathman_join_pathlist_hook() for both join orders.
+ */
+void
+try_partitionwise_join_paths(PlannerInfo *root,
+							 RelOptInfo *joinrel,
+							 RelOptInfo *outerrel,
+							 RelOptInfo *innerrel,
+							 JoinType jointype,
+							 JoinPathExtraData *extra)
+{
+	RangeTblEntry	   *outer_rte,
+					   *inner_rte;
+	PartRelationInfo   *outer_prel = NULL,
+					   *inner_prel = NULL;
+	RelOptInfo		  **outer_parts,
+					  **inner_parts;
+	List			   *subpaths = NIL;
+	uint32				i;
+
+	if (!enable_partitionwise_join)
+		return;
+
+	/* Currently we join only pairs of partitions (no outer joins) */
+	if (jointype != JOIN_INNER || extra->sjinfo->jointype != JOIN_INNER)
+		return;
+
+	/* Both sides should be plain partitioned tables */
+	if (outerrel->reloptkind != RELOPT_BASEREL ||
+		innerrel->reloptkind != RELOPT_BASEREL)
+		return;
+
+	/* Parameterized and lateral joins are not supported */
+	if (!bms_is_empty(joinrel->lateral_relids))
+		return;
+
+	/* Whole-row Vars of parents can't be translated to children easily */
+	if (outerrel->attr_needed[InvalidAttrNumber - outerrel->min_attr] != NULL ||
+		innerrel->attr_needed[InvalidAttrNumber - innerrel->min_attr] != NULL)
+		return;
+
+	outer_rte = root->simple_rte_array[outerrel->relid];
+	inner_rte = root->simple_rte_array[innerrel->relid];
+
+	if (outer_rte->rtekind != RTE_RELATION ||
+		inner_rte->rtekind != RTE_RELATION)
+		return;
+
+	/* Both relations should have been expanded by pg_pathman */
+	if (outer_rte->inh || inner_rte->inh ||
+		PARENTHOOD_DISALLOWED == get_rel_parenthood_status(outer_rte) ||
+		PARENTHOOD_DISALLOWED == get_rel_parenthood_status(inner_rte))
+		return;
+
+	if ((outer_prel = get_pathman_relation_info(outer_rte->relid)) == NULL ||
+		(inner_prel = get_pathman_relation_info(inner_rte->relid)) == NULL)
+		goto cleanup;
+
+	if (!prels_partitioned_alike(outer_prel, inner_prel))
+		goto cleanup;
+
+	if (!has_partitioning_equi_join(extra->restrictlist,
+									outer_prel, outerrel,
+									inner_prel, innerrel))
+		goto cleanup;
+
+	/* Fetch RelOptInfos of partitions (NULL if pruned) */
+	if ((outer_parts = collect_partition_rels(root, outerrel, outer_prel)) == NULL ||
+		(inner_parts = collect_partition_rels(root, innerrel, inner_prel)) == NULL)
+		goto cleanup;
+
+	/* build_child_join_rel() expects this */
+	joinrel->consider_partitionwise_join = true;
+
+	for (i = 0; i < PrelChildrenCount(outer_prel); i++)
+	{
+		RelOptInfo *child_joinrel;
+		Path	   *child_path;
+
+		/* Rows of a missing partition can't match anything */
+		if (!outer_parts[i] || IS_DUMMY_REL(outer_parts[i]) ||
+			!outer_parts[i]->cheapest_total_path ||
+			!inner_parts[i] || IS_DUMMY_REL(inner_parts[i]) ||
+			!inner_parts[i]->cheapest_total_path)
+			continue;
+
+		child_joinrel = make_partition_join_rel(root, joinrel,
+												outer_parts[i], inner_parts[i],
+												jointype, extra);
+
+		child_path = child_joinrel->cheapest_total_path;
+
+		/* Give up if some pair has no suitable path */
+		if (!child_path || child_path->param_info)
+			goto cleanup;
+
+		subpaths = lappend(subpaths, child_path);
+	}
+
+	/* Every pair has been pruned, nothing to join */
+	if (subpaths == NIL)
+		goto cleanup;
+
+	add_path(joinrel,
+			 (Path *) create_append_path_compat(joinrel, subpaths, NULL, 0));
+
+cleanup:
+	/* Don't forget to close 'prel's! */
+	if (outer_prel)
+		close_pathman_relation_info(outer_prel);
+	if (inner_prel)
+		close_pathman_relation_info(inner_prel);
+}
+
+/*
+ * Check that i-th partition of 'prel1' holds
+ * exactly the same values as i-th partition of 'prel2'.
+ */
+static bool
+prels_partitioned_alike(const PartRelationInfo *prel1,
+						const PartRelationInfo *prel2)
+{
+	uint32		i;
+
+	/* Parents may contain anything */
+	if (prel1->enable_parent || prel2->enable_parent)
+		return false;
+
+	if (prel1->parttype != prel2->parttype ||
+		prel1->ev_type != prel2->ev_type ||
+		prel1->ev_collid != prel2->ev_collid ||
+		PrelChildrenCount(prel1) != PrelChildrenCount(prel2) ||
+		PrelChildrenCount(prel1) == 0)
+		return false;
+
+	/* HASH partitions are defined by their number and hash function */
+	if (prel1->parttype == PT_HASH)
+		return prel1->hash_proc == prel2->hash_proc;
+
+	else if (prel1->parttype == PT_RANGE)
+	{
+		RangeEntry *ranges1 = PrelGetRangesArray(prel1),
+				   *ranges2 = PrelGetRangesArray(prel2);
+		FmgrInfo	cmp_finfo;
+
+		if (prel1->cmp_proc != prel2->cmp_proc)
+			return false;
+
+		fmgr_info(prel1->cmp_proc, &cmp_finfo);
+
+		for (i = 0; i < PrelChildrenCount(prel1); i++)
+		{
+			const Bound *bounds1[2] = { &ranges1[i].min, &ranges1[i].max },
+						*bounds2[2] = { &ranges2[i].min, &ranges2[i].max };
+			int			j;
+
+			for (j = 0; j < 2; j++)
+			{
+				/* cmp_bounds() doesn't consider infinities equal */
+				if (IsInfinite(bounds1[j]) || IsInfinite(bounds2[j]))
+				{
+					if (bounds1[j]->is_infinite != bounds2[j]->is_infinite)
+						return false;
+				}
+				else if (cmp_bounds(&cmp_finfo, prel1->ev_collid,
+									bounds1[j], bounds2[j]) != 0)
+					return false;
+			}
+		}
+
+		return true;
+	}
+
+	return false;
+}
+
+/*
+ * Check that join clauses contain equality of partitioning expressions,
+ * which is compatible with the way partitions are defined.
+ */
+static bool
+has_partitioning_equi_join(List *restrictlist,
+						   const PartRelationInfo *outer_prel,
+						   RelOptInfo *outerrel,
+						   const PartRelationInfo *inner_prel,
+						   RelOptInfo *innerrel)
+{
+	Node		   *outer_expr = PrelExpressionForRelid(outer_prel, outerrel->relid),
+				   *inner_expr = PrelExpressionForRelid(inner_prel, innerrel->relid);
+	Oid				opfamily = partitioning_opfamily(outer_prel);
+	ListCell	   *lc;
+
+	if (!OidIsValid(opfamily))
+		return false;
+
+	foreach (lc, restrictlist)
+	{
+		RestrictInfo   *rinfo = (RestrictInfo *) lfirst(lc);
+		OpExpr		   *opexpr;
+		Node		   *left,
+					   *right;
+
+		if (rinfo->pseudoconstant || !rinfo->can_join ||
+			rinfo->mergeopfamilies == NIL)
+			continue;
+
+		if (!is_opclause(rinfo->clause))
+			continue;
+
+		opexpr = (OpExpr *) rinfo->clause;
+		if (list_length(opexpr->args) != 2 ||
+			!op_in_opfamily(opexpr->opno, opfamily))
+			continue;
+
+		/* Equality might be weaker than the one of partitioning */
+		if (!partitioning_collation_compatible(exprInputCollation((Node *) opexpr),
+											   outer_prel))
+			continue;
+
+		left = strip_implicit_coercions(linitial(opexpr->args));
+		right = strip_implicit_coercions(lsecond(opexpr->args));
+
+		if ((equal(left, outer_expr) && equal(right, inner_expr)) ||
+			(equal(left, inner_expr) && equal(right, outer_expr)))
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Map partitions of 'rel' to their RelOptInfos.
+ * Returns NULL if some child is not a partition of 'prel'.
+ */
+static RelOptInfo **
+collect_partition_rels(PlannerInfo *root,
+					   RelOptInfo *rel,
+					   const PartRelationInfo *prel)
+{
+	RelOptInfo	  **parts;
+	Oid			   *children = PrelGetChildrenArray(prel);
+	uint32			i = 0;
+	ListCell	   *lc;
+
+	parts = palloc0(PrelChildrenCount(prel) * sizeof(RelOptInfo *));
+
+	/* pg_pathman appends children in the order of partitions */
+	foreach (lc, root->append_rel_list)
+	{
+		AppendRelInfo  *appinfo = (AppendRelInfo *) lfirst(lc);
+		RelOptInfo	   *child_rel;
+		Oid				child_oid;
+
+		if (appinfo->parent_relid != rel->relid)
+			continue;
+
+		child_rel = root->simple_rel_array[appinfo->child_relid];
+		child_oid = root->simple_rte_array[appinfo->child_relid]->relid;
+
+		while (i < PrelChildrenCount(prel) && children[i] != child_oid)
+			i++;
+
+		/* Something we're not aware of */
+		if (i >= PrelChildrenCount(prel) || !child_rel)
+		{
+			pfree(parts);
+			return NULL;
+		}
+
+		parts[i++] = child_rel;
+	}
+
+	return parts;
+}
+
+/*
+ * Find (or build) a join relation of two partitions
+ * and populate it with paths produced by this join order.
+ */
+static RelOptInfo *
+make_partition_join_rel(PlannerInfo *root,
+						RelOptInfo *joinrel,
+						RelOptInfo *outer_child,
+						RelOptInfo *inner_child,
+						JoinType jointype,
+						JoinPathExtraData *extra)
+{
+	RelOptInfo		   *child_joinrel;
+	SpecialJoinInfo	   *child_sjinfo;
+	AppendRelInfo	  **appinfos;
+	int					nappinfos;
+	Relids				child_relids;
+	List			   *child_restrictlist;
+
+	child_relids = bms_union(outer_child->relids, inner_child->relids);
+	appinfos = find_appinfos_by_relids(root, child_relids, &nappinfos);
+
+	/* Translate join clauses for this pair */
+	child_restrictlist = (List *) adjust_appendrel_attrs(root,
+														 (Node *) extra->restrictlist,
+														 nappinfos, appinfos);
+
+	/* Translate SpecialJoinInfo (it's a dummy one for inner joins) */
+	child_sjinfo = makeNode(SpecialJoinInfo);
+	memcpy(child_sjinfo, extra->sjinfo, sizeof(SpecialJoinInfo));
+	child_sjinfo->min_lefthand = adjust_child_relids(extra->sjinfo->min_lefthand,
+													 nappinfos, appinfos);
+	child_sjinfo->min_righthand = adjust_child_relids(extra->sjinfo->min_righthand,
+													  nappinfos, appinfos);
+	child_sjinfo->syn_lefthand = adjust_child_relids(extra->sjinfo->syn_lefthand,
+													 nappinfos, appinfos);
+	child_sjinfo->syn_righthand = adjust_child_relids(extra->sjinfo->syn_righthand,
+													  nappinfos, appinfos);
+
+	/* We might have built this rel for another join order */
+	child_joinrel = find_join_rel(root, child_relids);
+	if (!child_joinrel)
+		child_joinrel = build_child_join_rel(root, outer_child, inner_child,
+											 joinrel, child_restrictlist,
+											 child_sjinfo, jointype);
+
+	/* Add paths produced by this join order */
+	add_paths_to_joinrel(root, child_joinrel, outer_child, inner_child,
+						 jointype, child_sjinfo, child_restrictlist);
+
+	if (child_joinrel->pathlist != NIL)
+		set_cheapest(child_joinrel);
+
+	pfree(appinfos);
+
+	return child_joinrel;
+}
+
+#endif /* PATHMAN_PARTITIONWISE_JOIN */
+
+
+#ifdef PATHMAN_PARTITIONWISE_AGGREGATE
+
+static bool group_by_has_partitioning_expr(List *group_clause,
+										   List *tlist,
+										   const PartRelationInfo *prel,
+										   RelOptInfo *rel);
+
+static void add_full_grouping_paths(PlannerInfo *root,
+									RelOptInfo *input_rel,
+									RelOptInfo *grouped_rel,
+									List *child_rels,
+									GroupPathExtraData *extra);
+
+static void add_partial_grouping_paths(PlannerInfo *root,
+									   RelOptInfo *input_rel,
+									   RelOptInfo *grouped_rel,
+									   List *child_rels,
+									   GroupPathExtraData *extra);
+
+static RelOptInfo *make_child_grouping_rel(PlannerInfo *root,
+										   RelOptInfo *child_rel,
+										   PathTarget *scanjoin_target,
+										   UpperRelationKind kind,
+										   PathTarget *target,
+										   Node *having_qual,
+										   AggSplit aggsplit,
+										   const AggClauseCosts *agg_costs,
+										   GroupPathExtraData *extra);
+
+static PathTarget *make_partial_target(PlannerInfo *root,
+									   PathTarget *grouping_target,
+									   Node *having_qual);
+
+static void get_target_agg_costs(PlannerInfo *root,
+								 PathTarget *target,
+								 Node *having_qual,
+								 AggSplit aggsplit,
+								 AggClauseCosts *agg_costs);
+
+
+/*
+ * Add paths which aggregate partitions of 'input_rel' one by one.
+ * If a group can't span several partitions, partitions are aggregated
+ * completely and results are simply Appended, otherwise we Append
+ * partial aggregates of partitions and finalize them on top.
+ * NOTE: Called by pathman_create_upper_paths_hook().
+ */
+void
+try_partitionwise_grouping_paths(PlannerInfo *root,
+								 RelOptInfo *input_rel,
+								 RelOptInfo *grouped_rel,
+								 GroupPathExtraData *extra)
+{
+	Query			   *parse = root->parse;
+	RangeTblEntry	   *rte;
+	PartRelationInfo   *prel;
+	List			   *child_rels = NIL;
+	bool				full_aggregation;
+	ListCell		   *lc;
+
+	if (!enable_partitionwise_aggregate)
+		return;
+
+	/* Plain aggregates and GROUPING SETS are not supported */
+	if (parse->groupClause == NIL || parse->groupingSets != NIL)
+		return;
+
+	/* Input should be a plain partitioned table */
+	if (input_rel->reloptkind != RELOPT_BASEREL ||
+		!bms_is_empty(input_rel->lateral_relids))
+		return;
+
+	/* Set-returning functions can't be pushed down to partitions */
+	if (expression_returns_set((Node *) input_rel->reltarget->exprs))
+		return;
+
+	rte = root->simple_rte_array[input_rel->relid];
+
+	/* This relation should have been expanded by pg_pathman */
+	if (rte->rtekind != RTE_RELATION || rte->inh ||
+		PARENTHOOD_DISALLOWED == get_rel_parenthood_status(rte))
+		return;
+
+	if ((prel = get_pathman_relation_info(rte->relid)) == NULL)
+		return;
+
+	/* Parent may contain rows of any group */
+	full_aggregation = !prel->enable_parent &&
+					   group_by_has_partitioning_expr(parse->groupClause,
+													  extra->targetList,
+													  prel, input_rel);
+
+	/* Don't forget to close 'prel'! */
+	close_pathman_relation_info(prel);
+
+	if (!full_aggregation && !(extra->flags & GROUPING_CAN_PARTIAL_AGG))
+		return;
+
+	/* Collect children of this appendrel */
+	foreach (lc, root->append_rel_list)
+	{
+		AppendRelInfo  *appinfo = (AppendRelInfo *) lfirst(lc);
+		RelOptInfo	   *child_rel;
+
+		if (appinfo->parent_relid != input_rel->relid)
+			continue;
+
+		child_rel = root->simple_rel_array[appinfo->child_relid];
+
+		/* Something we're not aware of */
+		if (!child_rel)
+			return;
+
+		/* Dummy children can be ignored */
+		if (IS_DUMMY_REL(child_rel))
+			continue;
+
+		if (!child_rel->cheapest_total_path ||
+			child_rel->cheapest_total_path->param_info)
+			return;
+
+		child_rels = lappend(child_rels, child_rel);
+	}
+
+	/* Nothing to aggregate */
+	if (child_rels == NIL)
+		return;
+
+	if (full_aggregation)
+		add_full_grouping_paths(root, input_rel, grouped_rel, child_rels, extra);
+	else
+		add_partial_grouping_paths(root, input_rel, grouped_rel,
+								   child_rels, extra);
+}
+
+/*
+ * Check that rows of a single group (as defined by GROUP BY)
+ * are always stored in a single partition of 'prel'.
+ */
+static bool
+group_by_has_partitioning_expr(List *group_clause,
+							   List *tlist,
+							   const PartRelationInfo *prel,
+							   RelOptInfo *rel)
+{
+	Node	   *part_expr = PrelExpressionForRelid(prel, rel->relid);
+	Oid			opfamily = partitioning_opfamily(prel);
+	ListCell   *lc;
+
+	if (!OidIsValid(opfamily))
+		return false;
+
+	foreach (lc, group_clause)
+	{
+		SortGroupClause	   *sgc = (SortGroupClause *) lfirst(lc);
+		Node			   *expr = get_sortgroupclause_expr(sgc, tlist);
+
+		/* Equal values should belong to the same partition */
+		if (op_in_opfamily(sgc->eqop, opfamily) &&
+			partitioning_collation_compatible(exprCollation(expr), prel) &&
+			match_expr_to_operand(part_expr, expr))
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Aggregate each partition completely and Append the results.
+ */
+static void
+add_full_grouping_paths(PlannerInfo *root,
+						RelOptInfo *input_rel,
+						RelOptInfo *grouped_rel,
+						List *child_rels,
+						GroupPathExtraData *extra)
+{
+	AggClauseCosts	agg_costs;
+	List		   *subpaths = NIL,
+				   *sorted_subpaths = NIL;
+	bool			sorted = (root->group_pathkeys != NIL);
+	ListCell	   *lc;
+
+	get_target_agg_costs(root, grouped_rel->reltarget, extra->havingQual,
+						 AGGSPLIT_SIMPLE, &agg_costs);
+
+	foreach (lc, child_rels)
+	{
+		RelOptInfo *child_grouped_rel;
+		Path	   *sorted_path = NULL;
+
+		child_grouped_rel = make_child_grouping_rel(root, lfirst(lc),
+													input_rel->reltarget,
+													UPPERREL_GROUP_AGG,
+													grouped_rel->reltarget,
+													extra->havingQual,
+													AGGSPLIT_SIMPLE,
+													&agg_costs, extra);
+
+		/* Give up if some partition can't be aggregated */
+		if (!child_grouped_rel)
+			return;
+
+		subpaths = lappend(subpaths, child_grouped_rel->cheapest_total_path);
+
+		/* We might also keep the groups sorted */
+		if (sorted)
+			sorted_path = get_cheapest_path_for_pathkeys(child_grouped_rel->pathlist,
+														 root->group_pathkeys,
+														 NULL, TOTAL_COST,
+														 false);
+
+		if (sorted_path)
+			sorted_subpaths = lappend(sorted_subpaths, sorted_path);
+		else
+			sorted = false;
+	}
+
+	add_path(grouped_rel,
+			 (Path *) create_append_path_compat(grouped_rel, subpaths, NULL, 0));
+
+	if (sorted)
+		add_path(grouped_rel,
+				 (Path *) create_merge_append_path_compat(root, grouped_rel,
+														  sorted_subpaths,
+														  root->group_pathkeys,
+														  NULL));
+}
+
+/*
+ * Aggregate each partition partially, Append
+ * the results and finalize aggregation on top.
+ */
+static void
+add_partial_grouping_paths(PlannerInfo *root,
+						   RelOptInfo *input_rel,
+						   RelOptInfo *grouped_rel,
+						   List *child_rels,
+						   GroupPathExtraData *extra)
+{
+	Query		   *parse = root->parse;
+	RelOptInfo	   *partially_grouped_rel;
+	PathTarget	   *partial_target;
+	AggClauseCosts	partial_costs,
+					final_costs;
+	List		   *subpaths = NIL;
+	Path		   *append_path;
+	double			num_groups;
+	ListCell	   *lc;
+
+	partial_target = make_partial_target(root, grouped_rel->reltarget,
+										 extra->havingQual);
+
+	/*
+	 * Core keeps its own partial aggregation in the rel of 'grouped_rel'
+	 * (its relids are NULL), so we use a separate rel keyed by relids
+	 * of 'input_rel' and don't touch the target of core's rel.
+	 */
+	partially_grouped_rel = fetch_upper_rel(root, UPPERREL_PARTIAL_GROUP_AGG,
+											input_rel->relids);
+	partially_grouped_rel->reltarget = partial_target;
+
+	get_target_agg_costs(root, partial_target, NULL,
+						 AGGSPLIT_INITIAL_SERIAL, &partial_costs);
+	get_target_agg_costs(root, grouped_rel->reltarget, extra->havingQual,
+						 AGGSPLIT_FINAL_DESERIAL, &final_costs);
+
+	foreach (lc, child_rels)
+	{
+		RelOptInfo *child_grouped_rel;
+
+		/* HAVING is evaluated by the final aggregation */
+		child_grouped_rel = make_child_grouping_rel(root, lfirst(lc),
+													input_rel->reltarget,
+													UPPERREL_PARTIAL_GROUP_AGG,
+													partial_target,
+													NULL,
+													AGGSPLIT_INITIAL_SERIAL,
+													&partial_costs, extra);
+
+		/* Give up if some partition can't be aggregated */
+		if (!child_grouped_rel)
+			return;
+
+		subpaths = lappend(subpaths, child_grouped_rel->cheapest_total_path);
+	}
+
+	append_path = (Path *) create_append_path_compat(partially_grouped_rel,
+													 subpaths, NULL, 0);
+
+	num_groups = estimate_num_groups(root,
+									 get_sortgrouplist_exprs(parse->groupClause,
+															 extra->targetList),
+									 input_rel->rows, NULL);
+
+	if (extra->flags & GROUPING_CAN_USE_SORT)
+	{
+		Path *path = append_path;
+
+		if (!pathkeys_contained_in(root->group_pathkeys, path->pathkeys))
+			path = (Path *) create_sort_path(root, grouped_rel, path,
+											 root->group_pathkeys, -1.0);
+
+		add_path(grouped_rel,
+				 (Path *) create_agg_path(root, grouped_rel, path,
+										  grouped_rel->reltarget,
+										  AGG_SORTED, AGGSPLIT_FINAL_DESERIAL,
+										  parse->groupClause,
+										  (List *) extra->havingQual,
+										  &final_costs, num_groups));
+	}
+
+	if (extra->flags & GROUPING_CAN_USE_HASH)
+		add_path(grouped_rel,
+				 (Path *) create_agg_path(root, grouped_rel, append_path,
+										  grouped_rel->reltarget,
+										  AGG_HASHED, AGGSPLIT_FINAL_DESERIAL,
+										  parse->groupClause,
+										  (List *) extra->havingQual,
+										  &final_costs, num_groups));
+}
+
+/*
+ * Build a grouping rel for 'child_rel' and populate it with
+ * sorted and hashed aggregation paths (as allowed by 'extra').
+ * 'scanjoin_target', 'target' and 'having_qual' reference the parent.
+ */
+static RelOptInfo *
+make_child_grouping_rel(PlannerInfo *root,
+						RelOptInfo *child_rel,
+						PathTarget *scanjoin_target,
+						UpperRelationKind kind,
+						PathTarget *target,
+						Node *having_qual,
+						AggSplit aggsplit,
+						const AggClauseCosts *agg_costs,
+						GroupPathExtraData *extra)
+{
+	Query		   *parse = root->parse;
+	RelOptInfo	   *child_grouped_rel;
+	PathTarget	   *child_target,
+				   *child_scanjoin_target;
+	Path		   *input_path;
+	AppendRelInfo **appinfos;
+	int				nappinfos;
+	List		   *child_tlist;
+	double			num_groups;
+
+	appinfos = find_appinfos_by_relids(root, child_rel->relids, &nappinfos);
+
+	/* Translate targets, HAVING and target list for this partition */
+	child_scanjoin_target = copy_pathtarget(scanjoin_target);
+	child_scanjoin_target->exprs =
+			(List *) adjust_appendrel_attrs(root,
+											(Node *) scanjoin_target->exprs,
+											nappinfos, appinfos);
+	child_target = copy_pathtarget(target);
+	child_target->exprs = (List *) adjust_appendrel_attrs(root,
+														  (Node *) target->exprs,
+														  nappinfos, appinfos);
+	having_qual = adjust_appendrel_attrs(root, having_qual,
+										 nappinfos, appinfos);
+	child_tlist = (List *) adjust_appendrel_attrs(root,
+												  (Node *) extra->targetList,
+												  nappinfos, appinfos);
+
+	pfree(appinfos);
+
+	/*
+	 * Paths of partitions don't compute grouping expressions and
+	 * have no sortgrouprefs, so we have to project them first.
+	 * NOTE: see apply_scanjoin_target_to_paths() in planner.c.
+	 */
+	input_path = (Path *) create_projection_path(root, child_rel,
+												 child_rel->cheapest_total_path,
+												 child_scanjoin_target);
+
+	child_grouped_rel = fetch_upper_rel(root, kind, child_rel->relids);
+	child_grouped_rel->reloptkind = RELOPT_OTHER_UPPER_REL;
+	child_grouped_rel->reltarget = child_target;
+
+	num_groups = estimate_num_groups(root,
+									 get_sortgrouplist_exprs(parse->groupClause,
+															 child_tlist),
+									 input_path->rows, NULL);
+
+	if (extra->flags & GROUPING_CAN_USE_SORT)
+	{
+		Path *path = input_path;
+
+		if (!pathkeys_contained_in(root->group_pathkeys, path->pathkeys))
+			path = (Path *) create_sort_path(root, child_grouped_rel, path,
+											 root->group_pathkeys, -1.0);
+
+		add_path(child_grouped_rel,
+				 (Path *) create_agg_path(root, child_grouped_rel, path,
+										  child_target,
+										  AGG_SORTED, aggsplit,
+										  parse->groupClause,
+										  (List *) having_qual,
+										  agg_costs, num_groups));
+	}
+
+	if (extra->flags & GROUPING_CAN_USE_HASH)
+		add_path(child_grouped_rel,
+				 (Path *) create_agg_path(root, child_grouped_rel, input_path,
+										  child_target,
+										  AGG_HASHED, aggsplit,
+										  parse->groupClause,
+										  (List *) having_qual,
+										  agg_costs, num_groups));
+
+	if (child_grouped_rel->pathlist == NIL)
+		return NULL;
+
+	set_cheapest(child_grouped_rel);
+
+	return child_grouped_rel;
+}
+
+/*
+ * Build a target for partial aggregation: grouping columns, partial
+ * Aggrefs and Vars needed for the final target and HAVING.
+ * NOTE: this is make_partial_grouping_target() of planner.c.
+ */
+static PathTarget *
+make_partial_target(PlannerInfo *root,
+					PathTarget *grouping_target,
+					Node *having_qual)
+{
+	Query	   *parse = root->parse;
+	PathTarget *partial_target = create_empty_pathtarget();
+	List	   *non_group_cols = NIL,
+			   *non_group_exprs;
+	int			i = 0;
+	ListCell   *lc;
+
+	foreach (lc, grouping_target->exprs)
+	{
+		Expr   *expr = (Expr *) lfirst(lc);
+		Index	sgref = get_pathtarget_sortgroupref(grouping_target, i++);
+
+		if (sgref && get_sortgroupref_clause_noerr(sgref, parse->groupClause))
+			add_column_to_pathtarget(partial_target, expr, sgref);
+		else
+			non_group_cols = lappend(non_group_cols, expr);
+	}
+
+	if (having_qual)
+		non_group_cols = lappend(non_group_cols, having_qual);
+
+	non_group_exprs = pull_var_clause((Node *) non_group_cols,
+									  PVC_INCLUDE_AGGREGATES |
+									  PVC_RECURSE_WINDOWFUNCS |
+									  PVC_INCLUDE_PLACEHOLDERS);
+
+	add_new_columns_to_pathtarget(partial_target, non_group_exprs);
+
+	/* Aggrefs should produce partial (serialized) results */
+	foreach (lc, partial_target->exprs)
+	{
+		if (IsA(lfirst(lc), Aggref))
+		{
+			Aggref *aggref = makeNode(Aggref);
+
+			memcpy(aggref, lfirst(lc), sizeof(Aggref));
+			mark_partial_aggref(aggref, AGGSPLIT_INITIAL_SERIAL);
+
+			lfirst(lc) = aggref;
+		}
+	}
+
+	list_free(non_group_exprs);
+	list_free(non_group_cols);
+
+	return set_pathtarget_cost_width(root, partial_target);
+}
+
+/* Estimate costs of aggregates used by 'target' and 'having_qual' */
+static void
+get_target_agg_costs(PlannerInfo *root,
+					 PathTarget *target,
+					 Node *having_qual,
+					 AggSplit aggsplit,
+					 AggClauseCosts *agg_costs)
+{
+	MemSet(agg_costs, 0, sizeof(AggClauseCosts));
+
+	get_agg_clause_costs(root, (Node *) target->exprs, aggsplit, agg_costs);
+	get_agg_clause_costs(root, having_qual, aggsplit, agg_costs);
+}
+
+#endif /* PATHMAN_PARTITIONWISE_AGGREGATE */
+
+
+#if defined(PATHMAN_PARTITIONWISE_JOIN) || defined(PATHMAN_PARTITIONWISE_AGGREGATE)
+
+/*
+ * Get operator family which defines how values
+ * are distributed among partitions of 'prel'.
+ */
+static Oid
+partitioning_opfamily(const PartRelationInfo *prel)
+{
+	TypeCacheEntry *tce;
+
+	tce = lookup_type_cache(prel->ev_type,
+							TYPECACHE_BTREE_OPFAMILY | TYPECACHE_HASH_OPFAMILY);
+
+	return (prel->parttype == PT_HASH) ? tce->hash_opf : tce->btree_opf;
+}
+
+/*
+ * Check that values equal under collation 'collid'
+ * always belong to the same partition of 'prel'.
+ */
+static bool
+partitioning_collation_compatible(Oid collid, const PartRelationInfo *prel)
+{
+	if (collid == prel->ev_collid || !OidIsValid(collid))
+		return true;
+
+	/* Deterministic collations consider only identical strings equal */
+	return get_collation_isdeterministic(collid);
+}
+
+#endif
@@ -2,10 +2,11 @@
  *
  * pathman_workers.c
  *
- *		There are two purposes of this subsystem:
+ *		There are three purposes of this subsystem:
  *
  *			* Create new partitions for INSERT in separate transaction
  *			* Process concurrent partitioning operations
+ *			* Create future RANGE partitions in advance
  *
  *		Background worker API is used for both cases.
  *
@@ -16,6 +17,9 @@
 
 #include "init.h"
 #include "partition_creation.h"
+#include "partition_filter.h"
+#include "partition_mover.h"
+#include "pathman.h"
 #include "pathman_workers.h"
 #include "relation_info.h"
 #include "utils.h"
@@ -27,18 +31,28 @@
 #include "executor/spi.h"
 #include "funcapi.h"
 #include "miscadmin.h"
+#include "optimizer/plancat.h"
+#include "pgstat.h"
 #include "postmaster/bgworker.h"
+#include "postmaster/postmaster.h"
 #include "storage/dsm.h"
 #include "storage/ipc.h"
 #include "storage/latch.h"
 #include "storage/proc.h"
 #include "utils/builtins.h"
 #include "utils/datum.h"
+#include "utils/guc.h"
+#include "utils/inval.h"
 #include "utils/lsyscache.h"
 #include "utils/syscache.h"
 #include "utils/typcache.h"
 #include "utils/resowner.h"
 #include "utils/snapmgr.h"
+#include "utils/timestamp.h"
+
+#if PG_VERSION_NUM >= 100000
+#include "utils/varlena.h"
+#endif
 
 
 
@@ -52,10 +66,13 @@ PG_FUNCTION_INFO_V1( stop_concurrent_part_task );
  * Dynamically resolve functions (for BGW API).
  */
 extern PGDLLEXPORT void bgw_main_spawn_partitions(Datum main_arg);
+extern PGDLLEXPORT void bgw_main_spawn_pool(Datum main_arg);
 extern PGDLLEXPORT void bgw_main_concurrent_part(Datum main_arg);
+extern PGDLLEXPORT void bgw_main_premake_partitions(Datum main_arg);
 
 
 static void handle_sigterm(SIGNAL_ARGS);
+static void handle_sighup(SIGNAL_ARGS);
 static void bg_worker_load_config(const char *bgw_name);
 static bool start_bgworker(const char bgworker_name[BGW_MAXLEN],
 							const char bgworker_proc[BGW_MAXLEN],
@@ -76,17 +93,185 @@ typedef struct
  */
 static ConcurrentPartSlot  *concurrent_part_slots;
 
+/*
+ * Queue & slots of SpawnPartitionsWorkers' pool.
+ */
+static SpawnPool		   *spawn_pool;
+
 
 /*
  * Available workers' names.
  */
 static const char		   *spawn_partitions_bgw	= "SpawnPartitionsWorker";
+static const char		   *spawn_pool_bgw			= "SpawnPartitionsPoolWorker";
 static const char		   *concurrent_part_bgw		= "ConcurrentPartWorker";
+static const char		   *premake_partitions_bgw	= "PremakePartitionsWorker";
+
+
+/* GUC variable for SpawnPartitionsWorkers' pool */
+int							pg_pathman_spawn_workers;
+
+/* GUC variables for ConcurrentPartWorker */
+int							pg_pathman_concurrent_part_workers;
+bool						pg_pathman_enable_native_data_mover;
+int							pg_pathman_concurrent_part_batch_time;
+double						pg_pathman_concurrent_part_duty_cycle;
+
+/* GUC variables for PremakePartitionsWorker */
+int							pg_pathman_premake_partitions;
+int							pg_pathman_premake_naptime;
+char					   *pg_pathman_premake_databases;
+
+/* Set by SIGHUP handler */
+static volatile sig_atomic_t got_sighup = false;
 
 
 /* Used for preventing spawn bgw recursion trouble */
 static bool am_spawn_bgw = false;
 
+/* Database & user served by this SpawnPartitionsPoolWorker */
+static Oid spawn_pool_dbid = InvalidOid;
+static Oid spawn_pool_userid = InvalidOid;
+
+/*
+ * Define GUCs & register PremakePartitionsWorkers.
+ */
+void
+init_pathman_workers_static_data(void)
+{
+	List	   *databases;
+	ListCell   *lc;
+	char	   *rawstring;
+	int			i = 0;
+
+	DefineCustomIntVariable("pg_pathman.spawn_workers",
+							"Max number of persistent workers creating partitions",
+							NULL,
+							&pg_pathman_spawn_workers,
+							DEFAULT_PATHMAN_SPAWN_WORKERS,
+							0, MAX_BACKENDS,
+							PGC_POSTMASTER,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	if (IsSpawnPoolEnabled())
+		RequestPathmanLWLocks("pg_pathman spawn pool", 1);
+
+	DefineCustomIntVariable("pg_pathman.concurrent_part_workers",
+							"Number of workers started by partition_table_concurrently()",
+							NULL,
+							&pg_pathman_concurrent_part_workers,
+							1,
+							1, MAX_BACKENDS,
+							PGC_USERSET,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomBoolVariable("pg_pathman.enable_native_data_mover",
+							 "Let ConcurrentPartWorker move rows without SPI",
+							 NULL,
+							 &pg_pathman_enable_native_data_mover,
+							 true,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomIntVariable("pg_pathman.concurrent_part_batch_time",
+							"Target duration of a batch of partition_table_concurrently()",
+							"Batch size is adjusted to it, 0 means fixed batch size.",
+							&pg_pathman_concurrent_part_batch_time,
+							0,
+							0, INT_MAX,
+							PGC_USERSET,
+							GUC_UNIT_MS,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomRealVariable("pg_pathman.concurrent_part_duty_cycle",
+							 "Max share of time partition_table_concurrently() spends moving rows",
+							 "Workers sleep between batches to stay within it.",
+							 &pg_pathman_concurrent_part_duty_cycle,
+							 1.0,
+							 0.01, 1.0,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomIntVariable("pg_pathman.premake_partitions",
+							"Number of empty RANGE partitions to be created in advance",
+							NULL,
+							&pg_pathman_premake_partitions,
+							DEFAULT_PATHMAN_PREMAKE_PARTITIONS,
+							0, 1000,
+							PGC_SIGHUP,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomIntVariable("pg_pathman.premake_naptime",
+							"Sleep time between runs of partitions premaking worker",
+							NULL,
+							&pg_pathman_premake_naptime,
+							DEFAULT_PATHMAN_PREMAKE_NAPTIME,
+							1, INT_MAX / 1000,
+							PGC_SIGHUP,
+							GUC_UNIT_S,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomStringVariable("pg_pathman.premake_databases",
+							   "Databases served by partitions premaking worker",
+							   NULL,
+							   &pg_pathman_premake_databases,
+							   "",
+							   PGC_POSTMASTER,
+							   GUC_LIST_INPUT,
+							   NULL,
+							   NULL,
+							   NULL);
+
+	rawstring = pstrdup(pg_pathman_premake_databases);
+	if (!SplitIdentifierString(rawstring, ',', &databases))
+		elog(ERROR, "invalid list syntax in parameter \"%s\"",
+			 "pg_pathman.premake_databases");
+
+	/* Start a separate worker for each database */
+	foreach (lc, databases)
+	{
+		BackgroundWorker worker;
+
+		memset(&worker, 0, sizeof(worker));
+
+		snprintf(worker.bgw_name, BGW_MAXLEN, "%s", premake_partitions_bgw);
+		snprintf(worker.bgw_function_name, BGW_MAXLEN,
+				 CppAsString(bgw_main_premake_partitions));
+		snprintf(worker.bgw_library_name, BGW_MAXLEN, "pg_pathman");
+
+		worker.bgw_flags			= BGWORKER_SHMEM_ACCESS |
+										BGWORKER_BACKEND_DATABASE_CONNECTION;
+		worker.bgw_start_time		= BgWorkerStart_RecoveryFinished;
+		worker.bgw_restart_time		= PREMAKE_WORKER_RESTART_TIME;
+		worker.bgw_main_arg			= Int32GetDatum(i++);
+		worker.bgw_notify_pid		= 0;
+
+		RegisterBackgroundWorker(&worker);
+	}
+
+	list_free(databases);
+	pfree(rawstring);
+}
+
 /*
  * Estimate amount of shmem needed for concurrent partitioning.
  */
@@ -120,6 +305,50 @@ init_concurrent_part_task_slots(void)
 	}
 }
 
+/*
+ * Estimate amount of shmem needed for SpawnPartitionsWorkers' pool.
+ */
+Size
+estimate_spawn_pool_size(void)
+{
+	if (!IsSpawnPoolEnabled())
+		return 0;
+
+	return add_size(offsetof(SpawnPool, workers),
+					mul_size(sizeof(SpawnWorkerSlot), pg_pathman_spawn_workers));
+}
+
+/*
+ * Initialize shared memory needed for SpawnPartitionsWorkers' pool.
+ */
+void
+init_spawn_pool(void)
+{
+	bool	found;
+	Size	size = estimate_spawn_pool_size();
+	int		i;
+
+	if (!IsSpawnPoolEnabled())
+		return;
+
+	spawn_pool = (SpawnPool *)
+			ShmemInitStruct("pg_pathman's pool of spawn workers", size, &found);
+
+	/* Initialize 'spawn_pool' if needed */
+	if (!found)
+	{
+		memset(spawn_pool, 0, size);
+
+		spawn_pool->lock = GetPathmanLWLocks("pg_pathman spawn pool");
+
+		for (i = 0; i < pg_pathman_spawn_workers; i++)
+		{
+			spawn_pool->workers[i].pgprocno = -1;
+			spawn_pool->workers[i].request = -1;
+		}
+	}
+}
+
 
 /*
  * -------------------------------------------------
@@ -147,6 +376,20 @@ handle_sigterm(SIGNAL_ARGS)
 	errno = save_errno;
 }
 
+/*
+ * Handle SIGHUP in BGW's process.
+ */
+static void
+handle_sighup(SIGNAL_ARGS)
+{
+	int save_errno = errno;
+
+	got_sighup = true;
+	SetLatch(MyLatch);
+
+	errno = save_errno;
+}
+
 /*
  * Initialize pg_pathman's local config in BGW's process.
  */
@@ -301,6 +544,476 @@ create_partitions_bg_worker_segment(Oid relid, Datum value, Oid value_type)
 	return segment;
 }
 
+/*
+ * Wake up backends waiting for request and mark it as done.
+ * NOTE: caller should hold spawn_pool->lock.
+ */
+static void
+spawn_request_finish(SpawnRequest *req, Oid result)
+{
+	int i;
+
+	req->result = result;
+	req->status = SPR_DONE;
+
+	for (i = 0; i < req->nwaiters; i++)
+		SetLatch(&ProcGlobal->allProcs[req->waiters[i]].procLatch);
+
+	/* Nobody is interested in this request */
+	if (req->nwaiters == 0)
+		req->status = SPR_FREE;
+}
+
+/*
+ * Tell waiting backends that nobody is going to process this request.
+ * NOTE: caller should hold spawn_pool->lock.
+ */
+static void
+spawn_request_abandon(SpawnRequest *req)
+{
+	int i;
+
+	req->status = SPR_ABANDONED;
+
+	for (i = 0; i < req->nwaiters; i++)
+		SetLatch(&ProcGlobal->allProcs[req->waiters[i]].procLatch);
+
+	/* Nobody is interested in this request */
+	if (req->nwaiters == 0)
+		req->status = SPR_FREE;
+}
+
+/*
+ * Stop waiting for request, free it if we were the last one.
+ * NOTE: caller should hold spawn_pool->lock.
+ */
+static void
+spawn_request_detach(SpawnRequest *req)
+{
+	int i;
+
+	for (i = 0; i < req->nwaiters; i++)
+	{
+		if (req->waiters[i] == MyProc->pgprocno)
+		{
+			req->waiters[i] = req->waiters[--req->nwaiters];
+			break;
+		}
+	}
+
+	/* Worker will free this request when it's done */
+	if (req->nwaiters == 0 && req->status != SPR_WORKING)
+		req->status = SPR_FREE;
+}
+
+/*
+ * Is there any pool worker serving current database & user?
+ * NOTE: caller should hold spawn_pool->lock.
+ */
+static bool
+spawn_pool_has_workers(Oid dbid, Oid userid)
+{
+	int i;
+
+	for (i = 0; i < pg_pathman_spawn_workers; i++)
+	{
+		SpawnWorkerSlot *slot = &spawn_pool->workers[i];
+
+		if (slot->status != SPW_FREE &&
+			slot->dbid == dbid &&
+			slot->userid == userid)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Abandon queued requests of database & user unless
+ * there's a pool worker which is going to process them.
+ * NOTE: caller should hold spawn_pool->lock.
+ */
+static void
+spawn_pool_abandon_requests(Oid dbid, Oid userid)
+{
+	int i;
+
+	if (spawn_pool_has_workers(dbid, userid))
+		return;
+
+	for (i = 0; i < SPAWN_POOL_QUEUE_SIZE; i++)
+	{
+		SpawnRequest *req = &spawn_pool->requests[i];
+
+		if (req->status == SPR_QUEUED &&
+			req->dbid == dbid &&
+			req->userid == userid)
+		{
+			spawn_request_abandon(req);
+		}
+	}
+}
+
+/*
+ * Start a new pool worker for the reserved slot.
+ */
+static bool
+start_spawn_pool_worker(int slot_idx, uint32 generation)
+{
+	BackgroundWorker		worker;
+	BackgroundWorkerHandle *bgw_handle;
+	BgwHandleStatus			bgw_status;
+	pid_t					pid;
+
+	/* Initialize worker struct */
+	memset(&worker, 0, sizeof(worker));
+
+	snprintf(worker.bgw_name, BGW_MAXLEN, "%s", spawn_pool_bgw);
+	snprintf(worker.bgw_function_name, BGW_MAXLEN,
+			 CppAsString(bgw_main_spawn_pool));
+	snprintf(worker.bgw_library_name, BGW_MAXLEN, "pg_pathman");
+
+	worker.bgw_flags			= BGWORKER_SHMEM_ACCESS |
+									BGWORKER_BACKEND_DATABASE_CONNECTION;
+	worker.bgw_start_time		= BgWorkerStart_RecoveryFinished;
+	worker.bgw_restart_time		= BGW_NEVER_RESTART;
+	worker.bgw_main_arg			= Int32GetDatum(slot_idx);
+	worker.bgw_notify_pid		= MyProcPid;
+
+	if (RegisterDynamicBackgroundWorker(&worker, &bgw_handle))
+	{
+		bgw_status = WaitForBackgroundWorkerStartup(bgw_handle, &pid);
+
+		if (bgw_status == BGWH_STARTED)
+			return true;
+
+		if (bgw_status == BGWH_POSTMASTER_DIED)
+			ereport(ERROR,
+					(errmsg("Postmaster died during the pg_pathman background worker process"),
+					 errhint("More details may be available in the server log.")));
+	}
+
+	/* Release the slot unless worker has already taken care of it */
+	LWLockAcquire(spawn_pool->lock, LW_EXCLUSIVE);
+	if (spawn_pool->workers[slot_idx].generation == generation &&
+		spawn_pool->workers[slot_idx].pgprocno < 0)
+	{
+		spawn_pool->workers[slot_idx].status = SPW_FREE;
+	}
+	LWLockRelease(spawn_pool->lock);
+
+	return false;
+}
+
+/*
+ * Put request into the queue (or join a request for the same table)
+ * and make sure that some pool worker is going to process it.
+ * Return index of request or -1 if pool can't serve it.
+ */
+static int
+spawn_pool_submit(Oid relid, Datum value, Oid value_type,
+				  Size value_size, bool value_byval,
+				  bool may_join, bool *joined)
+{
+	SpawnRequest   *req = NULL;
+	int				req_idx = -1,
+					start_slot = -1,
+					idle_slot = -1,
+					i;
+	uint32			generation = 0;
+	bool			has_workers = false;
+
+	*joined = false;
+
+	LWLockAcquire(spawn_pool->lock, LW_EXCLUSIVE);
+
+	/* Partitions of this table are being created, wait for them */
+	for (i = 0; may_join && i < SPAWN_POOL_QUEUE_SIZE; i++)
+	{
+		req = &spawn_pool->requests[i];
+
+		if ((req->status == SPR_QUEUED || req->status == SPR_WORKING) &&
+			req->dbid == MyDatabaseId &&
+			req->partitioned_table == relid &&
+			req->nwaiters < SPAWN_REQUEST_MAX_WAITERS)
+		{
+			req->waiters[req->nwaiters++] = MyProc->pgprocno;
+
+			LWLockRelease(spawn_pool->lock);
+
+			*joined = true;
+			return i;
+		}
+	}
+
+	/* Look for an empty entry */
+	for (i = 0; i < SPAWN_POOL_QUEUE_SIZE; i++)
+	{
+		if (spawn_pool->requests[i].status == SPR_FREE)
+		{
+			req_idx = i;
+			break;
+		}
+	}
+
+	/* Look for an idle worker or a free slot */
+	for (i = 0; req_idx >= 0 && i < pg_pathman_spawn_workers; i++)
+	{
+		SpawnWorkerSlot *slot = &spawn_pool->workers[i];
+
+		if (slot->status == SPW_FREE)
+		{
+			if (start_slot < 0)
+				start_slot = i;
+		}
+		else if (slot->dbid == MyDatabaseId && slot->userid == GetUserId())
+		{
+			has_workers = true;
+
+			if (slot->status == SPW_IDLE && idle_slot < 0)
+				idle_slot = i;
+		}
+	}
+
+	/* Pool can't serve this request */
+	if (req_idx < 0 || (start_slot < 0 && !has_workers))
+	{
+		LWLockRelease(spawn_pool->lock);
+		return -1;
+	}
+
+	/* Fill request */
+	req = &spawn_pool->requests[req_idx];
+	req->status				= SPR_QUEUED;
+	req->userid				= GetUserId();
+	req->dbid				= MyDatabaseId;
+	req->partitioned_table	= relid;
+	req->result				= InvalidOid;
+	req->value_type			= value_type;
+	req->value_size			= value_size;
+	req->value_byval		= value_byval;
+	req->nwaiters			= 1;
+	req->waiters[0]			= MyProc->pgprocno;
+
+	PackDatumToByteArray((void *) req->value, value, value_size, value_byval);
+
+	/* Wake up an idle worker */
+	if (idle_slot >= 0)
+	{
+		SpawnWorkerSlot *slot = &spawn_pool->workers[idle_slot];
+
+		slot->status = SPW_BUSY;
+		SetLatch(&ProcGlobal->allProcs[slot->pgprocno].procLatch);
+
+		start_slot = -1;
+	}
+
+	/* Busy workers will take care of this request */
+	else if (has_workers)
+		start_slot = -1;
+
+	/* Reserve a slot for a new worker */
+	if (start_slot >= 0)
+	{
+		SpawnWorkerSlot *slot = &spawn_pool->workers[start_slot];
+
+		slot->status		= SPW_STARTING;
+		slot->dbid			= MyDatabaseId;
+		slot->userid		= GetUserId();
+		slot->pgprocno		= -1;
+		slot->request		= -1;
+		generation			= ++slot->generation;
+	}
+
+	LWLockRelease(spawn_pool->lock);
+
+	/* Now start a new worker */
+	if (start_slot >= 0 && !start_spawn_pool_worker(start_slot, generation))
+	{
+		LWLockAcquire(spawn_pool->lock, LW_EXCLUSIVE);
+
+		/*
+		 * Other backends might have queued their requests
+		 * in hope that this worker is going to process them.
+		 */
+		spawn_pool_abandon_requests(MyDatabaseId, GetUserId());
+
+		/* Our request can't be processed either */
+		if (req->status == SPR_ABANDONED)
+		{
+			spawn_request_detach(req);
+			req_idx = -1;
+		}
+
+		LWLockRelease(spawn_pool->lock);
+	}
+
+	return req_idx;
+}
+
+/*
+ * Wait till request is processed and fetch its result.
+ * Return false if request has been abandoned or timed out.
+ *
+ * NOTE: pool workers don't join our locking group, so deadlock
+ * detector won't notice if a worker waits for a lock queued behind
+ * someone who waits for our locks (e.g. ALTER TABLE). That's why we
+ * give up after 'deadlock_timeout' and let the caller fall back to
+ * a worker of our own locking group.
+ */
+static bool
+spawn_pool_wait(int req_idx, Oid *result)
+{
+	SpawnRequest   *req = &spawn_pool->requests[req_idx];
+	TimestampTz		deadline;
+	bool			processed = false;
+
+	*result = InvalidOid;
+
+	deadline = TimestampTzPlusMilliseconds(GetCurrentTimestamp(),
+										   DeadlockTimeout);
+
+	PG_TRY();
+	{
+		for (;;)
+		{
+			TimestampTz	now;
+			long		secs;
+			int			usecs,
+						rc;
+
+			LWLockAcquire(spawn_pool->lock, LW_EXCLUSIVE);
+			if (req->status == SPR_DONE || req->status == SPR_ABANDONED)
+			{
+				processed = (req->status == SPR_DONE);
+				*result = req->result;
+				spawn_request_detach(req);
+
+				LWLockRelease(spawn_pool->lock);
+				break;
+			}
+
+			/* Worker might be stuck, stop waiting */
+			now = GetCurrentTimestamp();
+			if (now >= deadline)
+			{
+				spawn_request_detach(req);
+
+				LWLockRelease(spawn_pool->lock);
+				break;
+			}
+			LWLockRelease(spawn_pool->lock);
+
+			TimestampDifference(now, deadline, &secs, &usecs);
+
+			rc = WaitLatchCompat(MyLatch,
+								 WL_LATCH_SET | WL_TIMEOUT | WL_POSTMASTER_DEATH,
+								 secs * 1000L + usecs / 1000 + 1);
+			ResetLatch(MyLatch);
+
+			if (rc & WL_POSTMASTER_DEATH)
+				ereport(ERROR,
+						(errmsg("Postmaster died during the pg_pathman background worker process"),
+						 errhint("More details may be available in the server log.")));
+
+			CHECK_FOR_INTERRUPTS();
+		}
+	}
+	PG_CATCH();
+	{
+		/* We're not waiting anymore */
+		LWLockAcquire(spawn_pool->lock, LW_EXCLUSIVE);
+		spawn_request_detach(req);
+		LWLockRelease(spawn_pool->lock);
+
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	return processed;
+}
+
+/*
+ * Find partition for 'value' created by someone else.
+ */
+static Oid
+find_created_partition(Oid relid, Datum value, Oid value_type)
+{
+	PartRelationInfo   *prel;
+	Oid				   *parts;
+	int					nparts;
+	Oid					result = InvalidOid;
+
+	/* Make changes visible */
+	AcceptInvalidationMessages();
+
+	prel = get_pathman_relation_info(relid);
+	if (!prel)
+		return InvalidOid;
+
+	parts = find_partitions_for_value(value, value_type, prel, &nparts);
+	if (nparts == 1)
+		result = parts[0];
+
+	pfree(parts);
+	close_pathman_relation_info(prel);
+
+	return result;
+}
+
+/*
+ * Create partitions using SpawnPartitionsWorkers' pool.
+ * Return false if pool can't serve this request.
+ */
+static bool
+create_partitions_for_value_pool(Oid relid, Datum value, Oid value_type,
+								 Oid *result)
+{
+	TypeCacheEntry *typcache;
+	Size			datum_size;
+	bool			may_join = true;
+
+	typcache = lookup_type_cache(value_type, 0);
+	datum_size = datumGetSize(value, typcache->typbyval, typcache->typlen);
+
+	/* Large values don't fit into queue */
+	if ((typcache->typbyval ? Max(sizeof(Datum), datum_size) : datum_size) >
+			SPAWN_REQUEST_MAX_VALUE_SIZE)
+		return false;
+
+	/* Pool workers don't join our locking group */
+	if (xact_conflicting_lock_exists(relid))
+		return false;
+
+	for (;;)
+	{
+		int		req_idx;
+		bool	joined;
+
+		req_idx = spawn_pool_submit(relid, value, value_type,
+									datum_size, typcache->typbyval,
+									may_join, &joined);
+		if (req_idx < 0)
+			return false;
+
+		/* Nobody is going to create partitions in time, do it ourselves */
+		if (!spawn_pool_wait(req_idx, result))
+			return false;
+
+		/* Worker has processed our own value */
+		if (!joined)
+			return true;
+
+		/* Partitions created for another backend might suffice */
+		*result = find_created_partition(relid, value, value_type);
+		if (*result != InvalidOid)
+			return true;
+
+		/* Submit our own request this time */
+		may_join = false;
+	}
+}
+
 /*
  * Starts background worker that will create new partitions,
  * waits till it finishes the job and returns the result (new partition oid)
@@ -320,6 +1033,19 @@ create_partitions_for_value_bg_worker(Oid relid, Datum value, Oid value_type)
 				(errmsg("Attempt to spawn partition using bgw from bgw spawning partitions"),
 				 errhint("Probably init_callback has INSERT to its table?")));
 
+	/* Try reusing persistent workers first */
+	if (IsSpawnPoolEnabled() &&
+		create_partitions_for_value_pool(relid, value, value_type, &child_oid))
+	{
+		if (child_oid == InvalidOid)
+			ereport(ERROR,
+					(errmsg("attempt to spawn new partitions of relation \"%s\" failed",
+							get_rel_name_or_relid(relid)),
+					 errhint("See server log for more details.")));
+
+		return child_oid;
+	}
+
 	/* Create a dsm segment for the worker to pass arguments */
 	segment = create_partitions_bg_worker_segment(relid, value, value_type);
 	segment_handle = dsm_segment_handle(segment);
@@ -416,34 +1142,410 @@ bgw_main_spawn_partitions(Datum main_arg)
 		 DebugPrintDatum(value, args->value_type), MyProcPid);
 #endif
 
-	/*
-	 * Create partitions and save the Oid of the last one.
-	 * If we fail here, args->result is 0 since it is zeroed on initialization.
-	 */
-	result = create_partitions_for_value_internal(args->partitioned_table,
-												  value, /* unpacked Datum */
-												  args->value_type);
+	/*
+	 * Create partitions and save the Oid of the last one.
+	 * If we fail here, args->result is 0 since it is zeroed on initialization.
+	 */
+	result = create_partitions_for_value_internal(args->partitioned_table,
+												  value, /* unpacked Datum */
+												  args->value_type);
+
+	/* Finish transaction in an appropriate way */
+	CommitTransactionCommand();
+	args->result = result;
+	dsm_detach(segment);
+}
+
+
+/*
+ * ------------------------------------------
+ *  SpawnPartitionsPoolWorker implementation
+ * ------------------------------------------
+ */
+
+/* Free bgworker's slot and abandon requests nobody is going to process */
+static void
+free_spawn_pool_slot(int code, Datum arg)
+{
+	SpawnWorkerSlot	   *slot = &spawn_pool->workers[DatumGetInt32(arg)];
+
+	/* We might have been holding the lock */
+	LWLockReleaseAll();
+
+	LWLockAcquire(spawn_pool->lock, LW_EXCLUSIVE);
+
+	/* Slot might have already been released */
+	if (slot->status != SPW_FREE && slot->pgprocno == MyProc->pgprocno)
+	{
+		if (slot->request >= 0)
+			spawn_request_finish(&spawn_pool->requests[slot->request], InvalidOid);
+
+		slot->status = SPW_FREE;
+		slot->pgprocno = -1;
+		slot->request = -1;
+	}
+
+	/* NOTE: slot might have been taken by another worker */
+	spawn_pool_abandon_requests(spawn_pool_dbid, spawn_pool_userid);
+
+	LWLockRelease(spawn_pool->lock);
+}
+
+/*
+ * Take the next request of our database & user.
+ * NOTE: caller should hold spawn_pool->lock.
+ */
+static int
+spawn_pool_take_request(SpawnWorkerSlot *slot)
+{
+	int i;
+
+	for (i = 0; i < SPAWN_POOL_QUEUE_SIZE; i++)
+	{
+		SpawnRequest *req = &spawn_pool->requests[i];
+
+		if (req->status == SPR_QUEUED &&
+			req->dbid == slot->dbid &&
+			req->userid == slot->userid)
+		{
+			req->status = SPR_WORKING;
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+/*
+ * Create partitions for a request in a separate transaction.
+ */
+static Oid
+spawn_pool_process_request(SpawnRequest *req)
+{
+	MemoryContext	old_mcxt;
+	Oid				result = InvalidOid;
+	bool			failed = false;
+
+	/* Start new transaction (syscache access etc.) */
+	StartTransactionCommand();
+
+	/* We'll need this to recover from errors */
+	old_mcxt = CurrentMemoryContext;
+
+	PG_TRY();
+	{
+		Datum value;
+
+		/* Finish all delayed invalidation jobs */
+		if (IsPathmanReady())
+			finish_delayed_invalidation();
+
+		/* Initialize pg_pathman's local config */
+		if (!IsPathmanInitialized())
+			bg_worker_load_config(spawn_pool_bgw);
+
+		/* Upack Datum from queue to 'value' */
+		UnpackDatumFromByteArray(&value,
+								 req->value_size,
+								 req->value_byval,
+								 (const void *) req->value);
+
+		result = create_partitions_for_value_internal(req->partitioned_table,
+													  value, /* unpacked Datum */
+													  req->value_type);
+	}
+	PG_CATCH();
+	{
+		ErrorData *error;
+
+		failed = true;
+
+		/* Switch to the original context & copy edata */
+		MemoryContextSwitchTo(old_mcxt);
+		error = CopyErrorData();
+		FlushErrorState();
+
+		/* Print message for this BGWorker to server log */
+		ereport(LOG,
+				(errmsg("%s: %s", spawn_pool_bgw, error->message),
+				 errdetail("relation: %u", req->partitioned_table)));
+
+		/* Finally, free error data */
+		FreeErrorData(error);
+	}
+	PG_END_TRY();
+
+	/* Finish transaction in an appropriate way */
+	if (failed)
+	{
+		AbortCurrentTransaction();
+		result = InvalidOid;
+	}
+	else CommitTransactionCommand();
+
+	return result;
+}
+
+/*
+ * Entry point for SpawnPartitionsPoolWorker's process.
+ */
+void
+bgw_main_spawn_pool(Datum main_arg)
+{
+	int					slot_idx = DatumGetInt32(main_arg);
+	SpawnWorkerSlot	   *slot = &spawn_pool->workers[slot_idx];
+
+	/* Establish signal handlers before unblocking signals */
+	pqsignal(SIGTERM, handle_sigterm);
+
+	/* We're now ready to receive signals */
+	BackgroundWorkerUnblockSignals();
+
+	am_spawn_bgw = true;
+
+	/* Create resource owner */
+	CurrentResourceOwner = ResourceOwnerCreate(NULL, spawn_pool_bgw);
+
+	/* Take the slot reserved for us */
+	LWLockAcquire(spawn_pool->lock, LW_EXCLUSIVE);
+	slot->pgprocno = MyProc->pgprocno;
+	slot->status = SPW_BUSY;
+	spawn_pool_dbid = slot->dbid;
+	spawn_pool_userid = slot->userid;
+	LWLockRelease(spawn_pool->lock);
+
+	/* Establish atexit callback that will free the slot */
+	before_shmem_exit(free_spawn_pool_slot, Int32GetDatum(slot_idx));
+
+	/* Establish connection */
+	BackgroundWorkerInitializeConnectionByOidCompat(spawn_pool_dbid,
+													spawn_pool_userid);
+
+	for (;;)
+	{
+		int		req_idx;
+		int		rc;
+
+		CHECK_FOR_INTERRUPTS();
+
+		LWLockAcquire(spawn_pool->lock, LW_EXCLUSIVE);
+		req_idx = spawn_pool_take_request(slot);
+		slot->request = req_idx;
+		slot->status = (req_idx >= 0) ? SPW_BUSY : SPW_IDLE;
+		LWLockRelease(spawn_pool->lock);
+
+		/* Process request and wake up waiting backends */
+		if (req_idx >= 0)
+		{
+			SpawnRequest   *req = &spawn_pool->requests[req_idx];
+			Oid				result;
+
+			result = spawn_pool_process_request(req);
+
+			LWLockAcquire(spawn_pool->lock, LW_EXCLUSIVE);
+			spawn_request_finish(req, result);
+			slot->request = -1;
+			LWLockRelease(spawn_pool->lock);
+
+			continue;
+		}
+
+		rc = WaitLatchCompat(MyLatch,
+							 WL_LATCH_SET | WL_TIMEOUT | WL_POSTMASTER_DEATH,
+							 SPAWN_WORKER_IDLE_TIMEOUT * 1000L);
+		ResetLatch(MyLatch);
+
+		/* Emergency bailout if postmaster has died */
+		if (rc & WL_POSTMASTER_DEATH)
+			proc_exit(1);
+
+		/* Quit if nobody has woken us up */
+		if (rc & WL_TIMEOUT)
+		{
+			bool quit = false;
+
+			LWLockAcquire(spawn_pool->lock, LW_EXCLUSIVE);
+			if (slot->status == SPW_IDLE)
+			{
+				slot->status = SPW_FREE;
+				slot->pgprocno = -1;
+				quit = true;
+			}
+			LWLockRelease(spawn_pool->lock);
+
+			if (quit)
+				proc_exit(0);
+		}
+	}
+}
+
+
+/*
+ * -------------------------------------
+ *  ConcurrentPartWorker implementation
+ * -------------------------------------
+ */
+
+/* Free bgworker's CPS slot */
+static void
+free_cps_slot(int code, Datum arg)
+{
+	ConcurrentPartSlot *part_slot = (ConcurrentPartSlot *) DatumGetPointer(arg);
+
+	cps_set_status(part_slot, CPS_FREE);
+}
+
+/* Get leader's slot if it's still working on the same task */
+static ConcurrentPartSlot *
+cps_get_leader(ConcurrentPartSlot *part_slot)
+{
+	ConcurrentPartSlot *leader;
+	bool				alive;
+
+	if (part_slot->leader_slot < 0)
+		return NULL;
+
+	leader = &concurrent_part_slots[part_slot->leader_slot];
+
+	SpinLockAcquire(&leader->mutex);
+	alive = (leader->worker_status != CPS_FREE &&
+			 leader->part_worker == 0 &&
+			 leader->relid == part_slot->relid &&
+			 leader->dbid == part_slot->dbid);
+	SpinLockRelease(&leader->mutex);
+
+	return alive ? leader : NULL;
+}
+
+/* Check if other workers of the same task are still running */
+static bool
+cps_task_has_helpers(ConcurrentPartSlot *part_slot)
+{
+	int i;
+
+	for (i = 0; i < PART_WORKER_SLOTS; i++)
+	{
+		ConcurrentPartSlot *cur_slot = &concurrent_part_slots[i];
+		bool				busy;
+
+		if (cur_slot == part_slot)
+			continue;
+
+		SpinLockAcquire(&cur_slot->mutex);
+		busy = (cur_slot->worker_status != CPS_FREE &&
+				cur_slot->relid == part_slot->relid &&
+				cur_slot->dbid == part_slot->dbid);
+		SpinLockRelease(&cur_slot->mutex);
+
+		if (busy)
+			return true;
+	}
+
+	return false;
+}
+
+/* Add throughput of other workers of the task to 'leader' (a copy) */
+static void
+cps_add_helpers_rates(int leader_idx, ConcurrentPartSlot *leader)
+{
+	int i;
+
+	for (i = 0; i < PART_WORKER_SLOTS; i++)
+	{
+		ConcurrentPartSlot *cur_slot = &concurrent_part_slots[i];
+
+		if (i == leader_idx)
+			continue;
+
+		SpinLockAcquire(&cur_slot->mutex);
+		if (cur_slot->worker_status != CPS_FREE &&
+			cur_slot->part_worker > 0 &&
+			cur_slot->leader_slot == leader_idx &&
+			cur_slot->relid == leader->relid &&
+			cur_slot->dbid == leader->dbid)
+		{
+			leader->rows_per_sec += cur_slot->rows_per_sec;
+			leader->bytes_per_sec += cur_slot->bytes_per_sec;
+		}
+		SpinLockRelease(&cur_slot->mutex);
+	}
+}
+
+/* Milliseconds elapsed since 'start' */
+static double
+cps_elapsed_ms(TimestampTz start)
+{
+	long	secs;
+	int		usecs;
+
+	TimestampDifference(start, GetCurrentTimestamp(), &secs, &usecs);
 
-	/* Finish transaction in an appropriate way */
-	CommitTransactionCommand();
-	args->result = result;
-	dsm_detach(segment);
+	return secs * 1000.0 + usecs / 1000.0;
 }
 
-
 /*
- * -------------------------------------
- *  ConcurrentPartWorker implementation
- * -------------------------------------
+ * Adapt batch size of a worker to the duration of its last batch
+ * (or halve it if the batch has failed) and update its throughput.
+ * Returns time (ms) the worker should sleep to stay within duty cycle.
  */
-
-/* Free bgworker's CPS slot */
-static void
-free_cps_slot(int code, Datum arg)
+static double
+cps_update_batch_stats(ConcurrentPartSlot *part_slot,
+					   int64 rows, int64 bytes,
+					   double elapsed_ms, bool failed)
 {
-	ConcurrentPartSlot *part_slot = (ConcurrentPartSlot *) DatumGetPointer(arg);
+	int32	batch_size = part_slot->batch_size;
+	double	throttle_ms = 0.0,
+			cycle_ms,
+			rows_rate,
+			bytes_rate;
+
+	/* Nothing has been moved */
+	if (failed)
+		rows = bytes = 0;
+
+	/* Only the worker itself changes these fields */
+	if (part_slot->batch_time > 0)
+	{
+		/* Lock conflicts, deadlocks etc: back off */
+		if (failed)
+			batch_size = batch_size / 2;
 
-	cps_set_status(part_slot, CPS_FREE);
+		/* Partial batch means that we've run out of rows */
+		else if (rows >= batch_size && elapsed_ms > 0.0)
+		{
+			double factor = part_slot->batch_time / elapsed_ms;
+
+			/* Don't change batch size too fast */
+			factor = Max(factor, 0.5);
+			factor = Min(factor, 2.0);
+
+			batch_size = (int32) (batch_size * factor);
+		}
+
+		batch_size = Max(batch_size, PART_WORKER_MIN_BATCH_SIZE);
+		batch_size = Min(batch_size, PART_WORKER_MAX_BATCH_SIZE);
+	}
+
+	/* Sleep for a while after each batch */
+	if (!failed && part_slot->duty_cycle < 1.0)
+		throttle_ms = elapsed_ms * (1.0 - part_slot->duty_cycle) /
+					  part_slot->duty_cycle;
+
+	cycle_ms = elapsed_ms + throttle_ms +
+			   (failed ? part_slot->sleep_time * 1000.0 : 0.0);
+
+	rows_rate = (cycle_ms > 0.0) ? rows * 1000.0 / cycle_ms : 0.0;
+	bytes_rate = (cycle_ms > 0.0) ? bytes * 1000.0 / cycle_ms : 0.0;
+
+	SpinLockAcquire(&part_slot->mutex);
+	part_slot->batch_size = batch_size;
+
+	/* Exponential moving average */
+	part_slot->rows_per_sec = 0.7 * part_slot->rows_per_sec + 0.3 * rows_rate;
+	part_slot->bytes_per_sec = 0.7 * part_slot->bytes_per_sec + 0.3 * bytes_rate;
+	SpinLockRelease(&part_slot->mutex);
+
+	return throttle_ms;
 }
 
 /*
@@ -454,10 +1556,17 @@ bgw_main_concurrent_part(Datum main_arg)
 {
 	ConcurrentPartSlot *part_slot;
 	char			   *sql = NULL;
-	int64				rows;
+	int64				rows,
+						bytes;
+	TimestampTz			batch_start;
+	double				throttle_ms;
 	bool				failed;
 	int					failures_count = 0;
 	LOCKMODE			lockmode = RowExclusiveLock;
+	bool				bounded;
+	Datum				min_value = (Datum) 0,
+						max_value = (Datum) 0;
+	BlockNumber			start_block = 0;
 
 	/* Update concurrent part slot */
 	part_slot = &concurrent_part_slots[DatumGetInt32(main_arg)];
@@ -486,19 +1595,37 @@ bgw_main_concurrent_part(Datum main_arg)
 	bg_worker_load_config(concurrent_part_bgw);
 	CommitTransactionCommand();
 
+	/* Process only a part of the table if the task has been split */
+	bounded = part_slot->has_min || part_slot->has_max;
+
+/* process rows of the assigned range */
+process_range:
+
 	/* Do the job */
 	do
 	{
 		MemoryContext old_mcxt;
 
-		Oid		types[2]	= { OIDOID,				INT4OID };
-		Datum	vals[2]		= { part_slot->relid,	part_slot->batch_size };
+		Oid		types[4]	= { OIDOID,
+								part_slot->bound_type,
+								part_slot->bound_type,
+								INT4OID };
+		Datum	vals[4]		= { part_slot->relid,
+								min_value,
+								max_value,
+								part_slot->batch_size };
+		char	nulls[4]	= { ' ',
+								part_slot->has_min ? ' ' : 'n',
+								part_slot->has_max ? ' ' : 'n',
+								' ' };
 
 		bool	rel_locked = false;
 
 		/* Reset loop variables */
 		failed = false;
 		rows = 0;
+		bytes = 0;
+		batch_start = GetCurrentTimestamp();
 
 		CHECK_FOR_INTERRUPTS();
 
@@ -523,8 +1650,30 @@ bgw_main_concurrent_part(Datum main_arg)
 			 * context will be destroyed after transaction finishes
 			 */
 			current_mcxt = MemoryContextSwitchTo(TopPathmanContext);
-			sql = psprintf("SELECT %s._partition_data_concurrent($1::oid, p_limit:=$2)",
-						   get_namespace_name(get_pathman_schema()));
+			if (bounded)
+			{
+				/* Bounds of range have been packed by the backend */
+				if (part_slot->has_min)
+					UnpackDatumFromByteArray(&min_value,
+											 part_slot->min_size,
+											 part_slot->bound_byval,
+											 (const void *) part_slot->min_value);
+
+				if (part_slot->has_max)
+					UnpackDatumFromByteArray(&max_value,
+											 part_slot->max_size,
+											 part_slot->bound_byval,
+											 (const void *) part_slot->max_value);
+
+				vals[1] = min_value;
+				vals[2] = max_value;
+
+				sql = psprintf("SELECT %s._partition_data_concurrent($1::oid, $2, $3, p_limit:=$4)",
+							   get_namespace_name(get_pathman_schema()));
+			}
+			else
+				sql = psprintf("SELECT %s._partition_data_concurrent($1::oid, p_limit:=$2)",
+							   get_namespace_name(get_pathman_schema()));
 			MemoryContextSwitchTo(current_mcxt);
 		}
 
@@ -565,23 +1714,49 @@ bgw_main_concurrent_part(Datum main_arg)
 					 get_rel_name(part_slot->relid));
 			}
 
-			/* Call concurrent partitioning function */
-			ret = SPI_execute_with_args(sql, 2, types, vals, NULL, false, 0);
-			if (ret == SPI_OK_SELECT)
+			/* Move rows without SPI & PL/pgSQL if possible */
+			if (part_slot->native_mover &&
+				can_move_parent_rows(part_slot->relid))
 			{
-				TupleDesc	tupdesc	= SPI_tuptable->tupdesc;
-				HeapTuple	tuple	= SPI_tuptable->vals[0];
-
-				/* There should be 1 result at most */
-				Assert(SPI_processed == 1);
-
-				/* Extract number of processed rows */
-				rows = DatumGetInt64(SPI_getbinval(tuple, tupdesc, 1, &isnull));
-				Assert(TupleDescAttr(tupdesc, 0)->atttypid == INT8OID); /* check type */
-				Assert(!isnull); /* ... and ofc it must not be NULL */
+				rows = move_parent_rows(part_slot->relid,
+										(bounded && part_slot->has_min) ?
+											&min_value : NULL,
+										(bounded && part_slot->has_max) ?
+											&max_value : NULL,
+										part_slot->batch_size,
+										&start_block,
+										&bytes);
+			}
+			else
+			{
+				/* Call concurrent partitioning function */
+				if (bounded)
+					ret = SPI_execute_with_args(sql, 4, types, vals, nulls, false, 0);
+				else
+				{
+					types[1] = types[3];
+					vals[1] = vals[3];
+					ret = SPI_execute_with_args(sql, 2, types, vals, NULL, false, 0);
+				}
+				if (ret == SPI_OK_SELECT)
+				{
+					TupleDesc	tupdesc	= SPI_tuptable->tupdesc;
+					HeapTuple	tuple	= SPI_tuptable->vals[0];
+
+					/* There should be 1 result at most */
+					Assert(SPI_processed == 1);
+
+					/* Extract number of processed rows */
+					rows = DatumGetInt64(SPI_getbinval(tuple, tupdesc, 1, &isnull));
+					Assert(TupleDescAttr(tupdesc, 0)->atttypid == INT8OID); /* check type */
+					Assert(!isnull); /* ... and ofc it must not be NULL */
+
+					/* We can only estimate amount of data */
+					bytes = rows * get_relation_data_width(part_slot->relid, NULL);
+				}
+				/* Else raise generic error */
+				else elog(ERROR, "partitioning function returned %u", ret);
 			}
-			/* Else raise generic error */
-			else elog(ERROR, "partitioning function returned %u", ret);
 
 			/* Finally, unlock our partitioned table */
 			UnlockRelationOid(part_slot->relid, lockmode);
@@ -624,6 +1799,11 @@ bgw_main_concurrent_part(Datum main_arg)
 		SPI_finish();
 		PopActiveSnapshot();
 
+		/* Adapt batch size to the duration of this batch */
+		throttle_ms = cps_update_batch_stats(part_slot, rows, bytes,
+											 cps_elapsed_ms(batch_start),
+											 failed);
+
 		/* We've run out of attempts, exit */
 		if (failures_count >= PART_WORKER_MAX_ATTEMPTS)
 		{
@@ -663,6 +1843,19 @@ bgw_main_concurrent_part(Datum main_arg)
 			part_slot->total_rows += rows;
 			SpinLockRelease(&part_slot->mutex);
 
+			/* Leader shows progress of the whole task */
+			if (part_slot->part_worker > 0)
+			{
+				ConcurrentPartSlot *leader = cps_get_leader(part_slot);
+
+				if (leader)
+				{
+					SpinLockAcquire(&leader->mutex);
+					leader->total_rows += rows;
+					SpinLockRelease(&leader->mutex);
+				}
+			}
+
 #ifdef USE_ASSERT_CHECKING
 			/* Report debug message */
 			elog(DEBUG1, "%s: "
@@ -670,6 +1863,11 @@ bgw_main_concurrent_part(Datum main_arg)
 						 "total: " INT64_FORMAT,
 				 concurrent_part_bgw, rows, part_slot->total_rows);
 #endif
+
+			/* Stay within the duty cycle */
+			if (rows > 0 && throttle_ms >= 1.0 &&
+				cps_check_status(part_slot) != CPS_STOPPING)
+				DirectFunctionCall1(pg_sleep, Float8GetDatum(throttle_ms / 1000.0));
 		}
 
 		/* If other backend requested to stop us, quit */
@@ -677,6 +1875,33 @@ bgw_main_concurrent_part(Datum main_arg)
 			break;
 	}
 	while(rows > 0 || failed); /* do while there's still rows to be relocated */
+
+	/*
+	 * Leader relocates rows which have been left by other
+	 * workers (e.g. if some of them have failed to start).
+	 */
+	if (bounded && part_slot->part_worker == 0)
+	{
+		/* Wait till other workers are done */
+		while (cps_check_status(part_slot) != CPS_STOPPING &&
+			   cps_task_has_helpers(part_slot))
+		{
+			CHECK_FOR_INTERRUPTS();
+
+			DirectFunctionCall1(pg_sleep, Float8GetDatum(part_slot->sleep_time));
+		}
+
+		if (cps_check_status(part_slot) != CPS_STOPPING)
+		{
+			/* Now process the whole table */
+			bounded = false;
+			start_block = 0;
+			pfree(sql);
+			sql = NULL;
+
+			goto process_range;
+		}
+	}
 }
 
 
@@ -686,6 +1911,104 @@ bgw_main_concurrent_part(Datum main_arg)
  * -----------------------------------------------
  */
 
+/*
+ * Assign ranges of partitioning expression to reserved slots, so that
+ * each worker relocates rows of neighboring RANGE partitions.
+ * Return number of workers which should be started.
+ */
+static int
+split_concurrent_part_task(Oid relid, int *slots, int nslots)
+{
+	PartRelationInfo   *prel;
+	RangeEntry		   *ranges;
+	Bound			  **bounds;
+	Size			   *sizes;
+	int					nworkers,
+						nchildren,
+						i;
+
+	if (nslots < 2)
+		return nslots;
+
+	prel = get_pathman_relation_info(relid);
+
+	/* HASH partitions don't give us ranges */
+	if (!prel || prel->parttype != PT_RANGE || PrelChildrenCount(prel) < 2)
+	{
+		if (prel)
+			close_pathman_relation_info(prel);
+
+		return 1;
+	}
+
+	ranges = PrelGetRangesArray(prel);
+	nchildren = PrelChildrenCount(prel);
+	nworkers = Min(nslots, nchildren);
+
+	/* Worker 'i' processes [bounds[i], bounds[i + 1]) */
+	bounds = palloc0((nworkers + 1) * sizeof(Bound *));
+	sizes = palloc0((nworkers + 1) * sizeof(Size));
+
+	for (i = 1; i < nworkers; i++)
+	{
+		Bound *bound = &ranges[i * nchildren / nworkers].min;
+
+		/* Bounds should fit into slots */
+		if (IsInfinite(bound))
+			break;
+
+		sizes[i] = datumGetSize(BoundGetValue(bound), prel->ev_byval, prel->ev_len);
+		if ((prel->ev_byval ? Max(sizeof(Datum), sizes[i]) : sizes[i]) >
+				CONCURRENT_PART_MAX_BOUND_SIZE)
+			break;
+
+		bounds[i] = bound;
+	}
+
+	/* Fall back to a single worker */
+	if (i < nworkers)
+	{
+		close_pathman_relation_info(prel);
+		return 1;
+	}
+
+	for (i = 0; i < nworkers; i++)
+	{
+		ConcurrentPartSlot *cur_slot = &concurrent_part_slots[slots[i]];
+
+		SpinLockAcquire(&cur_slot->mutex);
+
+		cur_slot->part_worker	= i;
+		cur_slot->leader_slot	= slots[0];
+		cur_slot->bound_type	= prel->ev_type;
+		cur_slot->bound_byval	= prel->ev_byval;
+		cur_slot->has_min		= (bounds[i] != NULL);
+		cur_slot->has_max		= (bounds[i + 1] != NULL);
+
+		if (cur_slot->has_min)
+		{
+			cur_slot->min_size = sizes[i];
+			PackDatumToByteArray((void *) cur_slot->min_value,
+								 BoundGetValue(bounds[i]),
+								 sizes[i], prel->ev_byval);
+		}
+
+		if (cur_slot->has_max)
+		{
+			cur_slot->max_size = sizes[i + 1];
+			PackDatumToByteArray((void *) cur_slot->max_value,
+								 BoundGetValue(bounds[i + 1]),
+								 sizes[i + 1], prel->ev_byval);
+		}
+
+		SpinLockRelease(&cur_slot->mutex);
+	}
+
+	close_pathman_relation_info(prel);
+
+	return nworkers;
+}
+
 /*
  * Start concurrent partitioning worker to redistribute rows.
  * NOTE: this function returns immediately.
@@ -696,13 +2019,16 @@ partition_table_concurrently(PG_FUNCTION_ARGS)
 	Oid				relid = PG_GETARG_OID(0);
 	int32			batch_size = PG_GETARG_INT32(1);
 	float8			sleep_time = PG_GETARG_FLOAT8(2);
-	int				empty_slot_idx = -1,		/* do we have a slot for BGWorker? */
+	int				nworkers = pg_pathman_concurrent_part_workers,
+				   *slots,						/* slots for BGWorkers */
+					nslots = 0,
 					i;
 	TransactionId	rel_xmin;
 	LOCKMODE		lockmode = ShareUpdateExclusiveLock;
 
 	/* Check batch_size */
-	if (batch_size < 1 || batch_size > 10000)
+	if (batch_size < PART_WORKER_MIN_BATCH_SIZE ||
+		batch_size > PART_WORKER_MAX_BATCH_SIZE)
 		ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
 						errmsg("'batch_size' should not be less than 1"
 							   " or greater than 10000")));
@@ -731,71 +2057,85 @@ partition_table_concurrently(PG_FUNCTION_ARGS)
 								get_rel_name_or_relid(relid))));
 
 	/*
-	 * Look for an empty slot and also check that a concurrent
-	 * partitioning operation for this table hasn't started yet.
+	 * Check that a concurrent partitioning
+	 * operation for this table hasn't started yet.
 	 */
 	for (i = 0; i < PART_WORKER_SLOTS; i++)
 	{
 		ConcurrentPartSlot *cur_slot = &concurrent_part_slots[i];
-		bool				keep_this_lock = false;
+		bool				busy;
 
-		/* Lock current slot */
 		SpinLockAcquire(&cur_slot->mutex);
-
-		/* Should we take this slot into account? (it should be FREE) */
-		if (empty_slot_idx < 0 && cur_slot->worker_status == CPS_FREE)
-		{
-			empty_slot_idx = i;		/* yes, remember this slot */
-			keep_this_lock = true;	/* also don't unlock it */
-		}
+		busy = (cur_slot->relid == relid &&
+				cur_slot->dbid == MyDatabaseId &&
+				cur_slot->worker_status != CPS_FREE);
+		SpinLockRelease(&cur_slot->mutex);
 
 		/* Oops, looks like we already have BGWorker for this table */
-		if (cur_slot->relid == relid &&
-			cur_slot->dbid == MyDatabaseId &&
-			cur_slot->worker_status != CPS_FREE)
-		{
-			/* Unlock current slot */
-			SpinLockRelease(&cur_slot->mutex);
-
-			/* Release borrowed slot for new BGWorker too */
-			if (empty_slot_idx >= 0 && empty_slot_idx != i)
-				SpinLockRelease(&concurrent_part_slots[empty_slot_idx].mutex);
-
+		if (busy)
 			ereport(ERROR, (errmsg("table \"%s\" is already being partitioned",
 								   get_rel_name(relid))));
+	}
+
+	/* Look for empty slots (one per worker) */
+	slots = palloc(nworkers * sizeof(int));
+	for (i = 0; i < PART_WORKER_SLOTS && nslots < nworkers; i++)
+	{
+		ConcurrentPartSlot *cur_slot = &concurrent_part_slots[i];
+
+		/* Lock current slot */
+		SpinLockAcquire(&cur_slot->mutex);
+
+		/* Initialize concurrent part slot if it's FREE */
+		if (cur_slot->worker_status == CPS_FREE)
+		{
+			InitConcurrentPartSlot(cur_slot,
+								   GetUserId(), CPS_WORKING, MyDatabaseId,
+								   relid, batch_size, sleep_time);
+			cur_slot->native_mover = pg_pathman_enable_native_data_mover;
+			cur_slot->batch_time = pg_pathman_concurrent_part_batch_time;
+			cur_slot->duty_cycle = pg_pathman_concurrent_part_duty_cycle;
+
+			slots[nslots++] = i;
 		}
 
-		/* Normally we don't want to keep it */
-		if (!keep_this_lock)
-			SpinLockRelease(&cur_slot->mutex);
+		SpinLockRelease(&cur_slot->mutex);
 	}
 
 	/* Looks like we could not find an empty slot */
-	if (empty_slot_idx < 0)
+	if (nslots == 0)
 		ereport(ERROR, (errcode(ERRCODE_CONFIGURATION_LIMIT_EXCEEDED),
 						errmsg("no empty worker slots found"),
 						errhint("consider increasing max_worker_processes")));
-	else
-	{
-		/* Initialize concurrent part slot */
-		InitConcurrentPartSlot(&concurrent_part_slots[empty_slot_idx],
-							   GetUserId(), CPS_WORKING, MyDatabaseId,
-							   relid, batch_size, sleep_time);
 
-		/* Now we can safely unlock slot for new BGWorker */
-		SpinLockRelease(&concurrent_part_slots[empty_slot_idx].mutex);
-	}
+	/* Split the task between workers (if possible) */
+	nworkers = split_concurrent_part_task(relid, slots, nslots);
+
+	/* Release slots we don't need */
+	for (i = nworkers; i < nslots; i++)
+		cps_set_status(&concurrent_part_slots[slots[i]], CPS_FREE);
 
-	/* Start worker (we should not wait) */
-	if (!start_bgworker(concurrent_part_bgw,
-						CppAsString(bgw_main_concurrent_part),
-						Int32GetDatum(empty_slot_idx),
-						false))
+	/* Start workers (we should not wait), leader goes first */
+	for (i = 0; i < nworkers; i++)
 	{
-		/* Couldn't start, free CPS slot */
-		cps_set_status(&concurrent_part_slots[empty_slot_idx], CPS_FREE);
+		if (!start_bgworker(concurrent_part_bgw,
+							CppAsString(bgw_main_concurrent_part),
+							Int32GetDatum(slots[i]),
+							false))
+		{
+			/* Couldn't start, free CPS slot */
+			cps_set_status(&concurrent_part_slots[slots[i]], CPS_FREE);
+
+			/* Leader will process rows of other workers */
+			if (i > 0)
+				continue;
 
-		start_bgworker_errmsg(concurrent_part_bgw);
+			/* Free the rest of slots */
+			for (i = 1; i < nworkers; i++)
+				cps_set_status(&concurrent_part_slots[slots[i]], CPS_FREE);
+
+			start_bgworker_errmsg(concurrent_part_bgw);
+		}
 	}
 
 	/* Tell user everything's fine */
@@ -853,6 +2193,10 @@ show_concurrent_part_tasks_internal(PG_FUNCTION_ARGS)
 						   "processed", INT8OID, -1, 0);
 		TupleDescInitEntry(tupdesc, Anum_pathman_cp_tasks_status,
 						   "status", TEXTOID, -1, 0);
+		TupleDescInitEntry(tupdesc, Anum_pathman_cp_tasks_rows_per_sec,
+						   "rows_per_sec", FLOAT8OID, -1, 0);
+		TupleDescInitEntry(tupdesc, Anum_pathman_cp_tasks_bytes_per_sec,
+						   "bytes_per_sec", FLOAT8OID, -1, 0);
 
 		funcctx->tuple_desc = BlessTupleDesc(tupdesc);
 		funcctx->user_fctx = (void *) userctx;
@@ -875,6 +2219,12 @@ show_concurrent_part_tasks_internal(PG_FUNCTION_ARGS)
 		memcpy(&slot_copy, cur_slot, sizeof(ConcurrentPartSlot));
 		SpinLockRelease(&cur_slot->mutex);
 
+		/* Progress of helpers is shown by their leader */
+		if (slot_copy.worker_status != CPS_FREE &&
+			slot_copy.part_worker > 0 &&
+			cps_get_leader(&slot_copy) != NULL)
+			continue;
+
 		if (slot_copy.worker_status != CPS_FREE)
 		{
 			Datum		values[Natts_pathman_cp_tasks];
@@ -893,6 +2243,15 @@ show_concurrent_part_tasks_internal(PG_FUNCTION_ARGS)
 			values[Anum_pathman_cp_tasks_status - 1] =
 					CStringGetTextDatum(cps_print_status(slot_copy.worker_status));
 
+			/* Leader shows throughput of the whole task */
+			if (slot_copy.part_worker == 0)
+				cps_add_helpers_rates(i, &slot_copy);
+
+			values[Anum_pathman_cp_tasks_rows_per_sec - 1] =
+					Float8GetDatum(slot_copy.rows_per_sec);
+			values[Anum_pathman_cp_tasks_bytes_per_sec - 1] =
+					Float8GetDatum(slot_copy.bytes_per_sec);
+
 			/* Form output tuple */
 			htup = heap_form_tuple(funcctx->tuple_desc, values, isnull);
 
@@ -919,7 +2278,8 @@ stop_concurrent_part_task(PG_FUNCTION_ARGS)
 	bool	worker_found = false;
 	int		i;
 
-	for (i = 0; i < PART_WORKER_SLOTS && !worker_found; i++)
+	/* Task might be split between several workers, stop all of them */
+	for (i = 0; i < PART_WORKER_SLOTS; i++)
 	{
 		ConcurrentPartSlot *cur_slot = &concurrent_part_slots[i];
 
@@ -950,3 +2310,320 @@ stop_concurrent_part_task(PG_FUNCTION_ARGS)
 		PG_RETURN_BOOL(false); /* keep compiler happy */
 	}
 }
+
+
+/*
+ * ----------------------------------------
+ *  PremakePartitionsWorker implementation
+ * ----------------------------------------
+ */
+
+/*
+ * Fetch RANGE-partitioned tables which permit auto partition creation.
+ */
+static Oid *
+premake_list_parents(MemoryContext mcxt, int *nparents)
+{
+	const char *pathman_schema;
+	char	   *sql;
+	Oid		   *parents;
+	int			ret,
+				i;
+
+	if (SPI_connect() != SPI_OK_CONNECT)
+		elog(ERROR, "could not connect using SPI");
+
+	PushActiveSnapshot(GetTransactionSnapshot());
+
+	pathman_schema = get_namespace_name(get_pathman_schema());
+	sql = psprintf("SELECT c.partrel FROM %s.%s c "
+				   "WHERE c.parttype = %d AND c.range_interval IS NOT NULL "
+				   "AND NOT EXISTS (SELECT 1 FROM %s.%s p "
+				   "WHERE p.partrel = c.partrel AND NOT p.auto)",
+				   pathman_schema, PATHMAN_CONFIG, PT_RANGE,
+				   pathman_schema, PATHMAN_CONFIG_PARAMS);
+
+	ret = SPI_execute(sql, true, 0);
+	if (ret != SPI_OK_SELECT)
+		elog(ERROR, "%s: could not fetch partitioned tables, error code %d",
+			 premake_partitions_bgw, ret);
+
+	*nparents = (int) SPI_processed;
+	parents = MemoryContextAlloc(mcxt, Max(*nparents, 1) * sizeof(Oid));
+
+	for (i = 0; i < *nparents; i++)
+	{
+		bool isnull;
+
+		parents[i] = DatumGetObjectId(SPI_getbinval(SPI_tuptable->vals[i],
+													SPI_tuptable->tupdesc,
+													1, &isnull));
+		Assert(!isnull);
+	}
+
+	SPI_finish();
+	PopActiveSnapshot();
+
+	return parents;
+}
+
+/*
+ * Append partitions to 'relid' until it has enough empty partitions
+ * beyond the last one containing data.
+ */
+static void
+premake_partitions_internal(Oid relid, int sec_context)
+{
+	PartRelationInfo   *prel;
+	RangeEntry		   *ranges;
+	Oid				   *children;
+	char			   *sql;
+	int					premake = pg_pathman_premake_partitions,
+						nchildren,
+						ahead = 0,
+						i;
+
+	/* Make sure that relation exists */
+	if (!SearchSysCacheExists1(RELOID, ObjectIdGetDatum(relid)))
+		return;
+
+	/*
+	 * append_range_partition() will invoke init_callback, which
+	 * is set by table's owner. Never run it as superuser.
+	 */
+	SetUserIdAndSecContext(get_rel_owner(relid),
+						   sec_context | SECURITY_LOCAL_USERID_CHANGE);
+
+	prel = get_pathman_relation_info(relid);
+	if (!prel)
+		return;
+
+	ranges = PrelGetRangesArray(prel);
+
+	/* Nothing to do if there's no room for new partitions */
+	if (prel->parttype != PT_RANGE ||
+		PrelChildrenCount(prel) == 0 ||
+		IsPlusInfinity(&ranges[PrelLastChild(prel)].max))
+	{
+		close_pathman_relation_info(prel);
+		return;
+	}
+
+	/* Remember last partitions (the last one goes first) */
+	nchildren = Min(PrelChildrenCount(prel), premake);
+	children = palloc(nchildren * sizeof(Oid));
+	for (i = 0; i < nchildren; i++)
+		children[i] = ranges[PrelLastChild(prel) - i].child_oid;
+
+	close_pathman_relation_info(prel);
+
+	/* Count empty partitions at the end of range */
+	for (i = 0; i < nchildren; i++)
+	{
+		int ret;
+
+		sql = psprintf("SELECT 1 FROM ONLY %s LIMIT 1",
+					   get_qualified_rel_name(children[i]));
+
+		ret = SPI_execute(sql, true, 1);
+		if (ret != SPI_OK_SELECT)
+			elog(ERROR, "could not scan partition %u, error code %d",
+				 children[i], ret);
+
+		if (SPI_processed > 0)
+			break;
+
+		ahead++;
+	}
+
+	if (ahead >= premake)
+		return;
+
+	sql = psprintf("SELECT %s.append_range_partition($1::regclass)",
+				   get_namespace_name(get_pathman_schema()));
+
+	for (i = ahead; i < premake; i++)
+	{
+		Oid		types[1]	= { OIDOID };
+		Datum	vals[1]		= { ObjectIdGetDatum(relid) };
+		int		ret;
+
+		ret = SPI_execute_with_args(sql, 1, types, vals, NULL, false, 0);
+		if (ret != SPI_OK_SELECT)
+			elog(ERROR, "could not append partition, error code %d", ret);
+	}
+
+	elog(LOG, "%s: created %d partitions of \"%s\" [%u]",
+		 premake_partitions_bgw, premake - ahead,
+		 get_rel_name_or_relid(relid), MyProcPid);
+}
+
+/*
+ * Premake partitions of a single table in a separate transaction.
+ */
+static void
+premake_partitions_for_parent(Oid relid)
+{
+	MemoryContext	old_mcxt;
+	Oid				save_userid;
+	int				save_sec_context;
+	bool			failed = false;
+
+	CHECK_FOR_INTERRUPTS();
+
+	/* Start new transaction (syscache access etc.) */
+	StartTransactionCommand();
+
+	/* We'll need this to recover from errors */
+	old_mcxt = CurrentMemoryContext;
+
+	if (SPI_connect() != SPI_OK_CONNECT)
+		elog(ERROR, "could not connect using SPI");
+
+	PushActiveSnapshot(GetTransactionSnapshot());
+
+	/* Remember our own identity, we're going to switch to owner */
+	GetUserIdAndSecContext(&save_userid, &save_sec_context);
+
+	PG_TRY();
+	{
+		premake_partitions_internal(relid, save_sec_context);
+	}
+	PG_CATCH();
+	{
+		ErrorData *error;
+
+		failed = true;
+
+		/* Switch to the original context & copy edata */
+		MemoryContextSwitchTo(old_mcxt);
+		error = CopyErrorData();
+		FlushErrorState();
+
+		/* Print message for this BGWorker to server log */
+		ereport(LOG,
+				(errmsg("%s: %s", premake_partitions_bgw, error->message),
+				 errdetail("relation: %u", relid)));
+
+		/* Finally, free error data */
+		FreeErrorData(error);
+	}
+	PG_END_TRY();
+
+	/* Switch back to superuser */
+	SetUserIdAndSecContext(save_userid, save_sec_context);
+
+	SPI_finish();
+	PopActiveSnapshot();
+
+	/* We'll try again on the next round */
+	if (failed)
+		AbortCurrentTransaction();
+	else
+		CommitTransactionCommand();
+}
+
+/*
+ * Check all suitable tables of the current database.
+ */
+static void
+premake_partitions_round(MemoryContext mcxt)
+{
+	Oid	   *parents = NULL;
+	int		nparents = 0,
+			i;
+
+	StartTransactionCommand();
+
+	/* Finish all delayed invalidation jobs */
+	if (IsPathmanReady())
+		finish_delayed_invalidation();
+
+	/* Load config if pg_pathman exists & it's still necessary */
+	if (IsPathmanEnabled() &&
+		!IsPathmanInitialized() &&
+		get_pathman_schema() != InvalidOid)
+	{
+		bg_worker_load_config(premake_partitions_bgw);
+	}
+
+	if (IsPathmanReady())
+		parents = premake_list_parents(mcxt, &nparents);
+
+	CommitTransactionCommand();
+
+	for (i = 0; i < nparents; i++)
+		premake_partitions_for_parent(parents[i]);
+}
+
+/*
+ * Entry point for PremakePartitionsWorker's process.
+ */
+void
+bgw_main_premake_partitions(Datum main_arg)
+{
+	int				db_idx = DatumGetInt32(main_arg);
+	char		   *dbname = NULL;
+	char		   *rawstring;
+	List		   *databases;
+	MemoryContext	premake_mcxt;
+
+	/* Establish signal handlers before unblocking signals */
+	pqsignal(SIGTERM, handle_sigterm);
+	pqsignal(SIGHUP, handle_sighup);
+
+	/* We're now ready to receive signals */
+	BackgroundWorkerUnblockSignals();
+
+	/* Create resource owner */
+	CurrentResourceOwner = ResourceOwnerCreate(NULL, premake_partitions_bgw);
+
+	/* Find out which database we should serve */
+	rawstring = pstrdup(pg_pathman_premake_databases);
+	if (SplitIdentifierString(rawstring, ',', &databases) &&
+		db_idx < list_length(databases))
+	{
+		dbname = (char *) list_nth(databases, db_idx);
+	}
+
+	if (!dbname)
+		elog(ERROR, "%s: could not find database #%d [%u]",
+			 premake_partitions_bgw, db_idx, MyProcPid);
+
+	/* Establish connection as superuser */
+	BackgroundWorkerInitializeConnectionCompat(dbname, NULL);
+
+	/* Keeps the list of tables between transactions */
+	premake_mcxt = AllocSetContextCreate(TopMemoryContext,
+										 "PremakePartitionsWorker context",
+										 ALLOCSET_DEFAULT_SIZES);
+
+	for (;;)
+	{
+		int rc;
+
+		CHECK_FOR_INTERRUPTS();
+
+		/* Reload config (premake_partitions, naptime) */
+		if (got_sighup)
+		{
+			got_sighup = false;
+			ProcessConfigFile(PGC_SIGHUP);
+		}
+
+		if (pg_pathman_premake_partitions > 0)
+		{
+			premake_partitions_round(premake_mcxt);
+			MemoryContextReset(premake_mcxt);
+		}
+
+		rc = WaitLatchCompat(MyLatch,
+							 WL_LATCH_SET | WL_TIMEOUT | WL_POSTMASTER_DEATH,
+							 pg_pathman_premake_naptime * 1000L);
+		ResetLatch(MyLatch);
+
+		/* Emergency bailout if postmaster has died */
+		if (rc & WL_POSTMASTER_DEATH)
+			proc_exit(1);
+	}
+}
@@ -12,15 +12,18 @@
 #include "compat/pg_compat.h"
 #include "compat/rowmarks_fix.h"
 
+#include "bounds_snapshot.h"
 #include "init.h"
 #include "hooks.h"
 #include "pathman.h"
 #include "partition_filter.h"
 #include "partition_router.h"
 #include "partition_overseer.h"
+#include "pathman_workers.h"
 #include "planner_tree_modification.h"
 #include "runtime_append.h"
 #include "runtime_merge_append.h"
+#include "shared_cache.h"
 
 #include "postgres.h"
 #include "access/genam.h"
@@ -48,6 +51,7 @@
 #include "utils/fmgroids.h"
 #include "utils/rel.h"
 #include "utils/lsyscache.h"
+#include "utils/memutils.h"
 #include "utils/syscache.h"
 #include "utils/selfuncs.h"
 #include "utils/typcache.h"
@@ -100,6 +104,15 @@ static Datum array_find_min_max(Datum *values,
 								bool take_min,
 								bool *result_null);
 
+static List *select_partitions_for_values(const Datum *values,
+										  const bool *isnull,
+										  int length,
+										  Oid value_type,
+										  Oid collid,
+										  const PartRelationInfo *prel);
+
+static List *irange_list_from_bitmapset(const Bitmapset *parts);
+
 
 /* Copied from PostgreSQL (allpaths.c) */
 static void set_plain_rel_size(PlannerInfo *root,
@@ -112,6 +125,8 @@ static void set_plain_rel_pathlist(PlannerInfo *root,
 
 static List *accumulate_append_subpath(List *subpaths, Path *path);
 
+static List *truncate_pathkeys_for_rel(List *pathkeys, RelOptInfo *rel);
+
 static void generate_mergeappend_paths(PlannerInfo *root,
 									   RelOptInfo *rel,
 									   List *live_childrels,
@@ -299,9 +314,6 @@ _PG_init(void)
 					"shared_preload_libraries='pg_pathman'");
 	}
 
-	/* Request additional shared resources */
-	RequestAddinShmemSpace(estimate_pathman_shmem_size());
-
 	/* Assign pg_pathman's initial state */
 	pathman_init_state.pg_pathman_enable		= DEFAULT_PATHMAN_ENABLE;
 	pathman_init_state.auto_partition			= DEFAULT_PATHMAN_AUTO;
@@ -321,15 +333,25 @@ _PG_init(void)
 	planner_hook							= pathman_planner_hook;
 	pathman_process_utility_hook_next		= ProcessUtility_hook;
 	ProcessUtility_hook						= pathman_process_utility_hook;
+#ifdef PATHMAN_PARTITIONWISE_AGGREGATE
+	pathman_create_upper_paths_hook_next	= create_upper_paths_hook;
+	create_upper_paths_hook					= pathman_create_upper_paths_hook;
+#endif
 
 	/* Initialize static data for all subsystems */
 	init_main_pathman_toggles();
 	init_relation_info_static_data();
+	init_bounds_snapshot_static_data();
 	init_runtime_append_static_data();
 	init_runtime_merge_append_static_data();
 	init_partition_filter_static_data();
 	init_partition_router_static_data();
 	init_partition_overseer_static_data();
+	init_shared_cache_static_data();
+	init_pathman_workers_static_data();
+
+	/* Request additional shared resources (some GUCs are needed) */
+	RequestAddinShmemSpace(estimate_pathman_shmem_size());
 }
 
 /* Get cached PATHMAN_CONFIG relation Oid */
@@ -691,16 +713,66 @@ append_child_relation(PlannerInfo *root,
  * -------------------------
  */
 
-/* Given 'value' and 'ranges', return selected partitions list */
+/* Find partition containing 'value' using IntRangeIndex */
+static void
+select_int_range_partition(const int64 value,
+						   const IntRangeIndex *int_ranges,
+						   WrapperNode *result) /* returned partitions */
+{
+	uint32 i = int_range_index_lower(int_ranges, value);
+
+	/* Is 'value' less than absolute MIN bound? */
+	if (cmp_int_range_bound(int_ranges, value, i, false) < 0)
+	{
+		Assert(i == 0);
+		result->rangeset = NIL;
+	}
+	/* Is 'value' inside of partition? */
+	else if (cmp_int_range_bound(int_ranges, value, i, true) < 0)
+	{
+		result->rangeset = list_make1_irange(make_irange(i, i, IR_LOSSY));
+	}
+	/* Looks like there's no partition */
+	else
+	{
+		result->rangeset = NIL;
+
+		/* It's a gap unless 'value' is beyond absolute MAX bound */
+		if (i < int_ranges->count - 1)
+			result->found_gap = true;
+	}
+}
+
+/*
+ * Given 'value' and 'ranges', return selected partitions list.
+ *
+ * If 'int_ranges' is not NULL, 'value' must be of the same type,
+ * and we don't have to call 'cmp_func' at all.
+ */
 void
 select_range_partitions(const Datum value,
 						const Oid collid,
 						FmgrInfo *cmp_func,
 						const RangeEntry *ranges,
 						const int nranges,
+						const IntRangeIndex *int_ranges,
 						const int strategy,
 						WrapperNode *result) /* returned partitions */
 {
+/* Compare 'value' to min (or max) bound of i-th partition */
+#define cmp_value_to_min(i) \
+	( \
+		int_ranges ? \
+			cmp_int_range_bound(int_ranges, int_value, (i), false) : \
+			cmp_bounds(cmp_func, collid, &value_bound, &ranges[(i)].min) \
+	)
+#define cmp_value_to_max(i) \
+	( \
+		int_ranges ? \
+			cmp_int_range_bound(int_ranges, int_value, (i), true) : \
+			cmp_bounds(cmp_func, collid, &value_bound, &ranges[(i)].max) \
+	)
+
 	bool	lossy = false,
 			miss_left,	/* 'value' is less than left bound */
 			miss_right;	/* 'value' is greater that right bound */
@@ -712,6 +784,7 @@ select_range_partitions(const Datum value,
 			i = 0;
 
 	Bound	value_bound = MakeBound(value); /* convert value to Bound */
+	int64	int_value = 0;
 
 #ifdef USE_ASSERT_CHECKING
 	int		counter = 0;
@@ -727,15 +800,29 @@ select_range_partitions(const Datum value,
 		return;
 	}
 
+	/* Fast path for integer-like types */
+	if (int_ranges)
+	{
+		Assert(int_ranges->count == nranges);
+
+		int_value = DatumGetIntRangeValue(value, int_ranges->typid);
+
+		/* This is the most popular case (INSERT, WHERE key = const) */
+		if (strategy == BTEqualStrategyNumber)
+		{
+			select_int_range_partition(int_value, int_ranges, result);
+			return;
+		}
+	}
+
 	/* Check corner cases */
-	else
 	{
 		Assert(ranges);
-		Assert(cmp_func);
+		Assert(cmp_func || int_ranges);
 
 		/* Compare 'value' to absolute MIN and MAX bounds */
-		cmp_min = cmp_bounds(cmp_func, collid, &value_bound, &ranges[startidx].min);
-		cmp_max = cmp_bounds(cmp_func, collid, &value_bound, &ranges[endidx].max);
+		cmp_min = cmp_value_to_min(startidx);
+		cmp_max = cmp_value_to_max(endidx);
 
 		if ((cmp_min <= 0 &&  strategy == BTLessStrategyNumber) ||
 			(cmp_min <  0 && (strategy == BTLessEqualStrategyNumber ||
@@ -775,16 +862,13 @@ select_range_partitions(const Datum value,
 	/* Binary search */
 	while (true)
 	{
-		Assert(ranges);
-		Assert(cmp_func);
-
 		/* Calculate new pivot */
 		i = startidx + (endidx - startidx) / 2;
 		Assert(i >= 0 && i < nranges);
 
 		/* Compare 'value' to current MIN and MAX bounds */
-		cmp_min = cmp_bounds(cmp_func, collid, &value_bound, &ranges[i].min);
-		cmp_max = cmp_bounds(cmp_func, collid, &value_bound, &ranges[i].max);
+		cmp_min = cmp_value_to_min(i);
+		cmp_max = cmp_value_to_max(i);
 
 		/* How is 'value' located with respect to left & right bounds? */
 		miss_left	= (cmp_min < 0 || (cmp_min == 0 && strategy == BTLessStrategyNumber));
@@ -885,10 +969,77 @@ select_range_partitions(const Datum value,
 			elog(ERROR, "Unknown btree strategy (%u)", strategy);
 			break;
 	}
+
+#undef cmp_value_to_min
+#undef cmp_value_to_max
 }
 
 
 
+/*
+ * ------------------------------------
+ *  Memory contexts of pruning & stats
+ * ------------------------------------
+ */
+
+/* Memory used by pruning during current planner() call */
+static struct
+{
+	uint32		nprunings;	/* number of pruning contexts */
+	uint64		used;		/* bytes allocated by pruning */
+	uint64		total;		/* bytes reserved by pruning contexts */
+} pruning_stats;
+
+/* Create a memory context for walk_expr_tree() and friends */
+MemoryContext
+pruning_mcxt_create(void)
+{
+	return AllocSetContextCreate(CurrentMemoryContext,
+								 CppAsString(walk_expr_tree),
+								 ALLOCSET_DEFAULT_SIZES);
+}
+
+/* Account memory used by pruning and release it */
+void
+pruning_mcxt_delete(MemoryContext pruning_mcxt)
+{
+/* We can't check stats of mcxt prior to 9.6 */
+#if PG_VERSION_NUM >= 90600
+	MemoryContextCounters	mcxt_stats;
+
+	memset(&mcxt_stats, 0, sizeof(mcxt_stats));
+	McxtStatsInternal(pruning_mcxt, 0, true, &mcxt_stats);
+
+	pruning_stats.used += mcxt_stats.totalspace - mcxt_stats.freespace;
+	pruning_stats.total += mcxt_stats.totalspace;
+#endif
+
+	pruning_stats.nprunings++;
+
+	MemoryContextDelete(pruning_mcxt);
+}
+
+void
+pruning_stats_reset(void)
+{
+	memset(&pruning_stats, 0, sizeof(pruning_stats));
+}
+
+void
+pruning_stats_report(void)
+{
+	if (pruning_stats.nprunings == 0)
+		return;
+
+	elog(DEBUG2, "partition pruning: %u runs, "
+				 UINT64_FORMAT " bytes allocated, "
+				 UINT64_FORMAT " bytes reserved",
+		 pruning_stats.nprunings,
+		 pruning_stats.used,
+		 pruning_stats.total);
+}
+
+
 /*
  * ---------------------------------
  *  walk_expr_tree() implementation
@@ -1104,7 +1255,9 @@ handle_const(const Const *c,
 
 		case PT_RANGE:
 			{
-				FmgrInfo cmp_finfo;
+				const IntRangeIndex	   *int_ranges = PrelGetIntRangeIndex(prel);
+				FmgrInfo				cmp_finfo;
+				Oid						value_type = getBaseType(c->consttype);
 
 				/* Cannot do much about non-equal strategies + diff. collations */
 				if (strategy != BTEqualStrategyNumber && collid != prel->ev_collid)
@@ -1112,15 +1265,21 @@ handle_const(const Const *c,
 					goto handle_const_return;
 				}
 
-				fill_type_cmp_fmgr_info(&cmp_finfo,
-										getBaseType(c->consttype),
-										getBaseType(prel->ev_type));
+				/* Use dense bounds only if value is of the same type */
+				if (int_ranges && int_ranges->typid != value_type)
+					int_ranges = NULL;
+
+				if (!int_ranges)
+					fill_type_cmp_fmgr_info(&cmp_finfo,
+											value_type,
+											getBaseType(prel->ev_type));
 
 				select_range_partitions(c->constvalue,
 										collid,
-										&cmp_finfo,
+										int_ranges ? NULL : &cmp_finfo,
 										PrelGetRangesArray(context->prel),
 										PrelChildrenCount(context->prel),
+										int_ranges,
 										strategy,
 										result); /* result->rangeset = ... */
 				result->paramsel = 1.0;
@@ -1137,6 +1296,173 @@ handle_const_return:
 	result->paramsel = 1.0;
 }
 
+/*
+ * Select partitions which may contain any of 'values' (key = ANY (...)).
+ * Partitions are marked in a bitmap, so duplicates cost nothing and the
+ * resulting rangeset is built in a single pass over it.
+ */
+static List *
+select_partitions_for_values(const Datum *values,
+							 const bool *isnull,
+							 int length,
+							 Oid value_type,
+							 Oid collid,
+							 const PartRelationInfo *prel)
+{
+	Bitmapset  *parts = NULL;
+	uint32		nparts = PrelChildrenCount(prel),
+				nselected = 0;
+	Oid			base_value_type = getBaseType(value_type),
+				base_ev_type = getBaseType(prel->ev_type);
+	List	   *result;
+	int			i;
+
+	switch (prel->parttype)
+	{
+		case PT_HASH:
+			for (i = 0; i < length && nselected < nparts; i++)
+			{
+				Datum	value,
+						hash;
+				uint32	idx;
+
+				/* NULL never matches anything */
+				if (isnull[i])
+					continue;
+
+				/* Peform type cast if types mismatch */
+				if (prel->ev_type != value_type)
+				{
+					bool cast_success;
+
+					value = perform_type_cast(values[i],
+											  base_value_type,
+											  base_ev_type,
+											  &cast_success);
+
+					if (!cast_success)
+						elog(ERROR, "Cannot select partition: "
+									"unable to perform type cast");
+				}
+				else value = values[i];
+
+				/* See handle_const() */
+				hash = OidFunctionCall1Coll(prel->hash_proc,
+											DEFAULT_COLLATION_OID,
+											value);
+				idx = hash_to_part_index(DatumGetInt32(hash), nparts);
+
+				if (!bms_is_member(idx, parts))
+				{
+					parts = bms_add_member(parts, idx);
+					nselected++;
+				}
+			}
+			break;
+
+		case PT_RANGE:
+			{
+				const IntRangeIndex	   *int_ranges = PrelGetIntRangeIndex(prel);
+				const RangeEntry	   *ranges = PrelGetRangesArray(prel);
+				FmgrInfo				cmp_finfo;
+
+				/* Use dense bounds only if value is of the same type */
+				if (int_ranges && int_ranges->typid != base_value_type)
+					int_ranges = NULL;
+
+				if (!int_ranges)
+					fill_type_cmp_fmgr_info(&cmp_finfo,
+											base_value_type,
+											base_ev_type);
+
+				for (i = 0; i < length && nselected < nparts; i++)
+				{
+					int idx = -1;
+
+					/* NULL never matches anything */
+					if (isnull[i])
+						continue;
+
+					if (int_ranges)
+					{
+						idx = int_range_index_find(int_ranges,
+												   DatumGetIntRangeValue(values[i],
+																		 base_value_type));
+					}
+					else
+					{
+						Bound	value_bound = MakeBound(values[i]);
+						int		lower = 0,
+								upper = (int) nparts - 1;
+
+						/* Binary search for partition containing value */
+						while (lower <= upper)
+						{
+							int j = lower + (upper - lower) / 2;
+
+							if (cmp_bounds(&cmp_finfo, collid,
+										   &value_bound, &ranges[j].min) < 0)
+								upper = j - 1;
+							else if (cmp_bounds(&cmp_finfo, collid,
+												&value_bound, &ranges[j].max) >= 0)
+								lower = j + 1;
+							else
+							{
+								idx = j;
+								break;
+							}
+						}
+					}
+
+					if (idx >= 0 && !bms_is_member(idx, parts))
+					{
+						parts = bms_add_member(parts, idx);
+						nselected++;
+					}
+				}
+			}
+			break;
+
+		default:
+			WrongPartType(prel->parttype);
+	}
+
+	result = irange_list_from_bitmapset(parts);
+	bms_free(parts);
+
+	return result;
+}
+
+/* Convert set of partition indices into a list of lossy IndexRanges */
+static List *
+irange_list_from_bitmapset(const Bitmapset *parts)
+{
+	List   *result = NIL;
+	int		lower = -1,
+			upper = -1,
+			i = -1;
+
+	while ((i = bms_next_member(parts, i)) >= 0)
+	{
+		/* Extend current range if possible */
+		if (lower >= 0 && i == upper + 1)
+		{
+			upper = i;
+			continue;
+		}
+
+		if (lower >= 0)
+			result = lappend_irange(result, make_irange(lower, upper, IR_LOSSY));
+
+		lower = upper = i;
+	}
+
+	if (lower >= 0)
+		result = lappend_irange(result, make_irange(lower, upper, IR_LOSSY));
+
+	return result;
+}
+
 /* Array handler */
 static void
 handle_array(ArrayType *array,
@@ -1239,6 +1565,28 @@ handle_array(ArrayType *array,
 			}
 		}
 
+		/*
+		 * IN (...) and = ANY (...) may contain thousands of values,
+		 * so we'd better not unite rangesets for each of them.
+		 */
+		if (strategy == BTEqualStrategyNumber && use_or &&
+			elem_type != BOOLOID)
+		{
+			result->rangeset = select_partitions_for_values(elem_values,
+															elem_isnull,
+															elem_count,
+															elem_type,
+															collid,
+															prel);
+			result->paramsel = 1.0;
+
+			/* Free resources */
+			pfree(elem_values);
+			pfree(elem_isnull);
+
+			return; /* done, exit */
+		}
+
 		/* Set default rangeset */
 		ranges = use_or ? NIL : list_make1_irange_full(prel, IR_COMPLETE);
 
@@ -1290,8 +1638,11 @@ handle_boolexpr(const BoolExpr *expr,
 				WrapperNode *result)	/* ret value #1 */
 {
 	const PartRelationInfo *prel = context->prel;
+	uint32					nparts = PrelChildrenCount(prel);
 	List				   *ranges,
 						   *args = NIL;
+	IndexRangeBitmap	   *bitmap = NULL,
+						   *arg_bitmap = NULL;
 	double					paramsel = 1.0;
 	ListCell			   *lc;
 
@@ -1308,14 +1659,33 @@ handle_boolexpr(const BoolExpr *expr,
 		wrap = walk_expr_tree((Expr *) lfirst(lc), context);
 		args = lappend(args, wrap);
 
+		/* Switch to bitmaps once rangesets become too fragmented */
+		if (!bitmap && expr->boolop != NOT_EXPR &&
+			(irange_list_prefer_bitmap(ranges, nparts) ||
+			 irange_list_prefer_bitmap(wrap->rangeset, nparts)))
+		{
+			bitmap = irange_bitmap_from_list(ranges, nparts);
+			arg_bitmap = irange_bitmap_create(nparts);
+		}
+
 		switch (expr->boolop)
 		{
 			case OR_EXPR:
-				ranges = irange_list_union(ranges, wrap->rangeset);
+				if (bitmap)
+				{
+					irange_bitmap_fill(arg_bitmap, wrap->rangeset);
+					irange_bitmap_union(bitmap, arg_bitmap);
+				}
+				else ranges = irange_list_union(ranges, wrap->rangeset);
 				break;
 
 			case AND_EXPR:
-				ranges = irange_list_intersection(ranges, wrap->rangeset);
+				if (bitmap)
+				{
+					irange_bitmap_fill(arg_bitmap, wrap->rangeset);
+					irange_bitmap_intersection(bitmap, arg_bitmap);
+				}
+				else ranges = irange_list_intersection(ranges, wrap->rangeset);
 				paramsel *= wrap->paramsel;
 				break;
 
@@ -1325,6 +1695,15 @@ handle_boolexpr(const BoolExpr *expr,
 		}
 	}
 
+	/* Convert bitmap back to rangeset */
+	if (bitmap)
+	{
+		ranges = irange_bitmap_to_list(bitmap);
+
+		pfree(bitmap);
+		pfree(arg_bitmap);
+	}
+
 	/* Adjust paramsel for OR */
 	if (expr->boolop == OR_EXPR)
 	{
@@ -1676,6 +2055,50 @@ accumulate_append_subpath(List *subpaths, Path *path)
 }
 
 
+/*
+ * Get the longest prefix of 'pathkeys' which can be
+ * computed using only the columns of relation 'rel'.
+ */
+static List *
+truncate_pathkeys_for_rel(List *pathkeys, RelOptInfo *rel)
+{
+	List	   *result = NIL;
+	ListCell   *lc;
+
+	foreach(lc, pathkeys)
+	{
+		PathKey			   *pathkey = (PathKey *) lfirst(lc);
+		EquivalenceClass   *ec = pathkey->pk_eclass;
+		bool				found = false;
+		ListCell		   *lcm;
+
+		if (ec->ec_has_volatile)
+			break;
+
+		foreach(lcm, ec->ec_members)
+		{
+			EquivalenceMember *em = (EquivalenceMember *) lfirst(lcm);
+
+			if (!em->em_is_child &&
+				!bms_is_empty(em->em_relids) &&
+				bms_is_subset(em->em_relids, rel->relids))
+			{
+				found = true;
+				break;
+			}
+		}
+
+		/* Next keys are useless if this one can't be computed */
+		if (!found)
+			break;
+
+		result = lappend(result, pathkey);
+	}
+
+	return result;
+}
+
+
 /*
  * generate_mergeappend_paths
  *		Generate MergeAppend paths for an append relation
@@ -1705,8 +2128,48 @@ generate_mergeappend_paths(PlannerInfo *root, RelOptInfo *rel,
 						   List *all_child_pathkeys,
 						   PathKey *pathkeyAsc, PathKey *pathkeyDesc)
 {
+	List	   *query_pathkeys = NIL;
+	bool		sort_children = false;
 	ListCell   *lcp;
 
+#if PG_VERSION_NUM >= 90600
+	/*
+	 * Sorting children separately pays off only if we're not going to
+	 * fetch all rows (e.g. LIMIT). Since Append scans children one by one,
+	 * only partitions actually reached will be sorted.
+	 */
+	sort_children = (root->tuple_fraction > 0.0);
+#endif
+
+	/*
+	 * RANGE partitions don't overlap, so an Append of children sorted by
+	 * partitioning expression yields sorted output as well. Consider
+	 * the ordering required by query even if no child provides it.
+	 */
+	if (sort_children)
+		query_pathkeys = truncate_pathkeys_for_rel(root->query_pathkeys, rel);
+
+	if (query_pathkeys != NIL &&
+		((PathKey *) linitial(query_pathkeys) == pathkeyAsc ||
+		 (PathKey *) linitial(query_pathkeys) == pathkeyDesc))
+	{
+		bool found = false;
+
+		/* Have we already seen this ordering? */
+		foreach(lcp, all_child_pathkeys)
+		{
+			if (compare_pathkeys((List *) lfirst(lcp),
+								 query_pathkeys) == PATHKEYS_EQUAL)
+			{
+				found = true;
+				break;
+			}
+		}
+
+		if (!found)
+			all_child_pathkeys = lappend(all_child_pathkeys, query_pathkeys);
+	}
+
 	foreach(lcp, all_child_pathkeys)
 	{
 		List	   *pathkeys = (List *) lfirst(lcp);
@@ -1714,8 +2177,13 @@ generate_mergeappend_paths(PlannerInfo *root, RelOptInfo *rel,
 		List	   *total_subpaths = NIL;
 		bool		startup_neq_total = false;
 		bool		presorted = true;
+		bool		ordered_append;
 		ListCell   *lcr;
 
+		/* Can we simply concatenate children in order of partitions? */
+		ordered_append = ((PathKey *) linitial(pathkeys) == pathkeyAsc ||
+						  (PathKey *) linitial(pathkeys) == pathkeyDesc);
+
 		/* Select the child paths for this ordering... */
 		foreach(lcr, live_childrels)
 		{
@@ -1747,7 +2215,17 @@ generate_mergeappend_paths(PlannerInfo *root, RelOptInfo *rel,
 					childrel->cheapest_total_path;
 				/* Assert we do have an unparameterized path for this child */
 				Assert(cheapest_total->param_info == NULL);
-				presorted = false;
+
+#if PG_VERSION_NUM >= 90600
+				/* Sort this child on its own (see above) */
+				if (ordered_append && sort_children)
+					cheapest_startup = cheapest_total =
+						(Path *) create_sort_path(root, childrel,
+												  childrel->cheapest_total_path,
+												  pathkeys, -1.0);
+				else
+#endif
+					presorted = false;
 			}
 
 			/*
@@ -1769,7 +2247,8 @@ generate_mergeappend_paths(PlannerInfo *root, RelOptInfo *rel,
 		 * column then build path with Append node, because MergeAppend is not
 		 * required in this case.
 		 */
-		if ((PathKey *) linitial(pathkeys) == pathkeyAsc && presorted)
+		if (ordered_append && presorted &&
+			(PathKey *) linitial(pathkeys) == pathkeyAsc)
 		{
 			Path *path;
 
@@ -1786,7 +2265,8 @@ generate_mergeappend_paths(PlannerInfo *root, RelOptInfo *rel,
 				add_path(rel, path);
 			}
 		}
-		else if ((PathKey *) linitial(pathkeys) == pathkeyDesc && presorted)
+		else if (ordered_append && presorted &&
+				 (PathKey *) linitial(pathkeys) == pathkeyDesc)
 		{
 			/*
 			 * When pathkey is descending sort by partition column then we
@@ -10,6 +10,7 @@
 
 #include "compat/pg_compat.h"
 
+#include "bounds_snapshot.h"
 #include "init.h"
 #include "pathman.h"
 #include "partition_creation.h"
@@ -967,6 +968,11 @@ pathman_config_params_trigger_func(PG_FUNCTION_ARGS)
 
 	partrel = DatumGetObjectId(partrel_datum);
 
+	/* Relation is no longer partitioned (or it has been dropped) */
+	if (RelationGetRelid(trigdata->tg_relation) == pathman_config &&
+		TRIGGER_FIRED_BY_DELETE(trigdata->tg_event))
+		remove_bounds_snapshot(partrel);
+
 	/* Finally trigger pg_pathman's cache invalidation event */
 	if (SearchSysCacheExists1(RELOID, ObjectIdGetDatum(partrel)))
 		CacheInvalidateRelcacheByRelid(partrel);
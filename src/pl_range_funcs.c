@@ -193,6 +193,7 @@ create_range_partitions_internal(PG_FUNCTION_ARGS)
 	Datum		   *datums;
 	bool		   *nulls;
 	int				ndatums;
+	Bound		   *range_bounds;
 	int				i;
 
 	/* Extract parent's Oid */
@@ -264,29 +265,27 @@ create_range_partitions_internal(PG_FUNCTION_ARGS)
 							errmsg("'bounds' array must be ascending")));
 	}
 
-	/* Create partitions using provided bounds */
-	for (i = 0; i < ndatums - 1; i++)
+	/* Convert datums to bounds */
+	range_bounds = palloc(ndatums * sizeof(Bound));
+	for (i = 0; i < ndatums; i++)
 	{
-		Bound		start	= nulls[i] ?
+		range_bounds[i] = nulls[i] ?
+							(i == 0 ?
 								MakeBoundInf(MINUS_INFINITY) :
-								MakeBound(datums[i]),
-
-					end		= nulls[i + 1] ?
-								MakeBoundInf(PLUS_INFINITY) :
-								MakeBound(datums[i + 1]);
-
-		RangeVar   *name	= rangevars ? rangevars[i] : NULL;
-
-		char	   *tablespace = tablespaces ? tablespaces[i] : NULL;
-
-		(void) create_single_range_partition_internal(parent_relid,
-													  &start,
-													  &end,
-													  bounds_type,
-													  name,
-													  tablespace);
+								MakeBoundInf(PLUS_INFINITY)) :
+							MakeBound(datums[i]);
 	}
 
+	/* Create partitions using provided bounds */
+	if (ndatums > 1)
+		create_range_partitions_bulk(parent_relid,
+									 range_bounds,
+									 ndatums - 1,
+									 bounds_type,
+									 rangevars,
+									 tablespaces,
+									 NULL);
+
 	/* Return number of partitions */
 	PG_RETURN_INT32(ndatums - 1);
 }
@@ -958,6 +958,14 @@ find_deepest_partition(Oid relid, Index rti, Expr *quals)
 		WalkerContext	context;
 		List		   *ranges;
 		WrapperNode	   *wrap;
+		MemoryContext	pruning_mcxt,
+						old_mcxt;
+		int				nselected;
+		uint32			first_selected = 0;
+
+		/* We only need the number of selected partitions */
+		pruning_mcxt = pruning_mcxt_create();
+		old_mcxt = MemoryContextSwitchTo(pruning_mcxt);
 
 		/* Prepare partitioning expression */
 		prel_expr = PrelExpressionForRelid(prel, rti);
@@ -970,7 +978,14 @@ find_deepest_partition(Oid relid, Index rti, Expr *quals)
 		wrap = walk_expr_tree(quals, &context);
 		ranges = irange_list_intersection(ranges, wrap->rangeset);
 
-		switch (irange_list_length(ranges))
+		nselected = irange_list_length(ranges);
+		if (nselected == 1)
+			first_selected = irange_lower(linitial_irange(ranges));
+
+		MemoryContextSwitchTo(old_mcxt);
+		pruning_mcxt_delete(pruning_mcxt);
+
+		switch (nselected)
 		{
 			/* Scan only parent (don't do constraint elimination) */
 			case 0:
@@ -981,9 +996,8 @@ find_deepest_partition(Oid relid, Index rti, Expr *quals)
 			case 1:
 				if (!prel->enable_parent)
 				{
-					IndexRange	irange = linitial_irange(ranges);
 					Oid		   *children = PrelGetChildrenArray(prel),
-								child = children[irange_lower(irange)];
+								child = children[first_selected];
 
 					/* Scan this partition */
 					result = child;
@@ -410,3 +410,182 @@ irange_list_find(List *rangeset, int index, bool *lossy)
 
 	return false;
 }
+
+
+/*
+ * --------------------------
+ *  IndexRangeBitmap support
+ * --------------------------
+ */
+
+#define irbm_word(bit)		( (bit) / IRANGE_BITMAP_WORD_BITS )
+#define irbm_offset(bit)	( (bit) % IRANGE_BITMAP_WORD_BITS )
+#define irbm_test(words, bit) \
+	( ((words)[irbm_word(bit)] >> irbm_offset(bit)) & 1 )
+
+/* Set bits [lower; upper] of a bitset */
+static void
+irbm_set_range(uint64 *words, uint32 lower, uint32 upper)
+{
+	uint32	lw = irbm_word(lower),
+			uw = irbm_word(upper);
+	uint64	lmask = ~UINT64CONST(0) << irbm_offset(lower),
+			umask = ~UINT64CONST(0) >> (IRANGE_BITMAP_WORD_BITS - 1 -
+										irbm_offset(upper));
+	uint32	i;
+
+	if (lw == uw)
+	{
+		words[lw] |= (lmask & umask);
+		return;
+	}
+
+	words[lw] |= lmask;
+	for (i = lw + 1; i < uw; i++)
+		words[i] = ~UINT64CONST(0);
+	words[uw] |= umask;
+}
+
+/* Create an empty bitmap for 'nbits' partitions */
+IndexRangeBitmap *
+irange_bitmap_create(uint32 nbits)
+{
+	IndexRangeBitmap   *result;
+	uint32				nwords = irange_bitmap_nwords(nbits);
+	Size				words_size = sizeof(uint64) * Max(nwords, 1);
+
+	/* Allocate header and both bitsets in one chunk */
+	result = (IndexRangeBitmap *) palloc(MAXALIGN(sizeof(IndexRangeBitmap)) +
+										 2 * words_size);
+
+	result->nbits		= nbits;
+	result->nwords		= nwords;
+	result->selected	= (uint64 *) ((char *) result +
+									  MAXALIGN(sizeof(IndexRangeBitmap)));
+	result->lossy		= result->selected + Max(nwords, 1);
+
+	memset(result->selected, 0, 2 * words_size);
+
+	return result;
+}
+
+/* Build a bitmap out of a rangeset */
+IndexRangeBitmap *
+irange_bitmap_from_list(List *rangeset, uint32 nbits)
+{
+	IndexRangeBitmap *result = irange_bitmap_create(nbits);
+
+	irange_bitmap_fill(result, rangeset);
+
+	return result;
+}
+
+/* Replace contents of a bitmap with a rangeset */
+void
+irange_bitmap_fill(IndexRangeBitmap *bitmap, List *rangeset)
+{
+	ListCell *lc;
+
+	memset(bitmap->selected, 0, sizeof(uint64) * bitmap->nwords);
+	memset(bitmap->lossy, 0, sizeof(uint64) * bitmap->nwords);
+
+	foreach (lc, rangeset)
+	{
+		IndexRange irange = lfirst_irange(lc);
+
+		Assert(is_irange_valid(irange));
+		Assert(irange_upper(irange) < bitmap->nbits);
+
+		irbm_set_range(bitmap->selected,
+					   irange_lower(irange),
+					   irange_upper(irange));
+
+		if (is_irange_lossy(irange))
+			irbm_set_range(bitmap->lossy,
+						   irange_lower(irange),
+						   irange_upper(irange));
+	}
+}
+
+/*
+ * Unite two bitmaps (result is stored in 'a').
+ *
+ * Same as irange_list_union(): a partition stays lossy
+ * only if no operand contains it as a complete one.
+ */
+void
+irange_bitmap_union(IndexRangeBitmap *a, const IndexRangeBitmap *b)
+{
+	uint32 i;
+
+	Assert(a->nbits == b->nbits);
+
+	for (i = 0; i < a->nwords; i++)
+	{
+		uint64	complete = (a->selected[i] & ~a->lossy[i]) |
+						   (b->selected[i] & ~b->lossy[i]);
+
+		a->selected[i] |= b->selected[i];
+		a->lossy[i] = a->selected[i] & ~complete;
+	}
+}
+
+/*
+ * Intersect two bitmaps (result is stored in 'a').
+ *
+ * Same as irange_list_intersection(): a partition
+ * is lossy if any operand contains it as a lossy one.
+ */
+void
+irange_bitmap_intersection(IndexRangeBitmap *a, const IndexRangeBitmap *b)
+{
+	uint32 i;
+
+	Assert(a->nbits == b->nbits);
+
+	for (i = 0; i < a->nwords; i++)
+	{
+		a->selected[i] &= b->selected[i];
+		a->lossy[i] = a->selected[i] & (a->lossy[i] | b->lossy[i]);
+	}
+}
+
+/* Convert bitmap back to a (normalized) rangeset */
+List *
+irange_bitmap_to_list(const IndexRangeBitmap *bitmap)
+{
+	List   *result = NIL;
+	uint32	i = 0;
+
+	while (i < bitmap->nbits)
+	{
+		uint32	lower;
+		bool	lossy;
+
+		/* Skip the rest of an empty word */
+		if ((bitmap->selected[irbm_word(i)] >> irbm_offset(i)) == 0)
+		{
+			i = (irbm_word(i) + 1) * IRANGE_BITMAP_WORD_BITS;
+			continue;
+		}
+
+		if (!irbm_test(bitmap->selected, i))
+		{
+			i++;
+			continue;
+		}
+
+		/* Extend this IndexRange as long as lossiness is the same */
+		lower = i;
+		lossy = irbm_test(bitmap->lossy, i);
+		while (i + 1 < bitmap->nbits &&
+			   irbm_test(bitmap->selected, i + 1) &&
+			   irbm_test(bitmap->lossy, i + 1) == lossy)
+			i++;
+
+		result = lappend_irange(result, make_irange(lower, i, lossy));
+		i++;
+	}
+
+	return result;
+}
@@ -10,8 +10,10 @@
 
 #include "compat/pg_compat.h"
 
+#include "bounds_snapshot.h"
 #include "relation_info.h"
 #include "init.h"
+#include "shared_cache.h"
 #include "utils.h"
 #include "xact_handling.h"
 
@@ -142,6 +144,10 @@ static bool		delayed_shutdown = false; /* pathman was dropped */
 HTAB	   *prel_resowner = NULL;
 
 
+/* Max number of partitions to be added by incremental update */
+#define INCREMENTAL_UPDATE_MAX_PARTS	64
+
+
 /* Handy wrappers for Oids */
 #define bsearch_oid(key, array, array_size) \
 	bsearch((const void *) &(key), (array), (array_size), sizeof(Oid), oid_cmp)
@@ -152,6 +158,11 @@ static void free_pathman_relation_info(PartRelationInfo *prel);
 static void invalidate_psin_entries_using_relid(Oid relid);
 static void invalidate_psin_entry(PartStatusInfo *psin);
 
+static void retire_pathman_relation_info(PartRelationInfo *prel);
+static void forget_retired_prel(Oid relid);
+static void forget_dropped_retired_prels(void);
+static void touch_retired_prels(Oid parent_relid, Oid partition);
+
 static PartRelationInfo *resowner_prel_add(PartRelationInfo *prel);
 static PartRelationInfo *resowner_prel_del(PartRelationInfo *prel);
 static void resonwner_prel_callback(ResourceReleasePhase phase,
@@ -169,6 +180,12 @@ static void fill_pbin_with_bounds(PartBoundInfo *pbin,
 
 static int cmp_range_entries(const void *p1, const void *p2, void *arg);
 
+static bool fill_prel_incrementally(PartRelationInfo *prel,
+									const Oid *partitions,
+									const uint32 parts_count);
+
+static void fill_prel_with_int_ranges(PartRelationInfo *prel);
+
 static void forget_bounds_of_partition(Oid partition);
 
 static bool query_contains_subqueries(Node *node, void *context);
@@ -227,9 +244,16 @@ forget_status_of_relation(Oid relid)
 										  NULL);
 		if (psin)
 			invalidate_psin_entry(psin);
+
+		/* Bounds of this partition might have changed */
+		touch_retired_prels(ppar->parent_relid, relid);
 	}
 	/* Otherwise, look through all entries */
-	else invalidate_psin_entries_using_relid(relid);
+	else
+	{
+		invalidate_psin_entries_using_relid(relid);
+		touch_retired_prels(InvalidOid, relid);
+	}
 }
 
 /* Invalidate all PartStatusInfo entries */
@@ -237,6 +261,9 @@ void
 invalidate_status_cache(void)
 {
 	invalidate_psin_entries_using_relid(InvalidOid);
+
+	/* We don't know what has changed, so don't use retired entries */
+	forget_retired_prel(InvalidOid);
 }
 
 /* Invalidate PartStatusInfo entry referencing 'relid' */
@@ -278,7 +305,12 @@ invalidate_psin_entry(PartStatusInfo *psin)
 
 	if (psin->prel)
 	{
-		if (PrelReferenceCount(psin->prel) > 0)
+		if (psin->prel->parttype == PT_RANGE)
+		{
+			/* Keep it for incremental update */
+			retire_pathman_relation_info(psin->prel);
+		}
+		else if (PrelReferenceCount(psin->prel) > 0)
 		{
 			/* Mark entry as outdated and detach it */
 			PrelIsFresh(psin->prel) = false;
@@ -296,6 +328,129 @@ invalidate_psin_entry(PartStatusInfo *psin)
 }
 
 
+/*
+ * Retired dispatch cache routines.
+ */
+
+/* Detach outdated PartRelationInfo and save it for incremental update */
+static void
+retire_pathman_relation_info(PartRelationInfo *prel)
+{
+	PartRetiredInfo *pret;
+
+	/* Remove previous entry (if any) */
+	forget_retired_prel(PrelParentRelid(prel));
+
+	pret = pathman_cache_search_relid(retired_cache,
+									  PrelParentRelid(prel),
+									  HASH_ENTER,
+									  NULL);
+
+	/* Mark entry as outdated and detach it */
+	PrelIsFresh(prel) = false;
+
+	/* This reference belongs to retired cache */
+	PrelReferenceCount(prel) += 1;
+
+	pret->prel = prel;
+	pret->ntouched = 0;
+}
+
+/* Release reference to PartRelationInfo and remove PartRetiredInfo */
+static void
+drop_retired_entry(PartRetiredInfo *pret)
+{
+	PartRelationInfo *prel = pret->prel;
+
+	PrelReferenceCount(prel) -= 1;
+
+	/* Free this entry if it's time */
+	if (PrelReferenceCount(prel) == 0)
+		free_pathman_relation_info(prel);
+
+	(void) pathman_cache_search_relid(retired_cache,
+									  pret->relid,
+									  HASH_REMOVE,
+									  NULL);
+}
+
+/* Remove PartRetiredInfo for 'relid' (or all of them if it's invalid) */
+static void
+forget_retired_prel(Oid relid)
+{
+	PartRetiredInfo *pret;
+
+	if (OidIsValid(relid))
+	{
+		pret = pathman_cache_search_relid(retired_cache,
+										  relid, HASH_FIND,
+										  NULL);
+		if (pret)
+			drop_retired_entry(pret);
+	}
+	else
+	{
+		HASH_SEQ_STATUS status;
+
+		hash_seq_init(&status, retired_cache);
+
+		while ((pret = (PartRetiredInfo *) hash_seq_search(&status)) != NULL)
+			drop_retired_entry(pret);
+	}
+}
+
+/*
+ * Remove PartRetiredInfo entries of parents which have been dropped.
+ *
+ * Invalidation callbacks can't tell a dropped parent from an altered one,
+ * and nobody is going to ask for a dropped parent again, so we have to
+ * check for such entries once catalog access is possible.
+ */
+static void
+forget_dropped_retired_prels(void)
+{
+	HASH_SEQ_STATUS		status;
+	PartRetiredInfo	   *pret;
+
+	/* Fast path */
+	if (hash_get_num_entries(retired_cache) == 0)
+		return;
+
+	hash_seq_init(&status, retired_cache);
+
+	while ((pret = (PartRetiredInfo *) hash_seq_search(&status)) != NULL)
+	{
+		if (!SearchSysCacheExists1(RELOID, ObjectIdGetDatum(pret->relid)))
+			drop_retired_entry(pret);
+	}
+}
+
+/* Remember that bounds of 'partition' might have changed */
+static void
+touch_retired_prels(Oid parent_relid, Oid partition)
+{
+	HASH_SEQ_STATUS		status;
+	PartRetiredInfo	   *pret;
+
+	hash_seq_init(&status, retired_cache);
+
+	while ((pret = (PartRetiredInfo *) hash_seq_search(&status)) != NULL)
+	{
+		/* We might not know the parent of this partition */
+		if (OidIsValid(parent_relid) ?
+				pret->relid != parent_relid :
+				!PrelHasPartition(pret->prel, partition))
+			continue;
+
+		if (pret->ntouched < RETIRED_PREL_MAX_TOUCHED)
+			pret->touched[pret->ntouched++] = partition;
+
+		/* Too many changes, full rebuild is cheaper */
+		else drop_retired_entry(pret);
+	}
+}
+
+
 /*
  * Dispatch cache routines.
  */
@@ -354,6 +509,9 @@ get_pathman_relation_info(Oid relid)
 		bool				isnull[Natts_pathman_config];
 		bool				found;
 
+		/* Something has been invalidated, maybe some parents were dropped */
+		forget_dropped_retired_prels();
+
 		/*
 		 * Check if PATHMAN_CONFIG table contains this relation and
 		 * build a partitioned table cache entry (might emit ERROR).
@@ -361,6 +519,9 @@ get_pathman_relation_info(Oid relid)
 		if (pathman_config_contains_relation(relid, values, isnull, NULL, &iptr))
 			prel = build_pathman_relation_info(relid, values);
 
+		/* Relation is not partitioned anymore, drop retired entry */
+		else forget_retired_prel(relid);
+
 		/* Create a new entry for this relation */
 		psin = pathman_cache_search_relid(status_cache,
 										  relid, HASH_ENTER,
@@ -401,6 +562,7 @@ build_pathman_relation_info(Oid relid, Datum *values)
 	{
 		/* Nope, it doesn't, remove this entry and exit */
 		UnlockRelationOid(relid, lockmode);
+		forget_retired_prel(relid);
 		return NULL; /* exit */
 	}
 
@@ -423,13 +585,15 @@ build_pathman_relation_info(Oid relid, Datum *values)
 		const TypeCacheEntry   *typcache;
 		Datum					param_values[Natts_pathman_config_params];
 		bool					param_isnull[Natts_pathman_config_params];
-		Oid					   *prel_children;
+		SharedCacheTicket		ticket;
+		Oid					   *prel_children = NULL;
 		uint32					prel_children_count = 0,
 								i;
 
-		/* Make both arrays point to NULL */
-		prel->children	= NULL;
-		prel->ranges	= NULL;
+		/* Make all arrays point to NULL */
+		prel->children		= NULL;
+		prel->ranges		= NULL;
+		prel->int_ranges	= NULL;
 
 		/* Set partitioning type */
 		prel->parttype	= DatumGetPartType(values[Anum_pathman_config_parttype - 1]);
@@ -466,29 +630,52 @@ build_pathman_relation_info(Oid relid, Datum *values)
 		prel->cmp_proc	= typcache->cmp_proc;
 		prel->hash_proc	= typcache->hash_proc;
 
-		/* Try searching for children */
-		(void) find_inheritance_children_array(relid, lockmode, false,
-											   &prel_children_count,
-											   &prel_children);
+		/* Maybe some other backend has already collected partitions */
+		if (shared_cache_lookup(prel, &ticket))
+		{
+			/* Unlock the parent */
+			UnlockRelationOid(relid, lockmode);
 
-		/* Fill 'prel' with partition info, raise ERROR if anything is wrong */
-		fill_prel_with_partitions(prel, prel_children, prel_children_count);
+			/* Cache children (they aren't locked) */
+			for (i = 0; i < PrelChildrenCount(prel); i++)
+				cache_parent_of_partition(prel->children[i], relid);
+		}
+		else
+		{
+			/* Try searching for children */
+			(void) find_inheritance_children_array(relid, lockmode, false,
+												   &prel_children_count,
+												   &prel_children);
 
-		/* Unlock the parent */
-		UnlockRelationOid(relid, lockmode);
+			/* Fill 'prel' with partition info, raise ERROR if anything is wrong */
+			if (!fill_prel_incrementally(prel, prel_children, prel_children_count))
+				fill_prel_with_partitions(prel, prel_children, prel_children_count);
 
-		/* Now it's time to take care of children */
-		for (i = 0; i < prel_children_count; i++)
-		{
-			/* Cache this child */
-			cache_parent_of_partition(prel_children[i], relid);
+			/* Share partitions with other backends */
+			shared_cache_publish(prel, &ticket);
+
+			/* Unlock the parent */
+			UnlockRelationOid(relid, lockmode);
 
-			/* Unlock this child */
-			UnlockRelationOid(prel_children[i], lockmode);
+			/* Now it's time to take care of children */
+			for (i = 0; i < prel_children_count; i++)
+			{
+				/* Cache this child */
+				cache_parent_of_partition(prel_children[i], relid);
+
+				/* Unlock this child */
+				UnlockRelationOid(prel_children[i], lockmode);
+			}
+
+			if (prel_children)
+				pfree(prel_children);
 		}
 
-		if (prel_children)
-			pfree(prel_children);
+		/* Outdated entry is no longer needed */
+		forget_retired_prel(relid);
+
+		/* Build fast lookup structure for integer-like bounds */
+		fill_prel_with_int_ranges(prel);
 
 		/* Read additional parameters ('enable_parent' at the moment) */
 		if (read_pathman_params(relid, param_values, param_isnull))
@@ -516,6 +703,9 @@ build_pathman_relation_info(Oid relid, Datum *values)
 			 */
 			PG_RE_THROW();
 
+		/* Don't try incremental update next time */
+		forget_retired_prel(relid);
+
 		if (prel->children != NULL)
 		{
 			uint32 i;
@@ -738,6 +928,10 @@ fill_prel_with_partitions(PartRelationInfo *prel,
 	uint32			i;
 	MemoryContext	temp_mcxt,	/* reference temporary mcxt */
 					old_mcxt;	/* reference current mcxt */
+	const BoundsSnapshot *snapshot = NULL;
+	BoundsSnapshotEntry *snapshot_entries = NULL;
+	BoundsSnapshotStamp	snapshot_stamp;
+	bool			snapshot_outdated = false;
 
 	AssertTemporaryContext();
 
@@ -748,6 +942,18 @@ fill_prel_with_partitions(PartRelationInfo *prel,
 	/* Set number of children */
 	PrelChildrenCount(prel) = parts_count;
 
+	/* Load bounds saved by some other backend (maybe before restart) */
+	if (pg_pathman_enable_bounds_snapshot)
+	{
+		snapshot = read_bounds_snapshot(prel, partitions, parts_count,
+										&snapshot_stamp);
+		snapshot_entries = palloc0(Max(parts_count, 1) *
+								   sizeof(BoundsSnapshotEntry));
+
+		/* Some partitions might have been dropped */
+		snapshot_outdated = (!snapshot || snapshot->nentries != parts_count);
+	}
+
 	/* Create temporary memory context for loop */
 	temp_mcxt = AllocSetContextCreate(CurrentMemoryContext,
 									  CppAsString(fill_prel_with_partitions),
@@ -756,7 +962,8 @@ fill_prel_with_partitions(PartRelationInfo *prel,
 	/* Initialize bounds of partitions */
 	for (i = 0; i < PrelChildrenCount(prel); i++)
 	{
-		PartBoundInfo *pbin;
+		PartBoundInfo  *pbin,
+						pbin_snapshot;
 
 		/* Clear all previous allocations */
 		MemoryContextReset(temp_mcxt);
@@ -764,8 +971,22 @@ fill_prel_with_partitions(PartRelationInfo *prel,
 		/* Switch to the temporary memory context */
 		old_mcxt = MemoryContextSwitchTo(temp_mcxt);
 		{
-			/* Fetch constraint's expression tree */
-			pbin = get_bounds_of_partition(partitions[i], prel);
+			if (snapshot_entries)
+				snapshot_entries[i].child_relid = partitions[i];
+
+			/* Snapshot is valid as a whole, look for partition's bounds */
+			if (snapshot &&
+				fetch_bounds_from_snapshot(snapshot, prel, partitions[i],
+										   &pbin_snapshot))
+			{
+				pbin = &pbin_snapshot;
+			}
+			else
+			{
+				/* Fetch constraint's expression tree */
+				pbin = get_bounds_of_partition(partitions[i], prel);
+				snapshot_outdated = true;
+			}
 		}
 		MemoryContextSwitchTo(old_mcxt);
 
@@ -792,6 +1013,9 @@ fill_prel_with_partitions(PartRelationInfo *prel,
 				}
 
 				prel->children[pbin->part_idx] = pbin->child_relid;
+
+				if (snapshot_entries)
+					snapshot_entries[i].part_idx = pbin->part_idx;
 				break;
 
 			case PT_RANGE:
@@ -811,6 +1035,12 @@ fill_prel_with_partitions(PartRelationInfo *prel,
 														prel->ev_len);
 					}
 					MemoryContextSwitchTo(old_mcxt);
+
+					if (snapshot_entries)
+					{
+						snapshot_entries[i].range_min = prel->ranges[i].min;
+						snapshot_entries[i].range_max = prel->ranges[i].max;
+					}
 				}
 				break;
 
@@ -826,6 +1056,11 @@ fill_prel_with_partitions(PartRelationInfo *prel,
 	/* Drop temporary memory context */
 	MemoryContextDelete(temp_mcxt);
 
+	/* Save bounds for other backends */
+	if (snapshot_entries && snapshot_outdated)
+		write_bounds_snapshot(prel, snapshot_entries, PrelChildrenCount(prel),
+							  &snapshot_stamp);
+
 	/* Finalize 'prel' for a RANGE-partitioned table */
 	if (prel->parttype == PT_RANGE)
 	{
@@ -853,6 +1088,264 @@ fill_prel_with_partitions(PartRelationInfo *prel,
 		}
 }
 
+/* Has partition been dropped or altered since 'pret' was retired? */
+static bool
+retired_partition_changed(const PartRetiredInfo *pret, Oid partition,
+						  const Oid *partitions, const uint32 parts_count)
+{
+	uint32 i;
+
+	if (!bsearch_oid(partition, partitions, parts_count))
+		return true;
+
+	for (i = 0; i < pret->ntouched; i++)
+		if (pret->touched[i] == partition)
+			return true;
+
+	return false;
+}
+
+/*
+ * Fill PartRelationInfo of a RANGE-partitioned table using the retired one.
+ * Only bounds of new (or altered) partitions are fetched, and they are
+ * inserted into the array of sorted RangeEntries one by one.
+ *
+ * Returns false if it's impossible (or not worth it).
+ */
+static bool
+fill_prel_incrementally(PartRelationInfo *prel,
+						const Oid *partitions,
+						const uint32 parts_count)
+{
+	PartRetiredInfo	   *pret;
+	PartRelationInfo   *old_prel;
+	Oid				   *old_children,
+					   *new_children;
+	uint32				nkept = 0,
+						nnew = 0,
+						i,
+						j;
+	FmgrInfo			cmp_finfo;
+	MemoryContext		temp_mcxt,
+						old_mcxt;
+
+	AssertTemporaryContext();
+
+	if (prel->parttype != PT_RANGE || parts_count == 0)
+		return false;
+
+	pret = pathman_cache_search_relid(retired_cache,
+									  PrelParentRelid(prel),
+									  HASH_FIND,
+									  NULL);
+	if (!pret)
+		return false;
+
+	old_prel = pret->prel;
+
+	/* Partitioning expression must be exactly the same */
+	if (old_prel->parttype != PT_RANGE ||
+		old_prel->ev_type != prel->ev_type ||
+		old_prel->ev_collid != prel->ev_collid ||
+		old_prel->cmp_proc != prel->cmp_proc ||
+		strcmp(old_prel->expr_cstr, prel->expr_cstr) != 0)
+		return false;
+
+	/* Sort old children for bsearch() ('partitions' are sorted already) */
+	old_children = palloc(PrelChildrenCount(old_prel) * sizeof(Oid));
+	memcpy(old_children, PrelGetChildrenArray(old_prel),
+		   PrelChildrenCount(old_prel) * sizeof(Oid));
+	qsort(old_children, PrelChildrenCount(old_prel), sizeof(Oid), oid_cmp);
+
+	/* Find partitions which have been added (or altered) */
+	new_children = palloc(parts_count * sizeof(Oid));
+	for (i = 0; i < parts_count; i++)
+	{
+		bool touched = false;
+
+		for (j = 0; j < pret->ntouched && !touched; j++)
+			touched = (pret->touched[j] == partitions[i]);
+
+		if (touched || !bsearch_oid(partitions[i], old_children,
+									PrelChildrenCount(old_prel)))
+		{
+			if (nnew == INCREMENTAL_UPDATE_MAX_PARTS)
+			{
+				pfree(old_children);
+				pfree(new_children);
+
+				return false;
+			}
+
+			new_children[nnew++] = partitions[i];
+		}
+	}
+
+	pfree(old_children);
+
+	/* Count surviving partitions, catch inconsistencies (if any) */
+	for (i = 0; i < PrelChildrenCount(old_prel); i++)
+		if (!retired_partition_changed(pret, PrelGetChildrenArray(old_prel)[i],
+									   partitions, parts_count))
+			nkept++;
+
+	if (nkept + nnew != parts_count)
+	{
+		pfree(new_children);
+
+		return false;
+	}
+
+	/* Allocate memory for 'prel->children' & 'prel->ranges' */
+	prel->children	= MemoryContextAllocZero(prel->mcxt, parts_count * sizeof(Oid));
+	prel->ranges	= MemoryContextAllocZero(prel->mcxt, parts_count * sizeof(RangeEntry));
+
+	/* Set number of children */
+	PrelChildrenCount(prel) = parts_count;
+
+	/*
+	 * Copy surviving partitions (they're sorted already). Since we don't
+	 * access catalogs here, 'old_prel' can't be invalidated under our feet.
+	 */
+	nkept = 0;
+	old_mcxt = MemoryContextSwitchTo(prel->mcxt);
+	for (i = 0; i < PrelChildrenCount(old_prel); i++)
+	{
+		const RangeEntry *entry = &PrelGetRangesArray(old_prel)[i];
+
+		if (retired_partition_changed(pret, entry->child_oid,
+									  partitions, parts_count))
+			continue;
+
+		prel->ranges[nkept].child_oid = entry->child_oid;
+		prel->ranges[nkept].min = CopyBound(&entry->min,
+											prel->ev_byval,
+											prel->ev_len);
+		prel->ranges[nkept].max = CopyBound(&entry->max,
+											prel->ev_byval,
+											prel->ev_len);
+		nkept++;
+	}
+	MemoryContextSwitchTo(old_mcxt);
+
+	/* NOTE: catalog access below might free 'old_prel', don't use it */
+
+	fmgr_info(prel->cmp_proc, &cmp_finfo);
+
+	/* Create temporary memory context for loop */
+	temp_mcxt = AllocSetContextCreate(CurrentMemoryContext,
+									  CppAsString(fill_prel_incrementally),
+									  ALLOCSET_SMALL_SIZES);
+
+	/* Insert new partitions, keeping the array sorted */
+	for (i = 0; i < nnew; i++)
+	{
+		PartBoundInfo  *pbin;
+		uint32			nranges = nkept + i,
+						low = 0,
+						high = nranges;
+
+		/* Clear all previous allocations */
+		MemoryContextReset(temp_mcxt);
+
+		/* Fetch constraint's expression tree */
+		old_mcxt = MemoryContextSwitchTo(temp_mcxt);
+		pbin = get_bounds_of_partition(new_children[i], prel);
+		MemoryContextSwitchTo(old_mcxt);
+
+		/* Find the first RangeEntry with greater 'min' */
+		while (low < high)
+		{
+			uint32 mid = low + (high - low) / 2;
+
+			if (cmp_bounds(&cmp_finfo, prel->ev_collid,
+						   &prel->ranges[mid].min, &pbin->range_min) <= 0)
+				low = mid + 1;
+			else
+				high = mid;
+		}
+
+		memmove(&prel->ranges[low + 1], &prel->ranges[low],
+				(nranges - low) * sizeof(RangeEntry));
+
+		/* Copy all min & max Datums to the persistent mcxt */
+		old_mcxt = MemoryContextSwitchTo(prel->mcxt);
+		{
+			prel->ranges[low].child_oid = pbin->child_relid;
+			prel->ranges[low].min = CopyBound(&pbin->range_min,
+											  prel->ev_byval,
+											  prel->ev_len);
+			prel->ranges[low].max = CopyBound(&pbin->range_max,
+											  prel->ev_byval,
+											  prel->ev_len);
+		}
+		MemoryContextSwitchTo(old_mcxt);
+	}
+
+	/* Drop temporary memory context */
+	MemoryContextDelete(temp_mcxt);
+	pfree(new_children);
+
+	/* Initialize 'prel->children' array */
+	for (i = 0; i < PrelChildrenCount(prel); i++)
+		prel->children[i] = prel->ranges[i].child_oid;
+
+	return true;
+}
+
+/*
+ * Build IntRangeIndex for a RANGE-partitioned table if
+ * type of partitioning expression is integer-like.
+ */
+static void
+fill_prel_with_int_ranges(PartRelationInfo *prel)
+{
+	const RangeEntry   *ranges = PrelGetRangesArray(prel);
+	uint32				nranges = PrelChildrenCount(prel),
+						i;
+	IntRangeIndex	   *index;
+	Oid					typid;
+
+	if (prel->parttype != PT_RANGE || nranges == 0)
+		return;
+
+	/* Bounds of domains are compared using base type's 'cmp_proc' */
+	typid = getBaseType(prel->ev_type);
+	if (!IntRangeIndexSupportsType(typid))
+		return;
+
+	/* Only outer bounds are allowed to be infinite */
+	for (i = 0; i < nranges; i++)
+	{
+		if ((i > 0 && IsInfinite(&ranges[i].min)) ||
+			(i < nranges - 1 && IsInfinite(&ranges[i].max)) ||
+			IsPlusInfinity(&ranges[i].min) ||
+			IsMinusInfinity(&ranges[i].max))
+			return;
+	}
+
+	index = MemoryContextAlloc(prel->mcxt, sizeof(IntRangeIndex));
+	index->typid	= typid;
+	index->count	= nranges;
+	index->mins		= MemoryContextAlloc(prel->mcxt, nranges * sizeof(int64));
+	index->maxs		= MemoryContextAlloc(prel->mcxt, nranges * sizeof(int64));
+	index->min_inf	= IsMinusInfinity(&ranges[0].min);
+	index->max_inf	= IsPlusInfinity(&ranges[nranges - 1].max);
+
+	for (i = 0; i < nranges; i++)
+	{
+		index->mins[i] = IsInfinite(&ranges[i].min) ?
+							PG_INT64_MIN :
+							DatumGetIntRangeValue(BoundGetValue(&ranges[i].min), typid);
+
+		index->maxs[i] = IsInfinite(&ranges[i].max) ?
+							PG_INT64_MAX :
+							DatumGetIntRangeValue(BoundGetValue(&ranges[i].max), typid);
+	}
+
+	prel->int_ranges = index;
+}
+
 /* qsort() comparison function for RangeEntries */
 static int
 cmp_range_entries(const void *p1, const void *p2, void *arg)
@@ -39,6 +39,12 @@ init_runtime_append_static_data(void)
 	runtimeappend_exec_methods.MarkPosCustomScan		= NULL;
 	runtimeappend_exec_methods.RestrPosCustomScan		= NULL;
 	runtimeappend_exec_methods.ExplainCustomScan		= runtime_append_explain;
+#if PG_VERSION_NUM >= 110000
+	runtimeappend_exec_methods.EstimateDSMCustomScan	= runtime_append_estimate_dsm;
+	runtimeappend_exec_methods.InitializeDSMCustomScan	= runtime_append_initialize_dsm;
+	runtimeappend_exec_methods.ReInitializeDSMCustomScan = runtime_append_reinitialize_dsm;
+	runtimeappend_exec_methods.InitializeWorkerCustomScan = runtime_append_initialize_worker;
+#endif
 
 	DefineCustomBoolVariable("pg_pathman.enable_runtimeappend",
 							 "Enables the planner's use of " RUNTIME_APPEND_NODE_NAME " custom node.",
@@ -72,18 +78,52 @@ create_runtime_append_plan(PlannerInfo *root, RelOptInfo *rel,
 						   CustomPath *best_path, List *tlist,
 						   List *clauses, List *custom_plans)
 {
-	return create_append_plan_common(root, rel,
-									 best_path, tlist,
-									 clauses, custom_plans,
-									 &runtimeappend_plan_methods);
+	CustomScan *cscan;
+
+	cscan = (CustomScan *) create_append_plan_common(root, rel,
+													 best_path, tlist,
+													 clauses, custom_plans,
+													 &runtimeappend_plan_methods);
+
+	/*
+	 * Append RuntimeAppend's data to the 'custom_private' (2nd):
+	 * we're free to reorder partitions if there are no pathkeys.
+	 */
+	cscan->custom_private = lappend(cscan->custom_private,
+									list_make1_int(best_path->path.pathkeys == NIL));
+
+	return &cscan->scan.plan;
 }
 
 Node *
 runtime_append_create_scan_state(CustomScan *node)
 {
-	return create_append_scan_state_common(node,
-										   &runtimeappend_exec_methods,
-										   sizeof(RuntimeAppendState));
+	RuntimeAppendState *scan_state;
+	bool				unordered;
+
+	scan_state = (RuntimeAppendState *)
+			create_append_scan_state_common(node,
+											&runtimeappend_exec_methods,
+											sizeof(RuntimeAppendState));
+
+	unordered = (bool) linitial_int(lsecond(node->custom_private));
+
+	/* Check if there are any foreign partitions */
+	if (unordered)
+	{
+		ListCell *lc;
+
+		foreach (lc, node->custom_plans)
+		{
+			if (IsA(lfirst(lc), ForeignScan))
+			{
+				scan_state->defer_foreign = true;
+				break;
+			}
+		}
+	}
+
+	return (Node *) scan_state;
 }
 
 void
@@ -92,6 +132,36 @@ runtime_append_begin(CustomScanState *node, EState *estate, int eflags)
 	begin_append_common(node, estate, eflags);
 }
 
+/*
+ * Move foreign partitions to the end of the list (keeping the order
+ * of local ones), thus they won't delay the first tuples of result.
+ */
+static void
+defer_foreign_plans(ChildScanCommon *plans, int nplans)
+{
+	ChildScanCommon	   *foreign_plans;
+	int					nlocal = 0,
+						nforeign = 0,
+						i;
+
+	if (nplans < 2)
+		return;
+
+	foreign_plans = palloc(nplans * sizeof(ChildScanCommon));
+
+	/* NOTE: plan states might not exist yet (see prepare_plan_states()) */
+	for (i = 0; i < nplans; i++)
+	{
+		if (plans[i]->is_foreign)
+			foreign_plans[nforeign++] = plans[i];
+		else
+			plans[nlocal++] = plans[i];
+	}
+
+	memcpy(&plans[nlocal], foreign_plans, nforeign * sizeof(ChildScanCommon));
+	pfree(foreign_plans);
+}
+
 static void
 fetch_next_tuple(CustomScanState *node)
 {
@@ -99,8 +169,14 @@ fetch_next_tuple(CustomScanState *node)
 
 	while (scan_state->running_idx < scan_state->ncur_plans)
 	{
-		ChildScanCommon		child = scan_state->cur_plans[scan_state->running_idx];
-		PlanState		   *state = child->content.plan_state;
+		ChildScanCommon		child;
+		PlanState		   *state;
+
+		/* Initialize (or ReScan) this plan only once we get to it */
+		prepare_plan_states(node, scan_state->running_idx + 1);
+
+		child = scan_state->cur_plans[scan_state->running_idx];
+		state = child->content.plan_state;
 
 		for (;;)
 		{
@@ -119,9 +195,119 @@ fetch_next_tuple(CustomScanState *node)
 	scan_state->slot = NULL;
 }
 
+#if PG_VERSION_NUM >= 110000
+/* Use plans selected by the leader of parallel scan */
+static void
+adopt_selected_plans(RuntimeAppendState *scan_state)
+{
+	RuntimeAppendParallelState *pstate = scan_state->pstate;
+	int							i;
+
+	if (scan_state->cur_plans)
+		pfree(scan_state->cur_plans);
+
+	scan_state->cur_plans = NULL;
+	scan_state->ncur_plans = pstate->nplans;
+
+	if (pstate->nplans > 0)
+		scan_state->cur_plans = palloc(pstate->nplans * sizeof(ChildScanCommon));
+
+	for (i = 0; i < pstate->nplans; i++)
+	{
+		int original_order = pstate->plans[i].original_order;
+
+		Assert(original_order < scan_state->nall_plans);
+		scan_state->cur_plans[i] = scan_state->all_plans[original_order];
+	}
+
+	scan_state->running_idx = -1;
+	scan_state->pstate_adopted = true;
+}
+
+/* Claim the next plan which is not finished yet */
+static bool
+choose_next_plan(RuntimeAppendState *scan_state)
+{
+	RuntimeAppendParallelState *pstate = scan_state->pstate;
+	bool						found = false;
+	int							i;
+
+	SpinLockAcquire(&pstate->mutex);
+
+	for (i = 0; i < pstate->nplans; i++)
+	{
+		int			idx = (pstate->next_plan + i) % pstate->nplans;
+		PlanState  *state = scan_state->cur_plans[idx]->content.plan_state;
+
+		if (pstate->plans[idx].finished)
+			continue;
+
+		/* Non-partial plans should be executed by a single participant */
+		if (!state->plan->parallel_aware)
+			pstate->plans[idx].finished = true;
+
+		/* Let the next participant pick another plan */
+		pstate->next_plan = (idx + 1) % pstate->nplans;
+
+		scan_state->running_idx = idx;
+		found = true;
+		break;
+	}
+
+	SpinLockRelease(&pstate->mutex);
+
+	return found;
+}
+
+static void
+fetch_next_tuple_parallel(CustomScanState *node)
+{
+	RuntimeAppendState	   *scan_state = (RuntimeAppendState *) node;
+	RuntimeAppendParallelState *pstate = scan_state->pstate;
+
+	if (!scan_state->pstate_adopted)
+		adopt_selected_plans(scan_state);
+
+	for (;;)
+	{
+		ChildScanCommon		child;
+		TupleTableSlot	   *slot;
+
+		/* Claim a new plan if we don't have one */
+		if (scan_state->running_idx < 0 && !choose_next_plan(scan_state))
+			break;
+
+		child = scan_state->cur_plans[scan_state->running_idx];
+		slot = ExecProcNode(child->content.plan_state);
+
+		if (!TupIsNull(slot))
+		{
+			scan_state->slot = slot;
+			return;
+		}
+
+		/* This plan is exhausted, nobody should start it again */
+		SpinLockAcquire(&pstate->mutex);
+		pstate->plans[scan_state->running_idx].finished = true;
+		SpinLockRelease(&pstate->mutex);
+
+		scan_state->running_idx = -1;
+	}
+
+	scan_state->slot = NULL;
+}
+#endif
+
 TupleTableSlot *
 runtime_append_exec(CustomScanState *node)
 {
+#if PG_VERSION_NUM >= 110000
+	RuntimeAppendState *scan_state = (RuntimeAppendState *) node;
+
+	if (IsParallelRuntimeAppend(scan_state))
+		return exec_append_common(node, fetch_next_tuple_parallel);
+#endif
+
 	return exec_append_common(node, fetch_next_tuple);
 }
 
@@ -134,7 +320,39 @@ runtime_append_end(CustomScanState *node)
 void
 runtime_append_rescan(CustomScanState *node)
 {
+	RuntimeAppendState *scan_state = (RuntimeAppendState *) node;
+
+#if PG_VERSION_NUM >= 110000
+	/*
+	 * Partitions of parallel scan are pruned by the leader
+	 * (see runtime_append_reinitialize_dsm()), so we only
+	 * have to ReScan all plan states like Append does.
+	 */
+	if (IsParallelRuntimeAppend(scan_state))
+	{
+		ListCell *lc;
+
+		foreach (lc, node->custom_ps)
+		{
+			PlanState *state = (PlanState *) lfirst(lc);
+
+			if (node->ss.ps.chgParam)
+				UpdateChangedParamSet(state, node->ss.ps.chgParam);
+
+			if (bms_is_empty(state->chgParam))
+				ExecReScan(state);
+		}
+
+		scan_state->pstate_adopted = false;
+		scan_state->running_idx = -1;
+		return;
+	}
+#endif
+
 	rescan_append_common(node);
+
+	if (scan_state->defer_foreign)
+		defer_foreign_plans(scan_state->cur_plans, scan_state->ncur_plans);
 }
 
 void
@@ -146,3 +364,83 @@ runtime_append_explain(CustomScanState *node, List *ancestors, ExplainState *es)
 						  scan_state->children_table,
 						  scan_state->custom_exprs);
 }
+
+#if PG_VERSION_NUM >= 110000
+/* Prune partitions and publish the selected plans */
+static void
+publish_selected_plans(RuntimeAppendState *scan_state)
+{
+	RuntimeAppendParallelState *pstate = scan_state->pstate;
+	ChildScanCommon			   *selected;
+	int							nselected,
+								i;
+
+	selected = prune_append_plans(&scan_state->css, &nselected);
+
+	SpinLockAcquire(&pstate->mutex);
+
+	for (i = 0; i < nselected; i++)
+	{
+		pstate->plans[i].original_order = selected[i]->original_order;
+		pstate->plans[i].finished = false;
+	}
+
+	pstate->nplans = nselected;
+	pstate->next_plan = 0;
+
+	SpinLockRelease(&pstate->mutex);
+
+	if (selected)
+		pfree(selected);
+
+	/* Leader will read them on the next call */
+	scan_state->pstate_adopted = false;
+}
+
+Size
+runtime_append_estimate_dsm(CustomScanState *node, ParallelContext *pcxt)
+{
+	RuntimeAppendState *scan_state = (RuntimeAppendState *) node;
+
+	return add_size(offsetof(RuntimeAppendParallelState, plans),
+					mul_size(sizeof(RuntimeAppendParallelPlan),
+							 scan_state->nall_plans));
+}
+
+void
+runtime_append_initialize_dsm(CustomScanState *node,
+							  ParallelContext *pcxt,
+							  void *coordinate)
+{
+	RuntimeAppendState		   *scan_state = (RuntimeAppendState *) node;
+	RuntimeAppendParallelState *pstate = coordinate;
+
+	SpinLockInit(&pstate->mutex);
+	scan_state->pstate = pstate;
+
+	/* Params (including initplans) have already been evaluated */
+	publish_selected_plans(scan_state);
+}
+
+void
+runtime_append_reinitialize_dsm(CustomScanState *node,
+								ParallelContext *pcxt,
+								void *coordinate)
+{
+	RuntimeAppendState *scan_state = (RuntimeAppendState *) node;
+
+	Assert(scan_state->pstate == coordinate);
+	publish_selected_plans(scan_state);
+}
+
+void
+runtime_append_initialize_worker(CustomScanState *node,
+								 shm_toc *toc,
+								 void *coordinate)
+{
+	RuntimeAppendState *scan_state = (RuntimeAppendState *) node;
+
+	scan_state->pstate = coordinate;
+	scan_state->pstate_adopted = false;
+}
+#endif
@@ -443,6 +443,9 @@ runtime_merge_append_rescan(CustomScanState *node)
 
 	rescan_append_common(node);
 
+	/* We need the first tuple of each plan right away */
+	prepare_plan_states(node, scan_state->rstate.ncur_plans);
+
 	nplans = scan_state->rstate.ncur_plans;
 
 	scan_state->ms_slots = (TupleTableSlot **) palloc0(sizeof(TupleTableSlot *) * nplans);
@@ -0,0 +1,744 @@
+/* ------------------------------------------------------------------------
+ *
+ * shared_cache.c
+ *		Partition dispatch info shared by all backends
+ *
+ *		Building a PartRelationInfo for a parent with thousands of
+ *		partitions means scanning pg_inherits and parsing a CHECK
+ *		constraint of each partition. Once some backend has done
+ *		that, it publishes sorted partitions in shared memory, so
+ *		that other backends could simply copy them.
+ *
+ *		Entries are dropped in relcache callback, and each entry has
+ *		a unique generation stamp, which prevents a backend from
+ *		publishing partitions it has collected before invalidation.
+ *		Besides, each DDL transaction bumps the epoch before commit,
+ *		so that nothing collected using old catalogs gets published.
+ *		Entries of dropped databases are swept once we run out of chunks.
+ *
+ * Copyright (c) 2020, Postgres Professional
+ *
+ * ------------------------------------------------------------------------
+ */
+
+#include "compat/pg_compat.h"
+
+#include "init.h"
+#include "shared_cache.h"
+
+#include "access/transam.h"
+#include "access/xact.h"
+#include "miscadmin.h"
+#include "storage/shmem.h"
+#include "utils/guc.h"
+#include "utils/hsearch.h"
+#include "utils/inval.h"
+#include "utils/memutils.h"
+#include "utils/syscache.h"
+
+
+/*
+ * For pg_pathman.shared_cache_partitions GUC.
+ */
+int						pg_pathman_shared_cache_partitions = 0;
+
+
+static SharedCacheHeader   *shared_cache = NULL;
+static SharedCacheChunk	   *shared_chunks = NULL;
+static HTAB				   *shared_prels = NULL;
+static HTAB				   *shared_parents = NULL;
+
+
+/*
+ * Relations invalidated by current transaction (see shared_cache_xact_hook()).
+ */
+static Oid		pending_relids[SHARED_CACHE_PENDING_SIZE];
+static int		pending_relids_count = 0;
+static bool		pending_reset = false;
+
+
+/* Shared memory layout */
+#define SharedCacheChunksCount() \
+	( 2 * ((pg_pathman_shared_cache_partitions + SHARED_CACHE_CHUNK_ENTRIES - 1) / \
+		   SHARED_CACHE_CHUNK_ENTRIES) )
+
+#define SharedCacheParentsCount() \
+	( Max(SharedCacheChunksCount(), 128) )
+
+#define SharedCacheGetChunk(idx) \
+	( &shared_chunks[(idx)] )
+
+/* We're not allowed to see (or publish) uncommitted partitions */
+#define SharedCacheIsUsable() \
+	( shared_cache != NULL && \
+	  !TransactionIdIsValid(GetTopTransactionIdIfAny()) )
+
+
+static void shared_cache_relcache_hook(Datum arg, Oid relid);
+static void shared_cache_xact_hook(XactEvent event, void *arg);
+
+static void remember_pending_relid(Oid relid);
+static SharedPrelEntry *find_entry(Oid relid);
+static void forget_entry(SharedPrelEntry *entry);
+static void forget_all_entries(void);
+static bool forget_dropped_databases(void);
+
+static void copy_out_entry(const SharedPrelEntry *entry,
+						   PartRelationInfo *prel);
+static bool copy_in_entry(SharedPrelEntry *entry,
+						  const PartRelationInfo *prel);
+
+
+void
+init_shared_cache_static_data(void)
+{
+	DefineCustomIntVariable("pg_pathman.shared_cache_partitions",
+							"Max number of partitions stored in shared dispatch cache",
+							NULL,
+							&pg_pathman_shared_cache_partitions,
+							0,
+							0, 16 * 1024 * 1024,
+							PGC_POSTMASTER,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	if (IsSharedCacheEnabled())
+	{
+		RequestPathmanLWLocks("pg_pathman", 1);
+
+		/* Register hooks for all Postmaster's forks */
+		CacheRegisterRelcacheCallback(shared_cache_relcache_hook,
+									  PointerGetDatum(NULL));
+		RegisterXactCallback(shared_cache_xact_hook, NULL);
+	}
+}
+
+/*
+ * Estimate amount of shmem needed for shared dispatch cache.
+ */
+Size
+estimate_shared_cache_size(void)
+{
+	Size	size;
+
+	if (!IsSharedCacheEnabled())
+		return 0;
+
+	size = MAXALIGN(sizeof(SharedCacheHeader));
+	size = add_size(size, mul_size(SharedCacheChunksCount(),
+								   sizeof(SharedCacheChunk)));
+	size = add_size(size, hash_estimate_size(SharedCacheParentsCount(),
+											 sizeof(SharedPrelEntry)));
+	size = add_size(size, hash_estimate_size(pg_pathman_shared_cache_partitions,
+											 sizeof(SharedParentEntry)));
+
+	return size;
+}
+
+/*
+ * Initialize shared memory needed for shared dispatch cache.
+ */
+void
+init_shared_cache(void)
+{
+	HASHCTL		ctl;
+	Size		size;
+	bool		found;
+	int			i;
+
+	if (!IsSharedCacheEnabled())
+		return;
+
+	size = add_size(MAXALIGN(sizeof(SharedCacheHeader)),
+					mul_size(SharedCacheChunksCount(),
+							 sizeof(SharedCacheChunk)));
+
+	shared_cache = (SharedCacheHeader *)
+			ShmemInitStruct("pg_pathman's shared dispatch cache", size, &found);
+
+	shared_chunks = (SharedCacheChunk *)
+			((char *) shared_cache + MAXALIGN(sizeof(SharedCacheHeader)));
+
+	/* Initialize 'shared_cache' if needed */
+	if (!found)
+	{
+		shared_cache->lock = GetPathmanLWLocks("pg_pathman");
+		pg_atomic_init_u32(&shared_cache->epoch, 0);
+		shared_cache->next_generation = 0;
+
+		/* Put all chunks into free list */
+		for (i = 0; i < SharedCacheChunksCount(); i++)
+			SharedCacheGetChunk(i)->next = i + 1;
+
+		SharedCacheGetChunk(SharedCacheChunksCount() - 1)->next = -1;
+
+		shared_cache->free_chunk = 0;
+		shared_cache->free_chunks_count = SharedCacheChunksCount();
+	}
+
+	memset(&ctl, 0, sizeof(ctl));
+	ctl.keysize = sizeof(SharedCacheKey);
+	ctl.entrysize = sizeof(SharedPrelEntry);
+
+	shared_prels = ShmemInitHash("pg_pathman's shared dispatch cache entries",
+								 SharedCacheParentsCount(),
+								 SharedCacheParentsCount(),
+								 &ctl, HASH_ELEM | HASH_BLOBS);
+
+	memset(&ctl, 0, sizeof(ctl));
+	ctl.keysize = sizeof(SharedCacheKey);
+	ctl.entrysize = sizeof(SharedParentEntry);
+
+	shared_parents = ShmemInitHash("pg_pathman's shared parents cache entries",
+								   pg_pathman_shared_cache_partitions,
+								   pg_pathman_shared_cache_partitions,
+								   &ctl, HASH_ELEM | HASH_BLOBS);
+}
+
+
+/*
+ * Fill 'prel' with partitions published by some other backend.
+ * Otherwise, prepare 'ticket' for shared_cache_publish().
+ */
+bool
+shared_cache_lookup(PartRelationInfo *prel, SharedCacheTicket *ticket)
+{
+	SharedPrelEntry	   *entry;
+	SharedCacheKey		key;
+	bool				found;
+
+	ticket->valid = false;
+
+	if (!SharedCacheIsUsable())
+		return false;
+
+	/* Bounds of types passed by reference would require pointer swizzling */
+	if (prel->parttype == PT_RANGE && !prel->ev_byval)
+		return false;
+
+	/* Make sure that we've seen all committed invalidation messages */
+	AcceptInvalidationMessages();
+
+	key.dbid = MyDatabaseId;
+	key.relid = PrelParentRelid(prel);
+
+	LWLockAcquire(shared_cache->lock, LW_SHARED);
+
+	entry = hash_search(shared_prels, (const void *) &key, HASH_FIND, NULL);
+	if (entry && entry->valid &&
+		entry->parttype == prel->parttype &&
+		entry->ev_type == prel->ev_type)
+	{
+		copy_out_entry(entry, prel);
+		LWLockRelease(shared_cache->lock);
+
+		return true;
+	}
+
+	LWLockRelease(shared_cache->lock);
+
+	/* Miss: create an entry which will receive our invalidation messages */
+	LWLockAcquire(shared_cache->lock, LW_EXCLUSIVE);
+
+	ticket->epoch = pg_atomic_read_u32(&shared_cache->epoch);
+
+	entry = hash_search(shared_prels, (const void *) &key, HASH_ENTER_NULL, &found);
+	if (entry)
+	{
+		/* Partitioning scheme has changed, drop outdated partitions */
+		if (found)
+			forget_entry(entry);
+		else
+		{
+			entry->children_count = 0;
+			entry->first_chunk = -1;
+		}
+
+		/* Concurrent publishers (if any) will back off */
+		entry->generation = shared_cache->next_generation++;
+		entry->valid = false;
+
+		ticket->generation = entry->generation;
+		ticket->valid = true;
+	}
+
+	LWLockRelease(shared_cache->lock);
+
+	return false;
+}
+
+/*
+ * Publish partitions of 'prel' unless they have been invalidated.
+ */
+void
+shared_cache_publish(const PartRelationInfo *prel,
+					 const SharedCacheTicket *ticket)
+{
+	SharedPrelEntry	   *entry;
+	SharedCacheKey		key;
+	bool				swept = false;
+
+	if (!ticket->valid || !SharedCacheIsUsable())
+		return;
+
+	/* Trivial entries are not worth it */
+	if (PrelChildrenCount(prel) == 0)
+		return;
+
+	key.dbid = MyDatabaseId;
+	key.relid = PrelParentRelid(prel);
+
+publish_retry:
+	LWLockAcquire(shared_cache->lock, LW_EXCLUSIVE);
+
+	/* Has anything changed since shared_cache_lookup()? */
+	if (pg_atomic_read_u32(&shared_cache->epoch) != ticket->epoch)
+		goto publish_done;
+
+	entry = hash_search(shared_prels, (const void *) &key, HASH_FIND, NULL);
+	if (!entry || entry->valid || entry->generation != ticket->generation)
+		goto publish_done;
+
+	/* Might fail if we run out of shared memory */
+	if (copy_in_entry(entry, prel))
+	{
+		entry->parttype	= prel->parttype;
+		entry->ev_type	= prel->ev_type;
+		entry->valid	= true;
+	}
+	else if (!swept)
+	{
+		LWLockRelease(shared_cache->lock);
+
+		/* Chunks might be occupied by databases which no longer exist */
+		swept = true;
+		if (forget_dropped_databases())
+			goto publish_retry;
+
+		return;
+	}
+
+publish_done:
+	LWLockRelease(shared_cache->lock);
+}
+
+/*
+ * Drop entry of a parent (or partition's parent) 'relid'.
+ */
+void
+shared_cache_invalidate(Oid relid)
+{
+	SharedPrelEntry	   *entry;
+
+	if (shared_cache == NULL)
+		return;
+
+	/* Invalidation event for whole cache */
+	if (!OidIsValid(relid))
+	{
+		LWLockAcquire(shared_cache->lock, LW_EXCLUSIVE);
+		forget_all_entries();
+		pg_atomic_fetch_add_u32(&shared_cache->epoch, 1);
+		LWLockRelease(shared_cache->lock);
+
+		return;
+	}
+
+	/* Most relations are neither parents nor published partitions */
+	LWLockAcquire(shared_cache->lock, LW_SHARED);
+	entry = find_entry(relid);
+	LWLockRelease(shared_cache->lock);
+
+	/*
+	 * No need to stop publishers: partitions which are not published yet
+	 * are locked by their publisher, and a new partition invalidates its
+	 * parent (see build_pathman_relation_info()).
+	 */
+	if (!entry)
+		return;
+
+	LWLockAcquire(shared_cache->lock, LW_EXCLUSIVE);
+
+	/* Entry might have been dropped while we weren't holding the lock */
+	entry = find_entry(relid);
+	if (entry)
+	{
+		SharedCacheKey key = entry->key;
+
+		forget_entry(entry);
+
+		/* Concurrent shared_cache_publish() will notice that */
+		hash_search(shared_prels, (const void *) &key, HASH_REMOVE, NULL);
+	}
+
+	LWLockRelease(shared_cache->lock);
+}
+
+
+/*
+ * Relcache callback which is registered in all backends.
+ */
+static void
+shared_cache_relcache_hook(Datum arg, Oid relid)
+{
+	/* We don't create entries for catalog */
+	if (OidIsValid(relid) && relid < FirstNormalObjectId)
+		return;
+
+	/* Changes of this transaction become visible at commit */
+	if (TransactionIdIsValid(GetTopTransactionIdIfAny()))
+	{
+		remember_pending_relid(relid);
+		return;
+	}
+
+	shared_cache_invalidate(relid);
+}
+
+/*
+ * Messages received by a writing transaction are processed once it's over,
+ * since its own changes can't be seen by other backends before commit.
+ * This way we don't take the lock for each command of a DDL script.
+ */
+static void
+shared_cache_xact_hook(XactEvent event, void *arg)
+{
+	int		i;
+
+	switch (event)
+	{
+		case XACT_EVENT_PRE_COMMIT:
+			/* Process messages produced by the last command */
+			if (TransactionIdIsValid(GetTopTransactionIdIfAny()) &&
+				!IsInParallelMode())
+				CommandCounterIncrement();
+
+			/*
+			 * Our changes become visible before XACT_EVENT_COMMIT, stop
+			 * publishers which might have seen old catalogs by then.
+			 */
+			if (shared_cache != NULL &&
+				(pending_reset || pending_relids_count > 0))
+				pg_atomic_fetch_add_u32(&shared_cache->epoch, 1);
+			return;
+
+		/* Some of these messages might have been sent by other backends */
+		case XACT_EVENT_COMMIT:
+		case XACT_EVENT_ABORT:
+		case XACT_EVENT_PREPARE:
+			if (pending_reset)
+				shared_cache_invalidate(InvalidOid);
+			else for (i = 0; i < pending_relids_count; i++)
+				shared_cache_invalidate(pending_relids[i]);
+			break;
+
+		default:
+			return;
+	}
+
+	pending_relids_count = 0;
+	pending_reset = false;
+}
+
+static void
+remember_pending_relid(Oid relid)
+{
+	int		i;
+
+	if (pending_reset)
+		return;
+
+	/* Too many relations, invalidate everything */
+	if (!OidIsValid(relid) ||
+		pending_relids_count >= SHARED_CACHE_PENDING_SIZE)
+	{
+		pending_reset = true;
+		return;
+	}
+
+	for (i = 0; i < pending_relids_count; i++)
+		if (pending_relids[i] == relid)
+			return;
+
+	pending_relids[pending_relids_count++] = relid;
+}
+
+
+/*
+ * Find entry of a parent 'relid' or of a published partition's parent.
+ * Caller must hold the lock.
+ */
+static SharedPrelEntry *
+find_entry(Oid relid)
+{
+	SharedPrelEntry	   *entry;
+	SharedParentEntry  *ppar;
+	SharedCacheKey		key;
+
+	key.dbid = MyDatabaseId;
+	key.relid = relid;
+
+	/* Is it a parent? */
+	entry = hash_search(shared_prels, (const void *) &key, HASH_FIND, NULL);
+	if (entry)
+		return entry;
+
+	/* Maybe it's a published partition? */
+	ppar = hash_search(shared_parents, (const void *) &key, HASH_FIND, NULL);
+	if (!ppar)
+		return NULL;
+
+	key.relid = ppar->parent_relid;
+	return hash_search(shared_prels, (const void *) &key, HASH_FIND, NULL);
+}
+
+/*
+ * Release chunks & partitions of 'entry'. Caller must hold exclusive lock.
+ */
+static void
+forget_entry(SharedPrelEntry *entry)
+{
+	int		chunk_idx = entry->first_chunk;
+	uint32	left = entry->children_count;
+
+	while (chunk_idx >= 0)
+	{
+		SharedCacheChunk   *chunk = SharedCacheGetChunk(chunk_idx);
+		int					next = chunk->next,
+							i;
+
+		for (i = 0; i < SHARED_CACHE_CHUNK_ENTRIES && left > 0; i++, left--)
+		{
+			SharedParentEntry  *ppar;
+			SharedCacheKey		key;
+
+			key.dbid = entry->key.dbid;
+			key.relid = chunk->entries[i].child_oid;
+
+			/* Partition might have been moved to another parent */
+			ppar = hash_search(shared_parents, (const void *) &key, HASH_FIND, NULL);
+			if (ppar && ppar->parent_relid == entry->key.relid)
+				hash_search(shared_parents, (const void *) &key, HASH_REMOVE, NULL);
+		}
+
+		/* Return this chunk to free list */
+		chunk->next = shared_cache->free_chunk;
+		shared_cache->free_chunk = chunk_idx;
+		shared_cache->free_chunks_count++;
+
+		chunk_idx = next;
+	}
+
+	entry->valid = false;
+	entry->children_count = 0;
+	entry->first_chunk = -1;
+}
+
+/*
+ * Drop all entries of current database. Caller must hold exclusive lock.
+ */
+static void
+forget_all_entries(void)
+{
+	HASH_SEQ_STATUS		status;
+	SharedPrelEntry	   *entry;
+
+	hash_seq_init(&status, shared_prels);
+	while ((entry = (SharedPrelEntry *) hash_seq_search(&status)) != NULL)
+	{
+		if (entry->key.dbid != MyDatabaseId)
+			continue;
+
+		forget_entry(entry);
+
+		/* It's safe to remove the current element */
+		hash_search(shared_prels, (const void *) &entry->key, HASH_REMOVE, NULL);
+	}
+}
+
+/*
+ * Drop all entries of databases which no longer exist.
+ * Caller must not hold the lock, since we have to read pg_database.
+ */
+static bool
+forget_dropped_databases(void)
+{
+	HASH_SEQ_STATUS		status;
+	SharedPrelEntry	   *entry;
+	Oid				   *dropped;
+	int					ndropped = 0,
+						max_dropped = SharedCacheParentsCount(),
+						i;
+
+	dropped = palloc(max_dropped * sizeof(Oid));
+
+	/* Collect databases we've got entries for */
+	LWLockAcquire(shared_cache->lock, LW_SHARED);
+	hash_seq_init(&status, shared_prels);
+	while ((entry = (SharedPrelEntry *) hash_seq_search(&status)) != NULL)
+	{
+		if (entry->key.dbid == MyDatabaseId)
+			continue;
+
+		for (i = 0; i < ndropped; i++)
+			if (dropped[i] == entry->key.dbid)
+				break;
+
+		if (i == ndropped && ndropped < max_dropped)
+			dropped[ndropped++] = entry->key.dbid;
+	}
+	LWLockRelease(shared_cache->lock);
+
+	/* Keep only databases which have been dropped */
+	for (i = 0; i < ndropped; )
+	{
+		if (SearchSysCacheExists1(DATABASEOID, ObjectIdGetDatum(dropped[i])))
+			dropped[i] = dropped[--ndropped];
+		else
+			i++;
+	}
+
+	if (ndropped == 0)
+	{
+		pfree(dropped);
+		return false;
+	}
+
+	LWLockAcquire(shared_cache->lock, LW_EXCLUSIVE);
+	hash_seq_init(&status, shared_prels);
+	while ((entry = (SharedPrelEntry *) hash_seq_search(&status)) != NULL)
+	{
+		for (i = 0; i < ndropped; i++)
+		{
+			if (dropped[i] != entry->key.dbid)
+				continue;
+
+			forget_entry(entry);
+
+			/* It's safe to remove the current element */
+			hash_search(shared_prels, (const void *) &entry->key, HASH_REMOVE, NULL);
+			break;
+		}
+	}
+	LWLockRelease(shared_cache->lock);
+
+	pfree(dropped);
+
+	return true;
+}
+
+/*
+ * Copy partitions of 'entry' to 'prel'. Caller must hold the lock.
+ */
+static void
+copy_out_entry(const SharedPrelEntry *entry, PartRelationInfo *prel)
+{
+	SharedCacheChunk   *chunk = NULL;
+	int					chunk_idx = entry->first_chunk,
+						entry_idx = SHARED_CACHE_CHUNK_ENTRIES;
+	uint32				i;
+
+	prel->children = MemoryContextAllocZero(prel->mcxt,
+											entry->children_count * sizeof(Oid));
+	if (prel->parttype == PT_RANGE)
+		prel->ranges = MemoryContextAllocZero(prel->mcxt,
+											  entry->children_count * sizeof(RangeEntry));
+
+	for (i = 0; i < entry->children_count; i++)
+	{
+		/* Switch to the next chunk */
+		if (entry_idx == SHARED_CACHE_CHUNK_ENTRIES)
+		{
+			Assert(chunk_idx >= 0);
+
+			chunk = SharedCacheGetChunk(chunk_idx);
+			chunk_idx = chunk->next;
+			entry_idx = 0;
+		}
+
+		prel->children[i] = chunk->entries[entry_idx].child_oid;
+
+		/* Bounds are passed by value, see shared_cache_lookup() */
+		if (prel->parttype == PT_RANGE)
+			prel->ranges[i] = chunk->entries[entry_idx];
+
+		entry_idx++;
+	}
+
+	PrelChildrenCount(prel) = entry->children_count;
+}
+
+/*
+ * Copy partitions of 'prel' to 'entry'. Caller must hold exclusive lock.
+ */
+static bool
+copy_in_entry(SharedPrelEntry *entry, const PartRelationInfo *prel)
+{
+	SharedCacheChunk   *chunk = NULL;
+	uint32				nchunks,
+						i;
+	int					entry_idx = SHARED_CACHE_CHUNK_ENTRIES;
+
+	nchunks = (PrelChildrenCount(prel) + SHARED_CACHE_CHUNK_ENTRIES - 1) /
+				SHARED_CACHE_CHUNK_ENTRIES;
+
+	/* Not enough free chunks */
+	if (nchunks > shared_cache->free_chunks_count)
+		return false;
+
+	for (i = 0; i < PrelChildrenCount(prel); i++)
+	{
+		SharedParentEntry  *ppar;
+		SharedCacheKey		key;
+
+		/* Take the next chunk from free list */
+		if (entry_idx == SHARED_CACHE_CHUNK_ENTRIES)
+		{
+			int chunk_idx = shared_cache->free_chunk;
+
+			Assert(chunk_idx >= 0);
+
+			shared_cache->free_chunk = SharedCacheGetChunk(chunk_idx)->next;
+			shared_cache->free_chunks_count--;
+
+			/* Append it to the entry */
+			if (chunk)
+				chunk->next = chunk_idx;
+			else
+				entry->first_chunk = chunk_idx;
+
+			chunk = SharedCacheGetChunk(chunk_idx);
+			chunk->next = -1;
+			entry_idx = 0;
+		}
+
+		if (prel->parttype == PT_RANGE)
+			chunk->entries[entry_idx] = PrelGetRangesArray(prel)[i];
+		else
+		{
+			memset(&chunk->entries[entry_idx], 0, sizeof(RangeEntry));
+			chunk->entries[entry_idx].child_oid = PrelGetChildrenArray(prel)[i];
+		}
+
+		entry_idx++;
+		entry->children_count++;
+
+		/* Finally, map partition to its parent */
+		key.dbid = MyDatabaseId;
+		key.relid = PrelGetChildrenArray(prel)[i];
+
+		ppar = hash_search(shared_parents, (const void *) &key, HASH_ENTER_NULL, NULL);
+		if (!ppar)
+		{
+			/* Release everything we've just taken */
+			forget_entry(entry);
+			return false;
+		}
+
+		ppar->parent_relid = PrelParentRelid(prel);
+	}
+
+	return true;
+}
@@ -17,10 +17,11 @@
 #include "utility_stmt_hooking.h"
 #include "partition_filter.h"
 
+#include "access/heapam.h"
 #include "access/htup_details.h"
 #if PG_VERSION_NUM >= 120000
-#include "access/heapam.h"
 #include "access/table.h"
+#include "access/tableam.h"
 #endif
 #include "access/sysattr.h"
 #include "access/xact.h"
@@ -32,6 +33,12 @@
 #include "foreign/fdwapi.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
+#if PG_VERSION_NUM >= 120000
+#include "optimizer/optimizer.h"
+#else
+#include "optimizer/clauses.h"
+#endif
+#include "rewrite/rewriteHandler.h"
 #include "utils/builtins.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
@@ -66,12 +73,33 @@ ProtocolVersion		FrontendProtocol = (ProtocolVersion) 0;
 #define PATHMAN_COPY_READ_LOCK		AccessShareLock
 #define PATHMAN_COPY_WRITE_LOCK		RowExclusiveLock
 
+/* Limits of a batch of rows routed by COPY FROM at once */
+#define PATHMAN_COPY_BATCH_SIZE		1000
+#define PATHMAN_COPY_BATCH_BYTES	65535
+
+/*
+ * Error context of PathmanCopyFrom(). Rows are inserted after the whole
+ * batch has been read, so we track their numbers ourselves. CopyState is
+ * opaque, thus we can't tell input lines (e.g. CSV values may span lines).
+ */
+typedef struct
+{
+	CopyState		cstate;
+	const char	   *relname;
+	uint64			cur_rowno;		/* row being inserted, or 0 */
+	uint64			first_rowno,	/* rows of batch being routed, or 0 */
+					last_rowno;
+} PathmanCopyErrorContext;
 
 static uint64 PathmanCopyFrom(CopyState cstate,
 							  Relation parent_rel,
 							  List *range_table,
 							  bool old_protocol);
 
+static void pathman_copy_from_error_callback(void *arg);
+
+static bool copy_from_can_batch(Relation parent_rel);
+
 static void prepare_rri_for_copy(ResultRelInfoHolder *rri_holder,
 								 const ResultPartsStorage *rps_storage);
 
@@ -458,6 +486,7 @@ PathmanDoCopy(const CopyStmt *stmt,
 		cstate = BeginCopyFromCompat(pstate, rel, stmt->filename,
 									 stmt->is_program, NULL, stmt->attlist,
 									 stmt->options);
+
 		*processed = PathmanCopyFrom(cstate, rel, range_table, is_old_protocol);
 		EndCopyFrom(cstate);
 	}
@@ -483,13 +512,30 @@ PathmanCopyFrom(CopyState cstate, Relation parent_rel,
 	Datum			   *values;
 	bool			   *nulls;
 
+	/* Rows are read and routed in batches */
+	TupleTableSlot	  **batch_slots;
+	HeapTuple		   *batch_tuples;
+	ResultRelInfoHolder **batch_holders;
+	uint64			   *batch_rownos;
+	MemoryContext		batch_mcxt;
+	int					batch_size,
+						i;
+	bool				eof = false;
+
+	/* Rows of partitions without triggers are inserted in bulk */
+	CopyMultiInsertInfo	miinfo;
+
+	/* Report numbers of failed rows */
+	PathmanCopyErrorContext	errctx;
+	ErrorContextCallback	errcallback;
+	uint64					rowno = 0;
+
 	ResultPartsStorage	parts_storage;
 	ResultRelInfo	   *parent_rri;
 	Oid					parent_relid = RelationGetRelid(parent_rel);
 
 	MemoryContext		query_mcxt = CurrentMemoryContext;
 	EState			   *estate = CreateExecutorState(); /* for ExecConstraints() */
-	TupleTableSlot	   *myslot;
 
 	uint64				processed = 0;
 
@@ -520,9 +566,7 @@ PathmanCopyFrom(CopyState cstate, Relation parent_rel,
 							  RPS_RRI_CB(prepare_rri_for_copy, cstate),
 							  RPS_RRI_CB(finish_rri_for_copy, NULL));
 
-	/* Set up a tuple slot too */
-	myslot = ExecInitExtraTupleSlotCompat(estate, NULL, &TTSOpsHeapTuple);
-	/* Triggers might need a slot as well */
+	/* Triggers might need a slot */
 #if PG_VERSION_NUM < 120000
 	estate->es_trig_tuple_slot = ExecInitExtraTupleSlotCompat(estate, tupDesc, nothing_here);
 #endif
@@ -541,159 +585,134 @@ PathmanCopyFrom(CopyState cstate, Relation parent_rel,
 	values = (Datum *) palloc(tupDesc->natts * sizeof(Datum));
 	nulls = (bool *) palloc(tupDesc->natts * sizeof(bool));
 
-	for (;;)
+	/* Prepare storage for a batch of rows */
+	batch_size = copy_from_can_batch(parent_rel) ? PATHMAN_COPY_BATCH_SIZE : 1;
+	batch_slots = (TupleTableSlot **) palloc(batch_size * sizeof(TupleTableSlot *));
+	batch_tuples = (HeapTuple *) palloc(batch_size * sizeof(HeapTuple));
+	batch_holders = (ResultRelInfoHolder **) palloc(batch_size * sizeof(ResultRelInfoHolder *));
+	batch_rownos = (uint64 *) palloc(batch_size * sizeof(uint64));
+	batch_mcxt = AllocSetContextCreate(query_mcxt,
+									   "PathmanCopyFrom batch",
+									   ALLOCSET_DEFAULT_SIZES);
+
+	/* Set up tuple slots too */
+	for (i = 0; i < batch_size; i++)
 	{
-		TupleTableSlot		   *slot;
-		bool					skip_tuple = false;
-#if PG_VERSION_NUM < 120000
-		Oid						tuple_oid = InvalidOid;
-#endif
-		ExprContext		 	   *econtext = GetPerTupleExprContext(estate);
+		batch_slots[i] = ExecInitExtraTupleSlotCompat(estate, NULL, &TTSOpsHeapTuple);
+	}
 
-		ResultRelInfoHolder	   *rri_holder;
-		ResultRelInfo		   *child_rri;
+	/* Prepare multi-insert buffers */
+	copy_multi_insert_init(&miinfo, estate);
+	miinfo.cur_rowno = &errctx.cur_rowno;
+
+	/* Set up callback to identify error row number */
+	errctx.cstate = cstate;
+	errctx.relname = RelationGetRelationName(parent_rel);
+	errctx.cur_rowno = 0;
+	errctx.first_rowno = errctx.last_rowno = 0;
+	errcallback.callback = pathman_copy_from_error_callback;
+	errcallback.arg = (void *) &errctx;
+	errcallback.previous = error_context_stack;
+	error_context_stack = &errcallback;
+
+	while (!eof)
+	{
+		int						nbatch = 0;
+		Size					batch_bytes = 0;
 
 		CHECK_FOR_INTERRUPTS();
 
-		ResetPerTupleExprContext(estate);
-
-		/* Switch into per tuple memory context */
-		MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
-
-		if (!NextCopyFromCompat(cstate, econtext, values, nulls, &tuple_oid))
-			break;
-
-		/* We can form the input tuple */
-		tuple = heap_form_tuple(tupDesc, values, nulls);
+		/* Forget previous batch */
+		MemoryContextReset(batch_mcxt);
 
+		/* Read a batch of rows */
+		while (nbatch < batch_size && batch_bytes < PATHMAN_COPY_BATCH_BYTES)
+		{
 #if PG_VERSION_NUM < 120000
-		if (tuple_oid != InvalidOid)
-			HeapTupleSetOid(tuple, tuple_oid);
-#endif
-
-		/* Place tuple in tuple slot --- but slot shouldn't free it */
-		slot = myslot;
-		ExecSetSlotDescriptor(slot, tupDesc);
-#if PG_VERSION_NUM >= 120000
-		ExecStoreHeapTuple(tuple, slot, false);
-#else
-		ExecStoreTuple(tuple, slot, InvalidBuffer, false);
+			Oid					tuple_oid = InvalidOid;
 #endif
+			ExprContext		   *econtext = GetPerTupleExprContext(estate);
+			TupleTableSlot	   *slot = batch_slots[nbatch];
 
-		/* Search for a matching partition */
-		rri_holder = select_partition_for_insert(&parts_storage, slot);
-		child_rri = rri_holder->result_rel_info;
+			ResetPerTupleExprContext(estate);
 
-		/* Magic: replace parent's ResultRelInfo with ours */
-		estate->es_result_relation_info = child_rri;
+			/* Switch into per tuple memory context */
+			MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
 
-		/*
-		 * Constraints might reference the tableoid column, so initialize
-		 * t_tableOid before evaluating them.
-		 */
-		tuple->t_tableOid = RelationGetRelid(child_rri->ri_RelationDesc);
+			if (!NextCopyFromCompat(cstate, econtext, values, nulls, &tuple_oid))
+			{
+				eof = true;
+				break;
+			}
 
-		/* If there's a transform map, rebuild the tuple */
-		if (rri_holder->tuple_map)
-		{
-			HeapTuple tuple_old;
+			/* We can form the input tuple (it should survive the batch) */
+			MemoryContextSwitchTo(batch_mcxt);
+			tuple = heap_form_tuple(tupDesc, values, nulls);
 
-			tuple_old = tuple;
-#if PG_VERSION_NUM >= 120000
-			tuple = execute_attr_map_tuple(tuple, rri_holder->tuple_map);
-#else
-			tuple = do_convert_tuple(tuple, rri_holder->tuple_map);
+#if PG_VERSION_NUM < 120000
+			if (tuple_oid != InvalidOid)
+				HeapTupleSetOid(tuple, tuple_oid);
 #endif
-			heap_freetuple(tuple_old);
-		}
 
-		/* Now we can set proper tuple descriptor according to child relation */
-		ExecSetSlotDescriptor(slot, RelationGetDescr(child_rri->ri_RelationDesc));
+			/* Place tuple in tuple slot --- but slot shouldn't free it */
+			ExecSetSlotDescriptor(slot, tupDesc);
 #if PG_VERSION_NUM >= 120000
-		ExecStoreHeapTuple(tuple, slot, false);
+			ExecStoreHeapTuple(tuple, slot, false);
 #else
-		ExecStoreTuple(tuple, slot, InvalidBuffer, false);
+			ExecStoreTuple(tuple, slot, InvalidBuffer, false);
 #endif
 
-		/* Triggers and stuff need to be invoked in query context. */
-		MemoryContextSwitchTo(query_mcxt);
-
-		/* BEFORE ROW INSERT Triggers */
-		if (child_rri->ri_TrigDesc &&
-			child_rri->ri_TrigDesc->trig_insert_before_row)
-		{
-#if PG_VERSION_NUM >= 120000
-			if (!ExecBRInsertTriggers(estate, child_rri, slot))
-				skip_tuple = true;
-			else	/* trigger might have changed tuple */
-				tuple = ExecFetchSlotHeapTuple(slot, false, NULL);
-#else
-			slot = ExecBRInsertTriggers(estate, child_rri, slot);
-
-			if (slot == NULL)	/* "do nothing" */
-				skip_tuple = true;
-			else	/* trigger might have changed tuple */
-			{
-				tuple = ExecMaterializeSlot(slot);
-			}
-#endif
+			batch_rownos[nbatch] = ++rowno;
+			batch_tuples[nbatch++] = tuple;
+			batch_bytes += tuple->t_len;
 		}
 
-		/* Proceed if we still have a tuple */
-		if (!skip_tuple)
+		/* Search for matching partitions (all at once) */
+		if (nbatch > 0)
 		{
-			List *recheckIndexes = NIL;
+			errctx.first_rowno = batch_rownos[0];
+			errctx.last_rowno = batch_rownos[nbatch - 1];
 
-			/* Check the constraints of the tuple */
-			if (child_rri->ri_RelationDesc->rd_att->constr)
-				ExecConstraints(child_rri, slot, estate);
-
-			/* Handle local tables */
-			if (!child_rri->ri_FdwRoutine)
-			{
-				/* OK, now store the tuple... */
-				simple_heap_insert(child_rri->ri_RelationDesc, tuple);
-#if PG_VERSION_NUM >= 120000 /* since 12, tid lives directly in slot */
-				ItemPointerCopy(&tuple->t_self, &slot->tts_tid);
-				/* and we must stamp tableOid as we go around table_tuple_insert */
-				slot->tts_tableOid = RelationGetRelid(child_rri->ri_RelationDesc);
-#endif
+			MemoryContextSwitchTo(batch_mcxt);
+			select_partitions_for_insert(&parts_storage,
+										 batch_slots, nbatch,
+										 batch_holders);
 
-				/* ... and create index entries for it */
-				if (child_rri->ri_NumIndices > 0)
-					recheckIndexes = ExecInsertIndexTuplesCompat(slot, &(tuple->t_self),
-																 estate, false, NULL, NIL);
-			}
-#ifdef PG_SHARDMAN
-			/* Handle foreign tables */
-			else
-			{
-				child_rri->ri_FdwRoutine->ForeignNextCopyFrom(estate,
-															  child_rri,
-															  cstate);
-			}
-#endif
+			errctx.first_rowno = errctx.last_rowno = 0;
+		}
 
-			/* AFTER ROW INSERT Triggers (FIXME: NULL transition) */
-#if PG_VERSION_NUM >= 120000
-			ExecARInsertTriggersCompat(estate, child_rri, slot,
-									   recheckIndexes, NULL);
-#else
-			ExecARInsertTriggersCompat(estate, child_rri, tuple,
-									   recheckIndexes, NULL);
-#endif
+		for (i = 0; i < nbatch; i++)
+		{
+			CHECK_FOR_INTERRUPTS();
 
-			list_free(recheckIndexes);
+			/* Row has been read some time ago */
+			errctx.cur_rowno = batch_rownos[i];
 
 			/*
 			 * We count only tuples not suppressed by a BEFORE INSERT trigger;
 			 * this is the same definition used by execMain.c for counting
 			 * tuples inserted by an INSERT command.
 			 */
-			processed++;
+			if (copy_insert_routed_tuple(batch_size > 1 ? &miinfo : NULL,
+										 batch_holders[i],
+										 batch_slots[i],
+										 batch_tuples[i],
+										 estate, query_mcxt,
+										 cstate))
+				processed++;
 		}
+
+		/* Next rows are being read */
+		errctx.cur_rowno = 0;
 	}
 
+	/* Insert remaining buffered rows */
+	copy_multi_insert_flush_all(&miinfo);
+	copy_multi_insert_fini(&miinfo);
+
+	/* Done, clean up */
+	error_context_stack = errcallback.previous;
+
 	/* Switch back to query context */
 	MemoryContextSwitchTo(query_mcxt);
 
@@ -710,6 +729,12 @@ PathmanCopyFrom(CopyState cstate, Relation parent_rel,
 	pfree(values);
 	pfree(nulls);
 
+	pfree(batch_slots);
+	pfree(batch_tuples);
+	pfree(batch_holders);
+	pfree(batch_rownos);
+	MemoryContextDelete(batch_mcxt);
+
 	/* Release resources for tuple table */
 	ExecResetTupleTable(estate->es_tupleTable, false);
 
@@ -725,6 +750,443 @@ PathmanCopyFrom(CopyState cstate, Relation parent_rel,
 	return processed;
 }
 
+/*
+ * Error context callback for PathmanCopyFrom().
+ */
+static void
+pathman_copy_from_error_callback(void *arg)
+{
+	PathmanCopyErrorContext *errctx = (PathmanCopyErrorContext *) arg;
+
+	/* Row is being inserted */
+	if (errctx->cur_rowno > 0)
+		errcontext("COPY %s, row " UINT64_FORMAT,
+				   errctx->relname, errctx->cur_rowno);
+
+	/* Batch of rows is being routed */
+	else if (errctx->first_rowno < errctx->last_rowno)
+		errcontext("COPY %s, rows " UINT64_FORMAT " to " UINT64_FORMAT,
+				   errctx->relname, errctx->first_rowno, errctx->last_rowno);
+
+	else if (errctx->first_rowno > 0)
+		errcontext("COPY %s, row " UINT64_FORMAT,
+				   errctx->relname, errctx->first_rowno);
+
+	/* Row is being read, COPY knows better */
+	else CopyFromErrorCallback(errctx->cstate);
+}
+
+/*
+ * Check if PathmanCopyFrom() may read rows ahead of their insertion.
+ */
+static bool
+copy_from_can_batch(Relation parent_rel)
+{
+#ifdef PG_SHARDMAN
+	/* Foreign partitions fetch current row from CopyState themselves */
+	return false;
+#else
+	TupleDesc	tupdesc = RelationGetDescr(parent_rel);
+	int			i;
+
+	/* Volatile defaults might depend on rows inserted earlier */
+	for (i = 0; i < tupdesc->natts; i++)
+	{
+		Node *defexpr;
+
+		if (TupleDescAttr(tupdesc, i)->attisdropped)
+			continue;
+
+		defexpr = build_column_default(parent_rel, i + 1);
+
+		if (defexpr && contain_volatile_functions_not_nextval(defexpr))
+			return false;
+	}
+
+	return true;
+#endif
+}
+
+/*
+ * Insert a row which has been routed to 'rri_holder'. Rows of partitions
+ * without triggers are buffered in 'miinfo' (if any) and inserted in bulk.
+ * Return false if a BEFORE ROW INSERT trigger has suppressed the row.
+ *
+ * NOTE: 'cstate' is only required for foreign partitions (see shardman).
+ */
+bool
+copy_insert_routed_tuple(CopyMultiInsertInfo *miinfo,
+						 ResultRelInfoHolder *rri_holder,
+						 TupleTableSlot *slot,
+						 HeapTuple tuple,
+						 EState *estate,
+						 MemoryContext query_mcxt,
+						 CopyState cstate)
+{
+	ResultRelInfo  *child_rri = rri_holder->result_rel_info;
+	List		   *recheckIndexes = NIL;
+	bool			use_multi_insert;
+
+	/* Can we put this row into a multi-insert buffer? */
+	use_multi_insert = (miinfo && copy_multi_insert_allowed(child_rri));
+
+	/* Triggers should see all rows inserted before this one */
+	if (miinfo && !use_multi_insert)
+		copy_multi_insert_flush_all(miinfo);
+
+	ResetPerTupleExprContext(estate);
+
+	/* Switch into per tuple memory context */
+	MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
+
+	/* Magic: replace parent's ResultRelInfo with ours */
+	estate->es_result_relation_info = child_rri;
+
+	/*
+	 * Constraints might reference the tableoid column, so initialize
+	 * t_tableOid before evaluating them.
+	 */
+	tuple->t_tableOid = RelationGetRelid(child_rri->ri_RelationDesc);
+
+	/* If there's a transform map, rebuild the tuple */
+	if (rri_holder->tuple_map)
+	{
+		HeapTuple tuple_old;
+
+		tuple_old = tuple;
+#if PG_VERSION_NUM >= 120000
+		tuple = execute_attr_map_tuple(tuple, rri_holder->tuple_map);
+#else
+		tuple = do_convert_tuple(tuple, rri_holder->tuple_map);
+#endif
+		heap_freetuple(tuple_old);
+	}
+
+	/* Now we can set proper tuple descriptor according to child relation */
+	ExecSetSlotDescriptor(slot, RelationGetDescr(child_rri->ri_RelationDesc));
+#if PG_VERSION_NUM >= 120000
+	ExecStoreHeapTuple(tuple, slot, false);
+#else
+	ExecStoreTuple(tuple, slot, InvalidBuffer, false);
+#endif
+
+	/* Triggers and stuff need to be invoked in query context. */
+	MemoryContextSwitchTo(query_mcxt);
+
+	/* BEFORE ROW INSERT Triggers */
+	if (child_rri->ri_TrigDesc &&
+		child_rri->ri_TrigDesc->trig_insert_before_row)
+	{
+#if PG_VERSION_NUM >= 120000
+		if (!ExecBRInsertTriggers(estate, child_rri, slot))
+			return false;
+
+		/* trigger might have changed tuple */
+		tuple = ExecFetchSlotHeapTuple(slot, false, NULL);
+#else
+		slot = ExecBRInsertTriggers(estate, child_rri, slot);
+
+		if (slot == NULL)	/* "do nothing" */
+			return false;
+
+		/* trigger might have changed tuple */
+		tuple = ExecMaterializeSlot(slot);
+#endif
+	}
+
+	/* Check the constraints of the tuple */
+	if (child_rri->ri_RelationDesc->rd_att->constr)
+		ExecConstraints(child_rri, slot, estate);
+
+	/* Insert it later along with other rows */
+	if (use_multi_insert)
+	{
+		copy_multi_insert_add(miinfo, rri_holder, tuple);
+		return true;
+	}
+
+	/* Handle local tables */
+	if (!child_rri->ri_FdwRoutine)
+	{
+		/* OK, now store the tuple... */
+		simple_heap_insert(child_rri->ri_RelationDesc, tuple);
+#if PG_VERSION_NUM >= 120000 /* since 12, tid lives directly in slot */
+		ItemPointerCopy(&tuple->t_self, &slot->tts_tid);
+		/* and we must stamp tableOid as we go around table_tuple_insert */
+		slot->tts_tableOid = RelationGetRelid(child_rri->ri_RelationDesc);
+#endif
+
+		/* ... and create index entries for it */
+		if (child_rri->ri_NumIndices > 0)
+			recheckIndexes = ExecInsertIndexTuplesCompat(slot, &(tuple->t_self),
+														 estate, false, NULL, NIL);
+	}
+#ifdef PG_SHARDMAN
+	/* Handle foreign tables */
+	else
+	{
+		child_rri->ri_FdwRoutine->ForeignNextCopyFrom(estate,
+													  child_rri,
+													  cstate);
+	}
+#endif
+
+	/* AFTER ROW INSERT Triggers (FIXME: NULL transition) */
+#if PG_VERSION_NUM >= 120000
+	ExecARInsertTriggersCompat(estate, child_rri, slot,
+							   recheckIndexes, NULL);
+#else
+	ExecARInsertTriggersCompat(estate, child_rri, tuple,
+							   recheckIndexes, NULL);
+#endif
+
+	list_free(recheckIndexes);
+
+	return true;
+}
+
+/*
+ * Prepare multi-insert buffers for PathmanCopyFrom().
+ */
+void
+copy_multi_insert_init(CopyMultiInsertInfo *miinfo, EState *estate)
+{
+	memset(miinfo, 0, sizeof(CopyMultiInsertInfo));
+
+	miinfo->estate = estate;
+	miinfo->mycid = GetCurrentCommandId(true);
+	miinfo->mcxt = AllocSetContextCreate(CurrentMemoryContext,
+										 "PathmanCopyFrom multi-insert",
+										 ALLOCSET_DEFAULT_SIZES);
+}
+
+/*
+ * Release multi-insert buffers (they should be flushed by now).
+ */
+void
+copy_multi_insert_fini(CopyMultiInsertInfo *miinfo)
+{
+	int i;
+
+	for (i = 0; i < miinfo->nbuffers; i++)
+	{
+		Assert(miinfo->buffers[i]->ntuples == 0);
+		FreeBulkInsertState(miinfo->buffers[i]->bistate);
+	}
+
+	for (i = 0; i < PATHMAN_COPY_BUFFER_TUPLES; i++)
+	{
+		if (miinfo->slots[i])
+			ExecDropSingleTupleTableSlot(miinfo->slots[i]);
+	}
+
+	MemoryContextDelete(miinfo->mcxt);
+}
+
+/*
+ * Check if rows of this partition might be inserted in bulk.
+ */
+bool
+copy_multi_insert_allowed(const ResultRelInfo *rri)
+{
+	TriggerDesc *trigdesc = rri->ri_TrigDesc;
+
+	/* Foreign tables don't support heap_multi_insert() */
+	if (rri->ri_FdwRoutine)
+		return false;
+
+	/* Row triggers should see rows one by one */
+	if (trigdesc && (trigdesc->trig_insert_before_row ||
+					 trigdesc->trig_insert_after_row ||
+					 trigdesc->trig_insert_instead_row))
+		return false;
+
+	return true;
+}
+
+/*
+ * Add a row to multi-insert buffer of its partition.
+ */
+void
+copy_multi_insert_add(CopyMultiInsertInfo *miinfo,
+					  ResultRelInfoHolder *rri_holder,
+					  HeapTuple tuple)
+{
+	CopyMultiInsertBuffer  *buffer = NULL;
+	MemoryContext			old_mcxt;
+	int						i;
+
+	/* Search for the buffer of this partition */
+	for (i = 0; i < miinfo->nbuffers; i++)
+	{
+		if (miinfo->buffers[i]->rri_holder == rri_holder)
+		{
+			buffer = miinfo->buffers[i];
+			break;
+		}
+	}
+
+	/* Create a new buffer if needed */
+	if (!buffer)
+	{
+		/* No room for a new buffer, throw away the least recently used one */
+		if (miinfo->nbuffers == PATHMAN_COPY_MAX_BUFFERS)
+		{
+			int lru = 0;
+
+			for (i = 1; i < miinfo->nbuffers; i++)
+				if (miinfo->buffers[i]->last_used < miinfo->buffers[lru]->last_used)
+					lru = i;
+
+			buffer = miinfo->buffers[lru];
+			copy_multi_insert_flush(miinfo, buffer);
+			FreeBulkInsertState(buffer->bistate);
+		}
+		else
+		{
+			buffer = MemoryContextAlloc(miinfo->mcxt, sizeof(CopyMultiInsertBuffer));
+			buffer->mcxt = AllocSetContextCreate(miinfo->mcxt,
+												 "PathmanCopyFrom buffer",
+												 ALLOCSET_DEFAULT_SIZES);
+
+			miinfo->buffers[miinfo->nbuffers++] = buffer;
+		}
+
+		buffer->rri_holder = rri_holder;
+		buffer->bistate = GetBulkInsertState();
+		buffer->ntuples = 0;
+		buffer->nbytes = 0;
+	}
+
+	/* Save a copy of tuple (and its row number, if any) */
+	old_mcxt = MemoryContextSwitchTo(buffer->mcxt);
+	buffer->rownos[buffer->ntuples] = miinfo->cur_rowno ? *miinfo->cur_rowno : 0;
+	buffer->tuples[buffer->ntuples++] = heap_copytuple(tuple);
+	MemoryContextSwitchTo(old_mcxt);
+
+	buffer->nbytes += tuple->t_len;
+	buffer->last_used = ++miinfo->clock;
+	miinfo->nbytes += tuple->t_len;
+
+	/* Flush buffer if it's full */
+	if (buffer->ntuples == PATHMAN_COPY_BUFFER_TUPLES ||
+		buffer->nbytes >= PATHMAN_COPY_BUFFER_BYTES)
+		copy_multi_insert_flush(miinfo, buffer);
+
+	/* Flush least recently used buffers until we fit into memory budget */
+	while (miinfo->nbytes > PATHMAN_COPY_MAX_BYTES)
+	{
+		CopyMultiInsertBuffer *lru = NULL;
+
+		for (i = 0; i < miinfo->nbuffers; i++)
+		{
+			CopyMultiInsertBuffer *cur = miinfo->buffers[i];
+
+			if (cur->ntuples > 0 && (!lru || cur->last_used < lru->last_used))
+				lru = cur;
+		}
+
+		Assert(lru);
+		copy_multi_insert_flush(miinfo, lru);
+	}
+}
+
+/*
+ * Insert buffered rows into partition.
+ */
+void
+copy_multi_insert_flush(CopyMultiInsertInfo *miinfo,
+						CopyMultiInsertBuffer *buffer)
+{
+	EState		   *estate = miinfo->estate;
+	ResultRelInfo  *child_rri = buffer->rri_holder->result_rel_info;
+	Relation		child_rel = child_rri->ri_RelationDesc;
+	TupleDesc		child_tupdesc = RelationGetDescr(child_rel);
+	MemoryContext	old_mcxt;
+	uint64			save_rowno = 0;
+	int				i;
+
+	if (buffer->ntuples == 0)
+		return;
+
+	/* Errors should point to buffered rows, not to the current one */
+	if (miinfo->cur_rowno)
+		save_rowno = *miinfo->cur_rowno;
+
+	/* Place tuples into slots */
+	for (i = 0; i < buffer->ntuples; i++)
+	{
+		if (!miinfo->slots[i])
+		{
+			old_mcxt = MemoryContextSwitchTo(miinfo->mcxt);
+			miinfo->slots[i] = MakeTupleTableSlotCompat(&TTSOpsHeapTuple);
+			MemoryContextSwitchTo(old_mcxt);
+		}
+
+		if (miinfo->slots[i]->tts_tupleDescriptor != child_tupdesc)
+			ExecSetSlotDescriptor(miinfo->slots[i], child_tupdesc);
+
+#if PG_VERSION_NUM >= 120000
+		ExecStoreHeapTuple(buffer->tuples[i], miinfo->slots[i], false);
+#else
+		ExecStoreTuple(buffer->tuples[i], miinfo->slots[i], InvalidBuffer, false);
+#endif
+	}
+
+	/* Insert all tuples at once */
+	old_mcxt = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
+	MultiInsertCompat(child_rel, miinfo->slots, buffer->tuples, buffer->ntuples,
+					  miinfo->mycid, 0, buffer->bistate);
+	MemoryContextSwitchTo(old_mcxt);
+
+	/* Create index entries for them */
+	if (child_rri->ri_NumIndices > 0)
+	{
+		/* Magic: replace parent's ResultRelInfo with ours */
+		estate->es_result_relation_info = child_rri;
+
+		for (i = 0; i < buffer->ntuples; i++)
+		{
+			List *recheckIndexes;
+
+			ResetPerTupleExprContext(estate);
+
+			if (miinfo->cur_rowno)
+				*miinfo->cur_rowno = buffer->rownos[i];
+
+			/* There're no AFTER ROW triggers to process 'recheckIndexes' */
+			recheckIndexes = ExecInsertIndexTuplesCompat(miinfo->slots[i],
+														 &(buffer->tuples[i]->t_self),
+														 estate, false, NULL, NIL);
+			list_free(recheckIndexes);
+		}
+	}
+
+	if (miinfo->cur_rowno)
+		*miinfo->cur_rowno = save_rowno;
+
+	/* Slots shouldn't point to tuples we're about to free */
+	for (i = 0; i < buffer->ntuples; i++)
+		ExecClearTuple(miinfo->slots[i]);
+
+	miinfo->nbytes -= buffer->nbytes;
+	buffer->nbytes = 0;
+	buffer->ntuples = 0;
+	MemoryContextReset(buffer->mcxt);
+}
+
+/*
+ * Insert rows of all multi-insert buffers.
+ */
+void
+copy_multi_insert_flush_all(CopyMultiInsertInfo *miinfo)
+{
+	int i;
+
+	for (i = 0; i < miinfo->nbuffers; i++)
+		copy_multi_insert_flush(miinfo, miinfo->buffers[i]);
+}
+
 /*
  * Init COPY FROM, if supported.
  */
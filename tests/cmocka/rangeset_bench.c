@@ -0,0 +1,161 @@
+/* ------------------------------------------------------------------------
+ *
+ * rangeset_bench.c
+ *		Compare List-based and bitmap-based rangesets
+ *
+ * Each workload folds a set of per-qual rangesets the same way
+ * handle_boolexpr() does, including conversion to and from Lists
+ * for IndexRangeBitmaps.
+ *
+ * ------------------------------------------------------------------------
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "rangeset.h"
+#include "undef_printf.h"
+
+
+#define BENCH_LOOPS 200
+
+typedef struct
+{
+	const char *name;
+	bool		is_or;		/* OR_EXPR or AND_EXPR */
+	uint32		nparts;		/* number of partitions */
+	int			nargs;		/* number of quals */
+	int			max_gap;	/* max gap between IndexRanges */
+	int			max_len;	/* max length of IndexRange */
+	int			nranges;	/* max number of IndexRanges per qual */
+} Workload;
+
+static const Workload workloads[] =
+{
+	/* col = 1 OR col = 2 OR ... (HASH) */
+	{ "hash_or_64",			true,	1024,	64,		1024,	1,		1 },
+	{ "hash_or_512",		true,	1024,	512,	1024,	1,		1 },
+
+	/* small OR over a couple of RANGE partitions */
+	{ "range_or_2",			true,	1024,	2,		1024,	4,		1 },
+
+	/* (dt BETWEEN ... AND ...) OR ... (RANGE) */
+	{ "range_or_32",		true,	1024,	32,		1024,	16,		1 },
+
+	/* (col IN (...)) AND (col IN (...)) (HASH) */
+	{ "hash_and_of_in",		false,	1024,	4,		4,		2,		1024 },
+};
+
+
+static double
+now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Generate a rangeset of a single qual */
+static List *
+make_qual_rangeset(const Workload *w)
+{
+	List   *result = NIL;
+	uint32	i = random() % w->max_gap;
+	int		n = 0;
+
+	while (i < w->nparts && n++ < w->nranges)
+	{
+		uint32	len = random() % w->max_len,
+				upper = Min(i + len, w->nparts - 1);
+
+		result = lappend_irange(result, make_irange(i, upper, random() % 2));
+		i = upper + 2 + random() % w->max_gap;
+	}
+
+	return result;
+}
+
+static List *
+fold_lists(const Workload *w, List **quals)
+{
+	List   *result = w->is_or ?
+						NIL :
+						list_make1_irange(make_irange(0, w->nparts - 1,
+													  IR_COMPLETE));
+	int		i;
+
+	for (i = 0; i < w->nargs; i++)
+		result = w->is_or ?
+					irange_list_union(result, quals[i]) :
+					irange_list_intersection(result, quals[i]);
+
+	return result;
+}
+
+static List *
+fold_bitmaps(const Workload *w, List **quals)
+{
+	IndexRangeBitmap   *result = irange_bitmap_create(w->nparts),
+					   *arg = irange_bitmap_create(w->nparts);
+	int					i;
+
+	if (!w->is_or)
+		irange_bitmap_fill(result,
+						   list_make1_irange(make_irange(0, w->nparts - 1,
+														 IR_COMPLETE)));
+
+	for (i = 0; i < w->nargs; i++)
+	{
+		irange_bitmap_fill(arg, quals[i]);
+
+		if (w->is_or)
+			irange_bitmap_union(result, arg);
+		else
+			irange_bitmap_intersection(result, arg);
+	}
+
+	return irange_bitmap_to_list(result);
+}
+
+int
+main(void)
+{
+	int i;
+
+	srandom(42);
+
+	printf("%-16s %12s %12s %8s\n",
+		   "workload", "list, ns", "bitmap, ns", "cells");
+
+	for (i = 0; i < lengthof(workloads); i++)
+	{
+		const Workload *w = &workloads[i];
+		List		  **quals = palloc(sizeof(List *) * w->nargs);
+		List		   *result = NIL;
+		double			start,
+						list_ns,
+						bitmap_ns;
+		int				j;
+
+		for (j = 0; j < w->nargs; j++)
+			quals[j] = make_qual_rangeset(w);
+
+		start = now_ns();
+		for (j = 0; j < BENCH_LOOPS; j++)
+			result = fold_lists(w, quals);
+		list_ns = (now_ns() - start) / BENCH_LOOPS;
+
+		start = now_ns();
+		for (j = 0; j < BENCH_LOOPS; j++)
+			fold_bitmaps(w, quals);
+		bitmap_ns = (now_ns() - start) / BENCH_LOOPS;
+
+		printf("%-16s %12.0f %12.0f %8d\n",
+			   w->name, list_ns, bitmap_ns, list_length(result));
+	}
+
+	return 0;
+}
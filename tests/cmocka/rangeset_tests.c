@@ -2,6 +2,7 @@
 #include <stddef.h>
 #include <setjmp.h>
 #include <cmocka.h>
+#include <stdlib.h>
 
 #include "rangeset.h"
 
@@ -25,6 +26,9 @@ static void test_irange_list_union_intersecting(void **state);
 
 static void test_irange_list_intersection(void **state);
 
+static void test_irange_bitmap_basic(void **state);
+static void test_irange_bitmap_vs_list(void **state);
+
 
 /* Entrypoint */
 int
@@ -40,6 +44,8 @@ main(void)
 		cmocka_unit_test(test_irange_list_union_complete_cov),
 		cmocka_unit_test(test_irange_list_union_intersecting),
 		cmocka_unit_test(test_irange_list_intersection),
+		cmocka_unit_test(test_irange_bitmap_basic),
+		cmocka_unit_test(test_irange_bitmap_vs_list),
 	};
 
 	/* Run series of tests */
@@ -533,3 +539,128 @@ test_irange_list_intersection(void **state)
 	assert_string_equal(rangeset_print(intersection_result),
 						"21L, [22-25]C");
 }
+
+
+/* Generate a random normalized rangeset for 'nbits' partitions */
+static List *
+random_rangeset(uint32 nbits, int max_gap, int max_len)
+{
+	List   *result = NIL;
+	uint32	i = random() % (max_gap + 1);
+
+	while (i < nbits)
+	{
+		uint32	len = random() % max_len,
+				upper = Min(i + len, nbits - 1);
+
+		result = lappend_irange(result, make_irange(i, upper, random() % 2));
+		i = upper + 1 + random() % (max_gap + 1);
+	}
+
+	/* Unite adjacent IndexRanges */
+	return irange_list_union(result, NIL);
+}
+
+/* Print rangeset with all adjacent IndexRanges united */
+static char *
+rangeset_print_normalized(List *rangeset)
+{
+	return rangeset_print(irange_list_union(rangeset, NIL));
+}
+
+/* Basic IndexRangeBitmap tests */
+static void
+test_irange_bitmap_basic(void **state)
+{
+	IndexRangeBitmap   *a, *b;
+	List			   *left_list,
+					   *right_list;
+
+
+	/* Round trip across word boundaries */
+	left_list = NIL;
+	left_list = lappend_irange(left_list, make_irange(0, 0, IR_COMPLETE));
+	left_list = lappend_irange(left_list, make_irange(1, 62, IR_LOSSY));
+	left_list = lappend_irange(left_list, make_irange(63, 64, IR_COMPLETE));
+	left_list = lappend_irange(left_list, make_irange(100, 199, IR_LOSSY));
+
+	a = irange_bitmap_from_list(left_list, 200);
+	assert_int_equal(a->nwords, 4);
+	assert_string_equal(rangeset_print(irange_bitmap_to_list(a)),
+						"0C, [1-62]L, [63-64]C, [100-199]L");
+
+	/* Empty bitmap */
+	a = irange_bitmap_create(10);
+	assert_string_equal(rangeset_print(irange_bitmap_to_list(a)), "");
+
+	/* Union: complete partitions win */
+	left_list = NIL;
+	left_list = lappend_irange(left_list, make_irange(0, 45, IR_COMPLETE));
+	left_list = lappend_irange(left_list, make_irange(64, 100, IR_COMPLETE));
+	right_list = list_make1_irange(make_irange(40, 65, IR_LOSSY));
+
+	a = irange_bitmap_from_list(left_list, 128);
+	b = irange_bitmap_from_list(right_list, 128);
+	irange_bitmap_union(a, b);
+
+	assert_string_equal(rangeset_print(irange_bitmap_to_list(a)),
+						"[0-45]C, [46-63]L, [64-100]C");
+
+	/* Intersection: lossy partitions win */
+	left_list = NIL;
+	left_list = lappend_irange(left_list, make_irange(0, 11, IR_LOSSY));
+	left_list = lappend_irange(left_list, make_irange(12, 20, IR_COMPLETE));
+	right_list = NIL;
+	right_list = lappend_irange(right_list, make_irange(1, 15, IR_COMPLETE));
+	right_list = lappend_irange(right_list, make_irange(16, 20, IR_LOSSY));
+
+	a = irange_bitmap_from_list(left_list, 21);
+	b = irange_bitmap_from_list(right_list, 21);
+	irange_bitmap_intersection(a, b);
+
+	assert_string_equal(rangeset_print(irange_bitmap_to_list(a)),
+						"[1-11]L, [12-15]C, [16-20]L");
+
+	/* Refill replaces previous contents */
+	irange_bitmap_fill(a, list_make1_irange(make_irange(20, 20, IR_LOSSY)));
+	assert_string_equal(rangeset_print(irange_bitmap_to_list(a)), "20L");
+}
+
+/* Bitmaps should always produce the same rangesets as Lists */
+static void
+test_irange_bitmap_vs_list(void **state)
+{
+	const uint32	nbits_variants[] = { 1, 63, 64, 65, 1024 };
+	int				i, j;
+
+	srandom(42);
+
+	for (i = 0; i < lengthof(nbits_variants); i++)
+	{
+		uint32 nbits = nbits_variants[i];
+
+		for (j = 0; j < 200; j++)
+		{
+			List			   *left_list = random_rangeset(nbits, 8, 8),
+							   *right_list = random_rangeset(nbits, 8, 8);
+			IndexRangeBitmap   *a, *b;
+
+			/* Union */
+			a = irange_bitmap_from_list(left_list, nbits);
+			b = irange_bitmap_from_list(right_list, nbits);
+			irange_bitmap_union(a, b);
+
+			assert_string_equal(rangeset_print(irange_bitmap_to_list(a)),
+								rangeset_print_normalized(
+									irange_list_union(left_list, right_list)));
+
+			/* Intersection */
+			irange_bitmap_fill(a, left_list);
+			irange_bitmap_intersection(a, b);
+
+			assert_string_equal(rangeset_print(irange_bitmap_to_list(a)),
+								rangeset_print_normalized(
+									irange_list_intersection(left_list, right_list)));
+		}
+	}
+}
@@ -142,6 +142,199 @@ class Tests(unittest.TestCase):
             self.assertEqual(data[0][0], 300000)
             node.stop()
 
+    def test_concurrent_stop(self):
+        """ Test stopping concurrent partitioning split between several workers """
+
+        with self.start_new_pathman_cluster() as node:
+            node.safe_psql("""
+                create table conc_stop(id int not null, t text);
+                insert into conc_stop select generate_series(1, 10000);
+                select create_range_partitions('conc_stop', 'id', 1, 1000, 10, false);
+            """)
+
+            with node.connect() as con1, node.connect() as con2:
+                # Workers won't be able to move any rows
+                con1.begin()
+                con1.execute('select * from only conc_stop for update')
+
+                con2.execute('set pg_pathman.concurrent_part_workers = 4')
+                con2.execute("select partition_table_concurrently('conc_stop', 100, 0.5)")
+                con2.commit()
+
+                # Let every worker fail at least once
+                time.sleep(2)
+
+                con2.execute("select stop_concurrent_part_task('conc_stop')")
+                con2.commit()
+
+                # All workers (not only the first one) should quit shortly
+                restarted = False
+                for _ in range(20):
+                    try:
+                        con2.execute("select partition_table_concurrently('conc_stop', 100, 0.5)")
+                        con2.commit()
+                        restarted = True
+                        break
+                    except Exception as e:
+                        self.assertIn('is already being partitioned', str(e))
+                        con2.rollback()
+                        time.sleep(0.5)
+
+                self.assertTrue(restarted)
+
+                # Nothing has been moved while rows were locked
+                self.assertEqual(
+                    con2.execute('select count(*) from only conc_stop')[0][0],
+                    10000)
+                con2.commit()
+
+                con1.rollback()
+
+            # Restarted task should move all rows
+            for _ in range(120):
+                count = node.execute("""
+                    select count(*) from pathman_concurrent_part_tasks
+                """)
+
+                if count[0][0] == 0:
+                    break
+                time.sleep(0.5)
+
+            self.assertEqual(
+                node.execute('select count(*) from only conc_stop')[0][0], 0)
+            self.assertEqual(
+                node.execute('select count(*) from conc_stop')[0][0], 10000)
+
+    def test_native_data_mover(self):
+        """ Test concurrent partitioning which moves rows without SPI """
+
+        with self.start_new_pathman_cluster() as node:
+            node.safe_psql("""
+                create table mover(id int not null, moved bool default false);
+                insert into mover select generate_series(1, 10000);
+                select create_range_partitions('mover', 'id', 1, 1000, 10, false);
+
+                create table mover_log(rel text);
+
+                create function mover_before() returns trigger as $$
+                begin
+                    new.moved = true;
+                    return new;
+                end
+                $$ language plpgsql;
+
+                create function mover_after() returns trigger as $$
+                begin
+                    insert into mover_log values (tg_table_name);
+                    return null;
+                end
+                $$ language plpgsql;
+
+                do $$
+                declare
+                    part regclass;
+                begin
+                    for part in select partition from pathman_partition_list
+                                where parent = 'mover'::regclass
+                    loop
+                        execute format('create trigger mover_before before insert
+                                        on %s for each row
+                                        execute procedure mover_before()', part);
+                        execute format('create trigger mover_after after insert
+                                        on %s for each row
+                                        execute procedure mover_after()', part);
+                    end loop;
+                end
+                $$;
+            """)
+
+            def wait_for_tasks():
+                for _ in range(120):
+                    count = node.execute("""
+                        select count(*) from pathman_concurrent_part_tasks
+                    """)
+
+                    if count[0][0] == 0:
+                        break
+                    time.sleep(0.5)
+
+                self.assertEqual(
+                    node.execute("""
+                        select count(*) from pathman_concurrent_part_tasks
+                    """)[0][0], 0)
+
+            with node.connect() as con1, node.connect() as con2:
+                # Locked rows make workers retry the batch
+                con1.begin()
+                con1.execute('select * from only mover where id <= 100 for update')
+
+                con2.execute("select partition_table_concurrently('mover', 500, 0.2)")
+                con2.commit()
+
+                time.sleep(2)
+                con1.commit()
+
+                # Concurrent updates should neither be lost nor duplicated
+                for _ in range(5):
+                    con1.execute("""
+                        update mover set id = id
+                        where id in (select (random() * 10000)::int + 1
+                                     from generate_series(1, 100))
+                    """)
+                    con1.commit()
+
+            wait_for_tasks()
+
+            self.assertEqual(
+                node.execute('select count(*) from only mover')[0][0], 0)
+            self.assertEqual(
+                node.execute('select count(*), count(distinct id) from mover')[0],
+                (10000, 10000))
+
+            # Row triggers of partitions fire exactly once per moved row
+            self.assertEqual(
+                node.execute('select count(*) from mover where not moved')[0][0], 0)
+            self.assertEqual(
+                node.execute("""
+                    select l.rel, count(*) from mover_log l
+                    group by 1 order by 1
+                """),
+                node.execute("""
+                    select tableoid::regclass::text, count(*) from mover
+                    group by 1 order by 1
+                """))
+
+            # Triggers of parent require SPI, where rows are deleted by DELETE
+            node.safe_psql("""
+                create table mover_trig(id int not null);
+                insert into mover_trig select generate_series(1, 1000);
+                select create_range_partitions('mover_trig', 'id', 1, 100, 10, false);
+
+                create function mover_delete() returns trigger as $$
+                begin
+                    insert into mover_log values ('deleted');
+                    return old;
+                end
+                $$ language plpgsql;
+
+                create trigger mover_delete before delete on mover_trig
+                for each row execute procedure mover_delete();
+
+                select partition_table_concurrently('mover_trig', 100, 0);
+            """)
+
+            wait_for_tasks()
+
+            self.assertEqual(
+                node.execute('select count(*) from only mover_trig')[0][0], 0)
+            self.assertEqual(
+                node.execute('select count(*) from mover_trig')[0][0], 1000)
+            self.assertEqual(
+                node.execute("""
+                    select count(*) from mover_log
+                    where rel = 'deleted'
+                """)[0][0], 1000)
+
     def test_replication(self):
         """ Test how pg_pathman works with replication """
 
@@ -434,6 +627,100 @@ class Tests(unittest.TestCase):
                 b'1|\n2|\n5|\n6|\n8|\n9|\n3|\n4|\n7|\n10|\n')
             master.safe_psql("select drop_partitions('hash_test')")
 
+    @unittest.skipUnless(is_postgres_fdw_ready(), 'FDW might be missing')
+    def test_runtime_append_foreign(self):
+        """ Test RuntimeAppend over foreign partitions (lazy child init) """
+
+        with get_new_node() as master, get_new_node() as fserv:
+            master.init()
+            master.append_conf("""
+                shared_preload_libraries='pg_pathman, postgres_fdw'\n
+            """)
+            master.start()
+            master.psql('create extension pg_pathman')
+            master.psql('create extension postgres_fdw')
+
+            master.safe_psql("""
+                create table abc(id int not null, name text);
+                select create_range_partitions('abc', 'id', 0, 10, 2);
+                insert into abc select i, 'local' from generate_series(0, 19) i;
+            """)
+
+            username = master.execute('select current_user')[0][0]
+
+            fserv.init().start()
+            fserv.safe_psql("create table ftable(id int not null, name text)")
+            fserv.safe_psql("insert into ftable values (25, 'foreign')")
+
+            master.safe_psql("""
+                create server fserv
+                foreign data wrapper postgres_fdw
+                options (dbname 'postgres', host '127.0.0.1', port '{}')
+            """.format(fserv.port))
+
+            master.safe_psql("""
+                create user mapping for {0} server fserv
+                options (user '{0}')
+            """.format(username))
+
+            master.safe_psql("""
+                import foreign schema public limit to (ftable)
+                from server fserv into public
+            """)
+
+            master.safe_psql(
+                "select attach_range_partition('abc', 'ftable', 20, 30)")
+
+            # Child plan states are created on demand, make sure that
+            # foreign children are still moved to the end on each rescan
+            query = """
+                set enable_hashjoin = f;
+                set enable_mergejoin = f;
+                set enable_material = f;
+                select v.x, t.id, t.name
+                from (values (25), (5), (15)) v(x)
+                cross join lateral
+                    (select * from abc
+                     where abc.id = any(array[v.x, v.x - 10, v.x + 10])
+                     limit 1) t
+                order by v.x;
+            """
+
+            plan = master.safe_psql("""
+                set enable_hashjoin = f;
+                set enable_mergejoin = f;
+                set enable_material = f;
+                explain (costs off)
+                select v.x, t.id, t.name
+                from (values (25), (5), (15)) v(x)
+                cross join lateral
+                    (select * from abc
+                     where abc.id = any(array[v.x, v.x - 10, v.x + 10])
+                     limit 1) t
+                order by v.x;
+            """)
+            self.assertIn(b'RuntimeAppend', plan)
+
+            # Local partitions are always scanned before foreign ones
+            self.assertEqual(
+                master.safe_psql(query),
+                b'5|5|local\n15|5|local\n25|15|local\n')
+
+            # Only the foreign partition is selected
+            self.assertEqual(
+                master.safe_psql("""
+                    set enable_hashjoin = f;
+                    set enable_mergejoin = f;
+                    select v.x, t.id, t.name
+                    from (values (25), (26)) v(x)
+                    cross join lateral
+                        (select * from abc where abc.id = v.x) t
+                    order by v.x;
+                """),
+                b'25|25|foreign\n')
+
+            master.safe_psql("select drop_partitions('abc')")
+
     @unittest.skipUnless(is_postgres_fdw_ready(), 'FDW might be missing')
     def test_parallel_nodes(self):
         """ Test parallel queries under partitions """
@@ -626,11 +913,76 @@ class Tests(unittest.TestCase):
                 """)
                 self.assertEqual(ordered(plan), ordered(expected))
 
+                # Parallel RuntimeAppend is available since 11
+                if version >= LooseVersion('11'):
+                    self.check_parallel_runtime_append(con)
+
             # Remove all objects for testing
             node.psql('drop table range_partitioned cascade')
             node.psql('drop table hash_partitioned cascade')
             node.psql('drop extension pg_pathman cascade')
 
+    def check_parallel_runtime_append(self, con):
+        """ Check RuntimeAppend under Gather (see test_parallel_nodes) """
+
+        def find_nodes(plan, node_type, parents=()):
+            res = []
+            if plan['Node Type'] == node_type or \
+               plan.get('Custom Plan Provider') == node_type:
+                res.append((plan, parents))
+            for child in plan.get('Plans', []):
+                res += find_nodes(child, node_type, parents + (plan, ))
+            return res
+
+        def explain(query, analyze=False):
+            options = 'analyze, costs off, timing off' if analyze else 'costs off'
+            plan = con.execute(
+                "explain ({}, format json) {}".format(options, query))[0][0]
+            if not isinstance(plan, list):
+                plan = json.loads(plan)
+            return plan[0]['Plan']
+
+        # Partitions are pruned using value of InitPlan
+        query = """
+            select count(*) from range_partitioned
+            where i < (select 1500)
+        """
+        nodes = find_nodes(explain(query), 'RuntimeAppend')
+        self.assertEqual(len(nodes), 1)
+
+        ra_plan, ra_parents = nodes[0]
+        self.assertIn('Gather', [p['Node Type'] for p in ra_parents])
+        self.assertTrue(ra_plan['Parallel Aware'])
+        self.assertEqual(con.execute(query)[0][0], 1499)
+
+        # Rel has join clauses, and Gather is rescanned for each outer row
+        con.execute('set enable_hashjoin = off')
+        con.execute('set enable_mergejoin = off')
+        con.execute('set enable_material = off')
+
+        query = """
+            select v.x, count(r.i)
+            from (values (1), (2), (3)) v(x)
+            left join (select * from range_partitioned
+                       where i < (select 1500)) r
+            on r.i % 3 = v.x - 1
+            group by v.x order by v.x
+        """
+        plan = explain(query, analyze=True)
+        nodes = find_nodes(plan, 'RuntimeAppend')
+        self.assertEqual(len(nodes), 1)
+
+        gathers = [p for p in nodes[0][1] if p['Node Type'] == 'Gather']
+        self.assertEqual(len(gathers), 1)
+        self.assertEqual(gathers[0]['Parent Relationship'], 'Inner')
+        self.assertEqual(gathers[0]['Actual Loops'], 3)
+
+        self.assertEqual(con.execute(query), [(1, 499), (2, 500), (3, 500)])
+
+        con.execute('reset enable_hashjoin')
+        con.execute('reset enable_mergejoin')
+        con.execute('reset enable_material')
+
     def test_conc_part_drop_runtime_append(self):
         """ Test concurrent partition drop + SELECT (RuntimeAppend) """
 
@@ -993,6 +1345,409 @@ class Tests(unittest.TestCase):
                         inserts with append partition is expired
                     """)
 
+    def test_spawn_pool(self):
+        """ Test pool of SpawnPartitionsWorkers """
+
+        with get_new_node() as node:
+            node.init()
+            node.append_conf("shared_preload_libraries='pg_pathman'\n")
+            node.append_conf("pg_pathman.spawn_workers=2\n")
+            node.start()
+            node.safe_psql('create extension pg_pathman')
+
+            for i in range(4):
+                node.safe_psql("""
+                    create table spawn_{0}(val int not null);
+                    select create_range_partitions('spawn_{0}', 'val', 1, 10, 1);
+                    select set_spawn_using_bgw('spawn_{0}', true);
+                """.format(i))
+
+            errors = []
+
+            def insert_thread(table):
+                try:
+                    with node.connect() as con:
+                        for val in range(1, 200, 7):
+                            con.execute("insert into {} values ({})".format(table, val))
+                            con.commit()
+                except Exception as e:
+                    errors.append(e)
+
+            # Several backends create partitions of the same tables
+            threads = [
+                threading.Thread(target=insert_thread, args=('spawn_%d' % (i % 4), ))
+                for i in range(8)
+            ]
+
+            for t in threads:
+                t.start()
+
+            for t in threads:
+                t.join()
+
+            self.assertEqual(errors, [])
+
+            for i in range(4):
+                self.assertEqual(
+                    node.execute("select count(*) from spawn_{}".format(i))[0][0],
+                    2 * len(range(1, 200, 7)))
+
+                # Partitions are created in order, without gaps
+                self.assertEqual(
+                    node.execute("""
+                        select count(*), min(range_min::int), max(range_max::int)
+                        from pathman_partition_list
+                        where parent = 'spawn_{}'::regclass
+                    """.format(i))[0],
+                    (20, 1, 201))
+
+            # Idle workers are kept for subsequent requests
+            if version >= LooseVersion('11'):
+                num_workers = node.execute("""
+                    select count(*) from pg_stat_activity
+                    where backend_type = 'SpawnPartitionsPoolWorker'
+                """)[0][0]
+                self.assertTrue(1 <= num_workers <= 2)
+
+    def test_spawn_pool_no_workers(self):
+        """ Test that pool doesn't hang if workers can't be registered """
+
+        with get_new_node() as node:
+            node.init()
+            node.append_conf("shared_preload_libraries='pg_pathman'\n")
+            node.append_conf("pg_pathman.spawn_workers=2\n")
+
+            # Neither pool nor dedicated workers can be started
+            node.append_conf("max_worker_processes=0\n")
+            node.start()
+
+            node.safe_psql("""
+                create extension pg_pathman;
+                create table spawn_fail(val int not null);
+                select create_range_partitions('spawn_fail', 'val', 1, 10, 1);
+                select set_spawn_using_bgw('spawn_fail', true);
+            """)
+
+            results = []
+
+            def insert_thread(val):
+                with node.connect() as con:
+                    # Each backend should give up instead of waiting forever
+                    con.execute("set statement_timeout = '30s'")
+                    try:
+                        con.execute("insert into spawn_fail values ({})".format(val))
+                        con.commit()
+                        results.append('ok')
+                    except Exception as e:
+                        results.append(str(e))
+
+            # Requests of these backends are queued for the same slot
+            threads = [
+                threading.Thread(target=insert_thread, args=(100 + i, ))
+                for i in range(8)
+            ]
+
+            for t in threads:
+                t.start()
+
+            for t in threads:
+                t.join()
+
+            self.assertEqual(len(results), 8)
+
+            for res in results:
+                self.assertNotIn('statement timeout', res)
+                self.assertIn('could not start SpawnPartitionsWorker', res)
+
+            # Existing partition is still available
+            node.safe_psql("insert into spawn_fail values (5)")
+            self.assertEqual(
+                node.execute("select count(*) from pathman_partition_list")[0][0], 1)
+
+    def test_shared_cache(self):
+        """ Test dispatch through shared cache and its invalidation """
+
+        with get_new_node() as node:
+            node.init()
+            node.append_conf("shared_preload_libraries='pg_pathman'\n")
+            node.append_conf("pg_pathman.shared_cache_partitions=1000\n")
+            node.start()
+
+            node.safe_psql("""
+                create extension pg_pathman;
+                create table shared_range(val int not null);
+                select create_range_partitions('shared_range', 'val', 1, 10, 100);
+                create table shared_hash(val int not null);
+                select create_hash_partitions('shared_hash', 'val', 10);
+            """)
+
+            def check_partitions(con, parent):
+                # Partitions known to this backend
+                cached = con.execute("""
+                    select partition::text, range_min, range_max
+                    from pathman_partition_list
+                    where parent = '{}'::regclass
+                    order by 1
+                """.format(parent))
+
+                # Partitions stored in catalog
+                actual = con.execute("""
+                    select inhrelid::regclass::text
+                    from pg_inherits
+                    where inhparent = '{}'::regclass
+                    order by 1
+                """.format(parent))
+
+                con.commit()
+
+                self.assertEqual([p[0] for p in cached], [p[0] for p in actual])
+                return cached
+
+            def check_routing(con, parent, val, partition):
+                con.execute("insert into {} values ({})".format(parent, val))
+                res = con.execute("""
+                    select tableoid::regclass::text
+                    from {} where val = {}
+                """.format(parent, val))
+                con.commit()
+
+                self.assertEqual(res, [(partition, )])
+
+            with node.connect() as con1, node.connect() as con2:
+                # First backend publishes partitions, second one copies them
+                for parent in ('shared_range', 'shared_hash'):
+                    self.assertEqual(check_partitions(con1, parent),
+                                     check_partitions(con2, parent))
+
+                check_routing(con2, 'shared_range', 5, 'shared_range_1')
+
+                # New partition
+                con1.execute("select append_range_partition('shared_range')")
+                con1.commit()
+                self.assertEqual(len(check_partitions(con2, 'shared_range')), 101)
+                check_routing(con2, 'shared_range', 1005, 'shared_range_101')
+
+                # Changed bounds of a partition
+                con1.execute("select split_range_partition('shared_range_1', 5)")
+                con1.commit()
+                self.assertEqual(len(check_partitions(con2, 'shared_range')), 102)
+                check_routing(con2, 'shared_range', 7, 'shared_range_102')
+
+                # Dropped partitions
+                con1.execute("select merge_range_partitions('shared_range_2', 'shared_range_3')")
+                con1.execute("select drop_range_partition('shared_range_4')")
+                con1.commit()
+                self.assertEqual(len(check_partitions(con2, 'shared_range')), 100)
+                check_routing(con2, 'shared_range', 25, 'shared_range_2')
+
+                # Aborted changes are not visible
+                con1.begin()
+                con1.execute("select append_range_partition('shared_range')")
+                con1.rollback()
+                self.assertEqual(check_partitions(con1, 'shared_range'),
+                                 check_partitions(con2, 'shared_range'))
+
+                # Unrelated relations don't affect partitions
+                con1.execute("create table unrelated(val int)")
+                con1.execute("drop table unrelated")
+                con1.commit()
+                self.assertEqual(check_partitions(con1, 'shared_range'),
+                                 check_partitions(con2, 'shared_range'))
+
+                # Replaced partition
+                con1.execute("create table shared_hash_new(val int not null)")
+                con1.execute("select replace_hash_partition('shared_hash_0', 'shared_hash_new')")
+                con1.commit()
+                self.assertIn(('shared_hash_new', None, None),
+                              check_partitions(con2, 'shared_hash'))
+
+                # Parent is no longer partitioned
+                con1.execute("select drop_partitions('shared_range')")
+                con1.commit()
+                self.assertEqual(check_partitions(con2, 'shared_range'), [])
+
+                # New backend doesn't see outdated partitions either
+                with node.connect() as con3:
+                    for parent in ('shared_range', 'shared_hash'):
+                        self.assertEqual(check_partitions(con2, parent),
+                                         check_partitions(con3, parent))
+
+    def test_bounds_snapshot(self):
+        """ Test persistent snapshots of partitions' bounds """
+
+        with get_new_node() as node:
+            node.init()
+            node.append_conf("shared_preload_libraries='pg_pathman'\n")
+            node.append_conf("pg_pathman.enable_bounds_snapshot=on\n")
+            node.start()
+
+            node.safe_psql("""
+                create extension pg_pathman;
+                create table snap_range(val int not null);
+                select create_range_partitions('snap_range', 'val', 1, 10, 10);
+                insert into snap_range select generate_series(1, 100);
+                create table snap_hash(val int not null);
+                select create_hash_partitions('snap_hash', 'val', 4);
+                insert into snap_hash select generate_series(1, 100);
+            """)
+
+            dboid = node.execute("""
+                select oid from pg_database
+                where datname = current_database()
+            """)[0][0]
+
+            def snapshot_path(parent):
+                relid = node.execute("select '{}'::regclass::oid".format(parent))[0][0]
+                return os.path.join(node.data_dir, 'pg_pathman',
+                                    '{}_{}'.format(dboid, relid))
+
+            def read_snapshot(path):
+                with open(path, 'rb') as f:
+                    return f.read()
+
+            # Each call opens a new backend, which loads snapshots
+            def check_partitions():
+                self.assertEqual(
+                    node.execute("""
+                        select count(*) from snap_range
+                        where val between 15 and 34
+                    """)[0][0], 20)
+                self.assertEqual(
+                    node.execute("""
+                        select tableoid::regclass::text from snap_range
+                        where val = 42
+                    """), [('snap_range_5', )])
+                self.assertEqual(
+                    node.execute("""
+                        select count(*) from snap_hash
+                        where val in (1, 2, 3, 42)
+                    """)[0][0], 4)
+
+            range_path = snapshot_path('snap_range')
+            hash_path = snapshot_path('snap_hash')
+
+            check_partitions()
+            self.assertTrue(os.path.isfile(range_path))
+            self.assertTrue(os.path.isfile(hash_path))
+
+            # Snapshot is rewritten if parent's pg_class entry has changed
+            saved = read_snapshot(range_path)
+            node.safe_psql("alter table snap_range set (fillfactor = 90)")
+            check_partitions()
+            self.assertNotEqual(read_snapshot(range_path), saved)
+
+            # Broken snapshot is ignored and rewritten
+            with open(range_path, 'wb') as f:
+                f.write(b'garbage')
+            check_partitions()
+            self.assertNotEqual(read_snapshot(range_path), b'garbage')
+
+            # Changed bounds of partition are not taken from snapshot
+            node.safe_psql("select split_range_partition('snap_range_5', 45)")
+            self.assertEqual(
+                node.execute("""
+                    select tableoid::regclass::text from snap_range
+                    where val = 47
+                """), [('snap_range_11', )])
+            check_partitions()
+
+            # Snapshot is rewritten if any CHECK constraint has changed
+            saved = read_snapshot(hash_path)
+            node.safe_psql("""
+                alter table snap_hash_0 add constraint snap_check check (true)
+            """)
+            check_partitions()
+            self.assertNotEqual(read_snapshot(hash_path), saved)
+
+            # Snapshots of dropped or unpartitioned parents are removed
+            node.safe_psql("select drop_partitions('snap_range')")
+            self.assertFalse(os.path.exists(range_path))
+
+            node.safe_psql("drop table snap_hash cascade")
+            self.assertFalse(os.path.exists(hash_path))
+
+    def test_premake_partitions(self):
+        """ Test PremakePartitionsWorker """
+
+        with get_new_node() as node:
+            node.init()
+            node.append_conf("shared_preload_libraries='pg_pathman'\n")
+            node.append_conf("pg_pathman.premake_databases='postgres'\n")
+            node.append_conf("pg_pathman.premake_partitions=2\n")
+            node.append_conf("pg_pathman.premake_naptime=1\n")
+            node.start()
+
+            node.safe_psql("""
+                create extension pg_pathman;
+                create table premake(val int not null);
+                select create_range_partitions('premake', 'val', 1, 10, 3);
+                insert into premake select generate_series(1, 15);
+                create table premake_no_auto(val int not null);
+                select create_range_partitions('premake_no_auto', 'val', 1, 10, 1);
+                select set_auto('premake_no_auto', false);
+                create table premake_hash(val int not null);
+                select create_hash_partitions('premake_hash', 'val', 2);
+            """)
+
+            def num_partitions(parent):
+                return node.execute("""
+                    select count(*) from pathman_partition_list
+                    where parent = '{}'::regclass
+                """.format(parent))[0][0]
+
+            def wait_for_partitions(parent, count):
+                for _ in range(60):
+                    if num_partitions(parent) >= count:
+                        break
+                    time.sleep(0.5)
+
+                self.assertEqual(num_partitions(parent), count)
+
+            # Partition [21, 31) is still empty, so only one is added
+            wait_for_partitions('premake', 4)
+
+            # Two empty partitions should follow the last non-empty one
+            node.safe_psql("insert into premake values (35)")
+            wait_for_partitions('premake', 6)
+            self.assertEqual(
+                node.execute("""
+                    select max(range_max::int) from pathman_partition_list
+                    where parent = 'premake'::regclass
+                """)[0][0], 61)
+
+            # Rows are routed to premade partitions
+            node.safe_psql("insert into premake values (45), (55)")
+            self.assertEqual(
+                node.execute("""
+                    select tableoid::regclass::text from premake
+                    where val > 40 order by val
+                """), [('premake_5', ), ('premake_6', )])
+
+            # Tables without auto partition creation and HASH are ignored
+            self.assertEqual(num_partitions('premake_no_auto'), 1)
+            self.assertEqual(num_partitions('premake_hash'), 2)
+
+            # init_callback is executed on behalf of table's owner
+            node.safe_psql("""
+                create role premake_owner;
+                create table premake_log(usr text);
+                grant insert on premake_log to premake_owner;
+                create function premake_callback(params jsonb)
+                returns void as $$
+                    insert into premake_log values (current_user);
+                $$ language sql;
+                create table premake_owned(val int not null);
+                alter table premake_owned owner to premake_owner;
+                select create_range_partitions('premake_owned', 'val', 1, 10, 1);
+                select set_init_callback('premake_owned',
+                                         'premake_callback(jsonb)');
+            """)
+
+            wait_for_partitions('premake_owned', 3)
+            self.assertEqual(
+                node.execute("select distinct usr from premake_log"),
+                [('premake_owner', )])
+
     def test_update_node_plan1(self):
         '''
         Test scan on all partititions when using update node.